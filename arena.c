@@ -0,0 +1,112 @@
+
+#include "arena.h"
+
+/**
+ * The alignment of memory handed out by the arena.
+ */
+#define ARENA_ALIGNMENT 8
+
+/**
+ * Rounds a size up to the arena alignment.
+ * @param size the size to round.
+ * @return the rounded size.
+ */
+static inline size_t
+align(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Returns the memory of a chunk.
+ * @param chunk the chunk.
+ * @return a pointer to the first usable byte of the chunk.
+ */
+static inline char *
+chunk_data(ArenaChunk *chunk)
+{
+    return (char *)chunk + align(sizeof(ArenaChunk));
+}
+
+/**
+ * Allocates a new chunk from the heap.
+ * @param size the minimum number of usable bytes.
+ * @return the chunk, or NULL if heap allocation failed.
+ */
+static ArenaChunk *
+create_chunk(size_t size)
+{
+    ArenaChunk *chunk = malloc(align(sizeof(ArenaChunk)) + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+Arena *
+arena_create(size_t chunk_size)
+{
+    Arena *arena = malloc(sizeof(Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->chunk_size = align(chunk_size);
+    arena->first = arena->current = create_chunk(arena->chunk_size);
+    if (arena->first == NULL) {
+        free(arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+void *
+arena_alloc(Arena *arena, size_t size)
+{
+    ArenaChunk *chunk = arena->current;
+    void *p;
+
+    size = align(size);
+
+    // move on to the next chunk (either reused or new) if the current one is exhausted
+    while (chunk->used + size > chunk->size) {
+        if (chunk->next == NULL) {
+            chunk->next = create_chunk(size > arena->chunk_size ? size : arena->chunk_size);
+            if (chunk->next == NULL) {
+                return NULL;
+            }
+        }
+        chunk = chunk->next;
+        // chunks behind the current one are reset lazily
+        chunk->used = 0;
+        arena->current = chunk;
+    }
+
+    p = chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+
+    return p;
+}
+
+void
+arena_reset(Arena *arena)
+{
+    arena->current = arena->first;
+    arena->first->used = 0;
+}
+
+void
+arena_destroy(Arena *arena)
+{
+    ArenaChunk *chunk, *next;
+
+    for (chunk = arena->first; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    free(arena);
+}
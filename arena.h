@@ -0,0 +1,85 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+
+/**
+ * A simple bump allocator: memory is handed out from large chunks and can only be released all at once.
+ */
+
+/**
+ * a type representing a chunk of arena memory.
+ */
+typedef struct arena_chunk {
+
+    /**
+     * the next chunk (may already have been used before the last reset).
+     */
+    struct arena_chunk *next;
+
+    /**
+     * the number of usable bytes in the chunk.
+     */
+    size_t size;
+
+    /**
+     * the number of bytes already handed out.
+     */
+    size_t used;
+
+} ArenaChunk;
+
+/**
+ * a type representing the arena.
+ */
+typedef struct arena {
+
+    /**
+     * the (minimum) size of newly allocated chunks.
+     */
+    size_t chunk_size;
+
+    /**
+     * the first chunk.
+     */
+    ArenaChunk *first;
+
+    /**
+     * the chunk memory is currently handed out from.
+     */
+    ArenaChunk *current;
+
+} Arena;
+
+/**
+ * Creates an arena.
+ * @param chunk_size the size of the chunks the arena allocates from the heap.
+ * @return a pointer to the arena created on the heap, or NULL if heap allocation failed.
+ */
+Arena *
+arena_create(size_t chunk_size);
+
+/**
+ * Allocates memory from the arena.
+ * @param arena the arena.
+ * @param size the number of bytes to allocate.
+ * @return a pointer to the allocated memory (8 byte aligned), or NULL if heap allocation failed.
+ */
+void *
+arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Releases all memory allocated from the arena at once; the chunks are kept for reuse.
+ * @param arena the arena.
+ */
+void
+arena_reset(Arena *arena);
+
+/**
+ * Destroys an arena and frees all resources.
+ * @param arena the arena.
+ */
+void
+arena_destroy(Arena *arena);
+
+#endif
@@ -0,0 +1,229 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hash_table.h"
+#include "hash_table_spec.h"
+#include "life.h"
+
+// Compares the generic hash table (void * keys, hash and compare functions called through pointers) with the hash
+// table specialized for Point2D keys (see hash_table_spec.h) on the lookups of the checkcell engine: for every cell
+// of a random soup, the 9 cells around it are looked up in the soup's table and put into a second table.
+
+// Calculates a FNV hash for a Point2D instance (generic table).
+static unsigned int
+hash_point2d(const void *p)
+{
+  return hash_bytes(p, sizeof(Point2D));
+}
+
+// Used to compare two Point2D instances (generic table).
+static int
+point2d_cmp(const void *a, const void *b)
+{
+  Point2D *p1 = (Point2D *)a, *p2 = (Point2D *)b;
+  int dx = p1->x - p2->x;
+  return (dx == 0) ? (p1->y - p2->y) : dx;
+}
+
+// Calculates a FNV hash for a Point2D instance (specialized table).
+static inline unsigned int
+hash_point2d_spec(const Point2D *p)
+{
+  return hash_table_spec_bytes(p, sizeof(Point2D));
+}
+
+// Used to compare two Point2D instances (specialized table).
+static inline int
+point2d_cmp_spec(const Point2D *p1, const Point2D *p2)
+{
+  int dx = p1->x - p2->x;
+  return (dx == 0) ? (p1->y - p2->y) : dx;
+}
+
+#define HASH_TABLE_SPEC_PREFIX point_table
+#define HASH_TABLE_SPEC_TYPE PointTable
+#define HASH_TABLE_SPEC_KEY_T Point2D
+#define HASH_TABLE_SPEC_VAL_T Point2D *
+#define HASH_TABLE_SPEC_HASH hash_point2d_spec
+#define HASH_TABLE_SPEC_CMP point2d_cmp_spec
+#include "hash_table_spec.h"
+
+// The cells of the soup and the cells around them (the keys of the generic tables must stay in place).
+static Point2D *cells;
+static Point2D *neighbors;
+static size_t num_cells;
+
+// Returns the current time in seconds.
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Fills the soup with distinct random cells (about every third cell of a square is alive).
+static void
+makesoup(size_t n)
+{
+  HashTable *tbl;
+  uint64_t state = 88172645463325252ull;
+  long side = 1;
+  size_t i;
+
+  while ((size_t)side * side < 3 * n) {
+    side++;
+  }
+
+  cells = malloc(n * sizeof(Point2D));
+  neighbors = malloc(9 * n * sizeof(Point2D));
+  tbl = hash_table_create(1024, 0.75f, &hash_point2d, &point2d_cmp);
+  if (cells == NULL || neighbors == NULL || tbl == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  for (num_cells = 0; num_cells < n; ) {
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    cells[num_cells].x = (long)(state % side);
+    cells[num_cells].y = (long)(state / side % side);
+    if (hash_table_get_or_put(tbl, &cells[num_cells], &cells[num_cells]) == &cells[num_cells]) {
+      num_cells++;
+    }
+  }
+  hash_table_destroy(tbl);
+
+  for (i = 0; i < 9 * num_cells; i++) {
+    neighbors[i].x = cells[i / 9].x + (long)(i % 3) - 1;
+    neighbors[i].y = cells[i / 9].y + (long)(i / 3 % 3) - 1;
+  }
+}
+
+// Runs the benchmark on the generic table; returns the number of alive neighbors found (as a checksum).
+static size_t
+bench_generic(long rounds, double *seconds)
+{
+  HashTable *current, *next;
+  size_t i, found = 0;
+  double start;
+  long r;
+
+  current = hash_table_create(1024, 0.75f, &hash_point2d, &point2d_cmp);
+  next = hash_table_create(1024, 0.75f, &hash_point2d, &point2d_cmp);
+  if (current == NULL || next == NULL) {
+    perror("hash_table_create");
+    exit(1);
+  }
+
+  start = now();
+  for (i = 0; i < num_cells; i++) {
+    hash_table_put(current, &cells[i], &cells[i]);
+  }
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < 9 * num_cells; i++) {
+      found += hash_table_contains(current, &neighbors[i]);
+      if (hash_table_get_or_put(next, &neighbors[i], &neighbors[i]) == NULL) {
+        perror("hash_table_get_or_put");
+        exit(1);
+      }
+    }
+    found += hash_table_size(next);
+    hash_table_clear(next);
+  }
+  *seconds = now() - start;
+
+  hash_table_destroy(current);
+  hash_table_destroy(next);
+  return found;
+}
+
+// Runs the benchmark on the specialized table; returns the number of alive neighbors found (as a checksum).
+static size_t
+bench_spec(long rounds, double *seconds)
+{
+  PointTable *current, *next;
+  size_t i, found = 0;
+  double start;
+  long r;
+
+  current = point_table_create(1024, 0.75f);
+  next = point_table_create(1024, 0.75f);
+  if (current == NULL || next == NULL) {
+    perror("point_table_create");
+    exit(1);
+  }
+
+  start = now();
+  for (i = 0; i < num_cells; i++) {
+    point_table_put(current, &cells[i], &cells[i]);
+  }
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < 9 * num_cells; i++) {
+      found += point_table_contains(current, &neighbors[i]);
+      if (point_table_get_or_put(next, &neighbors[i], &neighbors[i]) == NULL) {
+        perror("point_table_get_or_put");
+        exit(1);
+      }
+    }
+    found += point_table_size(next);
+    point_table_clear(next);
+  }
+  *seconds = now() - start;
+
+  point_table_destroy(current);
+  point_table_destroy(next);
+  return found;
+}
+
+int main(int argc, char **argv)
+{
+  long sizes[] = {1000, 10000, 100000};
+  long rounds = 10;
+  double generic_seconds, spec_seconds;
+  size_t i, generic_found, spec_found;
+  char *endptr;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:")) != -1) {
+    switch (opt) {
+    case 'r':
+      rounds = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || rounds < 1) {
+        fprintf(stderr, "\"%s\" not a valid round count\n", optarg);
+        exit(1);
+      }
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-r rounds]\n", argv[0]);
+      exit(1);
+    }
+  }
+
+  printf("%ld rounds\n\n", rounds);
+  printf("%-10s %12s %12s %8s\n", "cells", "generic", "specialized", "speedup");
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    makesoup(sizes[i]);
+
+    generic_found = bench_generic(rounds, &generic_seconds);
+    spec_found = bench_spec(rounds, &spec_seconds);
+    if (generic_found != spec_found) {
+      fprintf(stderr, "tables disagree: %zu vs. %zu\n", generic_found, spec_found);
+      exit(1);
+    }
+
+    printf("%-10ld %11.3fs %11.3fs %7.2fx\n", sizes[i], generic_seconds, spec_seconds,
+           generic_seconds / spec_seconds);
+
+    free(cells);
+    free(neighbors);
+  }
+
+  return 0;
+}
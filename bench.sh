@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Compares the checkcell() path of life-cell_table (robin hood and swiss table backend) with the step kernels of
+# life-tile_table.
+
+# Prints the wall clock time (in seconds) of a run; the output of the run is written to $OUT.
+timed_run() {
+    TIMEFORMAT=%R
+    { time "$@" < $FILE 2>/dev/null | sort > $OUT ; } 2>&1
+}
+
+GENERATIONS=100
+FILES=`ls f*.l | sort`
+KERNELS="scalar sse2 avx2"
+
+while getopts 'g:f:' flag; do
+    case "${flag}" in
+        g) GENERATIONS=${OPTARG} ;;
+        f) FILES="${OPTARG}" ;;
+        *) echo "Usage: $0 [-g generations] [-f files]"; exit 1 ;;
+    esac
+done
+
+EXPECTED=`mktemp`
+OUT=`mktemp`
+
+printf "%d generations\n\n" $GENERATIONS
+printf "%-10s %12s %12s" "file" "checkcell" "swiss"
+for kernel in $KERNELS
+do
+    printf " %12s" "tile/$kernel"
+done
+printf "\n"
+
+for FILE in $FILES
+do
+    printf "%-10s" $FILE
+    OUT=$EXPECTED
+    printf " %12s" "`timed_run ./life-cell_table -e checkcell $GENERATIONS`s"
+
+    OUT=`mktemp`
+    T="`timed_run ./life-cell_table_swiss -e checkcell $GENERATIONS`s"
+    if ! cmp -s $EXPECTED $OUT
+    then
+        T="MISMATCH"
+    fi
+    printf " %12s" $T
+
+    for kernel in $KERNELS
+    do
+        if ./life-tile_table -k $kernel 0 < /dev/null > /dev/null 2>&1
+        then
+            T="`timed_run ./life-tile_table -k $kernel $GENERATIONS`s"
+            if ! cmp -s $EXPECTED $OUT
+            then
+                T="MISMATCH"
+            fi
+            printf " %12s" $T
+        else
+            printf " %12s" "n/a"
+        fi
+    done
+    rm -f $OUT
+    printf "\n"
+done
+
+rm -f $EXPECTED
@@ -0,0 +1,58 @@
+
+#include "cell_format.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+const char cell_format_digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int
+text_buffer_init(TextBuffer *buf, size_t capacity)
+{
+    buf->data = malloc(capacity);
+    if (buf->data == NULL) {
+        return 0;
+    }
+    buf->size = 0;
+    buf->capacity = capacity;
+    return 1;
+}
+
+int
+text_buffer_flush(TextBuffer *buf, int fd)
+{
+    size_t written = 0;
+    ssize_t n;
+
+    while (written < buf->size) {
+        n = write(fd, buf->data + written, buf->size - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        written += n;
+    }
+
+    buf->size = 0;
+    return 1;
+}
+
+void
+text_buffer_destroy(TextBuffer *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = buf->capacity = 0;
+}
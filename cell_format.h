@@ -0,0 +1,144 @@
+#ifndef CELL_FORMAT_H
+#define CELL_FORMAT_H
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Fast text output of cells ("x y\n"): integers are converted two digits at a time and collected in large
+ * buffers which are written with write(2).
+ */
+
+/**
+ * The maximum length of the text representation of a single cell.
+ */
+#define CELL_FORMAT_MAX 48
+
+/**
+ * The ASCII representations of the numbers 00 to 99.
+ */
+extern const char cell_format_digit_pairs[200];
+
+/**
+ * a type representing a growable text buffer.
+ */
+typedef struct text_buffer {
+
+    /**
+     * The buffered text.
+     */
+    char *data;
+
+    /**
+     * The number of buffered bytes.
+     */
+    size_t size;
+
+    /**
+     * The capacity of the buffer.
+     */
+    size_t capacity;
+
+} TextBuffer;
+
+/**
+ * Writes the decimal representation of an integer.
+ * @param p the output position.
+ * @param v the integer.
+ * @return the position after the written characters.
+ */
+static inline char *
+format_long(char *p, long v)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp), *q = end;
+    unsigned long u = v < 0 ? -(unsigned long)v : (unsigned long)v;
+
+    while (u >= 100) {
+        q -= 2;
+        memcpy(q, &cell_format_digit_pairs[2 * (u % 100)], 2);
+        u /= 100;
+    }
+    if (u >= 10) {
+        q -= 2;
+        memcpy(q, &cell_format_digit_pairs[2 * u], 2);
+    } else {
+        *--q = '0' + u;
+    }
+
+    *p = '-';
+    p += v < 0;
+    memcpy(p, q, end - q);
+    return p + (end - q);
+}
+
+/**
+ * Appends the text representation of a cell to a text buffer; the buffer must have room for CELL_FORMAT_MAX bytes.
+ * @param buf the text buffer.
+ * @param x the X coordinate.
+ * @param y the Y coordinate.
+ */
+static inline void
+text_buffer_put_cell(TextBuffer *buf, long x, long y)
+{
+    char *p = buf->data + buf->size;
+
+    p = format_long(p, x);
+    *p++ = ' ';
+    p = format_long(p, y);
+    *p++ = '\n';
+    buf->size = p - buf->data;
+}
+
+/**
+ * Initializes an empty text buffer.
+ * @param buf a pointer to an allocated text buffer instance.
+ * @param capacity the initial capacity.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+text_buffer_init(TextBuffer *buf, size_t capacity);
+
+/**
+ * Makes sure a text buffer has room for a number of additional bytes, growing it if necessary.
+ * @param buf the text buffer.
+ * @param extra the number of additional bytes.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static inline int
+text_buffer_reserve(TextBuffer *buf, size_t extra)
+{
+    char *data;
+    size_t capacity;
+
+    if (buf->capacity - buf->size >= extra) {
+        return 1;
+    }
+
+    capacity = buf->capacity * 2 > buf->size + extra ? buf->capacity * 2 : buf->size + extra;
+    data = realloc(buf->data, capacity);
+    if (data == NULL) {
+        return 0;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Writes the content of a text buffer to a file descriptor and empties the buffer.
+ * @param buf the text buffer.
+ * @param fd the file descriptor.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+text_buffer_flush(TextBuffer *buf, int fd);
+
+/**
+ * Frees the memory of a text buffer.
+ * @param buf the text buffer.
+ */
+void
+text_buffer_destroy(TextBuffer *buf);
+
+#endif
@@ -0,0 +1,697 @@
+
+#include "cell_reader.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cell_format.h"
+#include "input_stream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CELL_READER_X86
+#endif
+
+/**
+ * Inputs smaller than this are parsed by a single thread.
+ */
+#define PARSE_PARALLEL_THRESHOLD (1 << 20)
+
+/**
+ * The size of the chunks streamed inputs are read in.
+ */
+#define STREAM_CHUNK_SIZE (1 << 22)
+
+/**
+ * a type representing a cell list growing while runs are decoded.
+ */
+typedef struct run_list {
+
+    /**
+     * The cell list.
+     */
+    CellList *list;
+
+    /**
+     * The capacity of the list's cell array.
+     */
+    size_t capacity;
+
+    /**
+     * a flag indicating that memory ran out.
+     */
+    int failed;
+
+} RunList;
+
+/**
+ * a type representing the chunks of a text parsed in parallel.
+ */
+typedef struct text_chunks {
+
+    /**
+     * The text.
+     */
+    const char *data;
+
+    /**
+     * Per chunk: the offset of the chunk in the text; one more entry marks the end of the text.
+     */
+    size_t *begin;
+
+    /**
+     * Per chunk: the number of newlines (pass 1), then the index of the chunk's first cell in the output (pass 2).
+     */
+    size_t *offset;
+
+    /**
+     * Per chunk: the number of parsed cells, or -1 on a syntax error.
+     */
+    long *num_cells;
+
+    /**
+     * The output array; chunk i may use the entries from offset[i] up to offset[i + 1].
+     */
+    Point2D *cells;
+
+} TextChunks;
+
+/**
+ * Counts the newlines in a text, one byte at a time.
+ * @param data the text.
+ * @param size the size of the text.
+ * @return the number of newlines.
+ */
+static size_t
+count_newlines_scalar(const char *data, size_t size)
+{
+    size_t i, n = 0;
+
+    for (i = 0; i < size; ++i) {
+        n += data[i] == '\n';
+    }
+    return n;
+}
+
+#ifdef CELL_READER_X86
+
+/**
+ * Counts the newlines in a text, 16 bytes at a time.
+ * @see count_newlines_scalar
+ */
+__attribute__((target("sse2")))
+static size_t
+count_newlines_sse2(const char *data, size_t size)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0, n = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+    }
+    return n + count_newlines_scalar(data + i, size - i);
+}
+
+#endif
+
+/**
+ * Counts the newlines in a text with the fastest kernel the CPU supports.
+ * @param data the text.
+ * @param size the size of the text.
+ * @return the number of newlines.
+ */
+static size_t
+count_newlines(const char *data, size_t size)
+{
+#ifdef CELL_READER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return count_newlines_sse2(data, size);
+    }
+#endif
+    return count_newlines_scalar(data, size);
+}
+
+/**
+ * Parses a decimal integer with an optional sign.
+ * @param p the position to start at; advanced behind the integer.
+ * @param end the end of the text.
+ * @param out an output parameter for the integer.
+ * @return true if an integer was found, false otherwise (also if it does not fit into a long).
+ */
+static inline int
+parse_long(const char **p, const char *end, long *out)
+{
+    const char *s = *p, *digits;
+    unsigned long v = 0, limit = LONG_MAX;
+    unsigned int d;
+    int neg = 0;
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        neg = *s == '-';
+        s++;
+    }
+
+    // a negative integer may be one larger in magnitude (LONG_MIN)
+    limit += neg;
+    for (digits = s; s < end && (d = (unsigned char)*s - '0') < 10; s++) {
+        if (v > (limit - d) / 10) {
+            return 0;
+        }
+        v = v * 10 + d;
+    }
+    if (s == digits) {
+        return 0;
+    }
+
+    *out = neg && v > 0 ? -(long)(v - 1) - 1 : (long)v;
+    *p = s;
+    return 1;
+}
+
+/**
+ * Parses the lines of a text chunk.
+ * @param p the beginning of the chunk.
+ * @param end the end of the chunk.
+ * @param out the output array (with room for one cell per line).
+ * @return the number of parsed cells, or -1 on a syntax error.
+ */
+static long
+parse_lines(const char *p, const char *end, Point2D *out)
+{
+    Point2D *o = out;
+
+    while (p < end) {
+        // skip blank lines and leading blanks
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+        if (p == end) {
+            break;
+        }
+
+        if (!parse_long(&p, end, &o->x)) {
+            return -1;
+        }
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (!parse_long(&p, end, &o->y)) {
+            return -1;
+        }
+        o++;
+
+        // nothing but blanks may follow on the same line
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p < end && *p != '\n') {
+            return -1;
+        }
+    }
+
+    return o - out;
+}
+
+/**
+ * Counts the newlines of a chunk (pass 1, run by every thread).
+ */
+static void
+count_chunk(void *arg, size_t thread_idx, size_t num_threads)
+{
+    TextChunks *chunks = (TextChunks *)arg;
+
+    (void)num_threads;
+
+    chunks->offset[thread_idx] = count_newlines(chunks->data + chunks->begin[thread_idx],
+                                                chunks->begin[thread_idx + 1] - chunks->begin[thread_idx]);
+}
+
+/**
+ * Parses a chunk (pass 2, run by every thread).
+ */
+static void
+parse_chunk(void *arg, size_t thread_idx, size_t num_threads)
+{
+    TextChunks *chunks = (TextChunks *)arg;
+
+    (void)num_threads;
+
+    chunks->num_cells[thread_idx] = parse_lines(chunks->data + chunks->begin[thread_idx],
+                                                chunks->data + chunks->begin[thread_idx + 1],
+                                                chunks->cells + chunks->offset[thread_idx]);
+}
+
+/**
+ * Parses a text split into chunks and appends the cells to a list.
+ * @param chunks the chunks; begin has to be set up, the other arrays have to be allocated.
+ * @param num_chunks the number of chunks.
+ * @param pool the thread pool parsing the chunks (with one thread per chunk), or NULL for a single chunk.
+ * @param list the list the parsed cells are appended to.
+ * @return true if the text was parsed successfully, false otherwise.
+ */
+static int
+parse_chunks(TextChunks *chunks, size_t num_chunks, ThreadPool *pool, CellList *list)
+{
+    size_t i, n, lines, num_cells;
+    Point2D *cells;
+
+    // pass 1: a chunk holds at most one cell per line
+    if (num_chunks > 1) {
+        thread_pool_run(pool, &count_chunk, chunks);
+    } else {
+        count_chunk(chunks, 0, 1);
+    }
+    for (i = 0, lines = 0; i < num_chunks; ++i) {
+        n = chunks->offset[i] + 1;
+        chunks->offset[i] = lines;
+        lines += n;
+    }
+    chunks->offset[num_chunks] = lines;
+
+    cells = realloc(list->cells, (list->num_cells + lines) * sizeof(Point2D));
+    if (cells == NULL) {
+        return 0;
+    }
+    list->cells = cells;
+    chunks->cells = cells + list->num_cells;
+
+    // pass 2: parse every chunk into its part of the output array
+    if (num_chunks > 1) {
+        thread_pool_run(pool, &parse_chunk, chunks);
+    } else {
+        parse_chunk(chunks, 0, 1);
+    }
+
+    // close the gaps between the chunks
+    for (i = 0, num_cells = 0; i < num_chunks; ++i) {
+        if (chunks->num_cells[i] < 0) {
+            return 0;
+        }
+        memmove(chunks->cells + num_cells, chunks->cells + chunks->offset[i], chunks->num_cells[i] * sizeof(Point2D));
+        num_cells += chunks->num_cells[i];
+    }
+
+    list->num_cells += num_cells;
+    return 1;
+}
+
+/**
+ * Parses a list of coordinate pairs and appends the cells to a list (see cell_reader_parse_text()).
+ * @param list the list the parsed cells are appended to.
+ * @param data the text.
+ * @param size the size of the text.
+ * @param pool a thread pool used to parse large texts in parallel, or NULL.
+ * @return true if the text was parsed successfully, false otherwise.
+ */
+static int
+append_text(CellList *list, const char *data, size_t size, ThreadPool *pool)
+{
+    TextChunks chunks;
+    size_t num_chunks, i;
+    const char *newline;
+    int ok = 0;
+
+    num_chunks = pool != NULL && size >= PARSE_PARALLEL_THRESHOLD ? thread_pool_size(pool) : 1;
+
+    chunks.data = data;
+    chunks.begin = malloc((num_chunks + 1) * sizeof(size_t));
+    chunks.offset = malloc((num_chunks + 1) * sizeof(size_t));
+    chunks.num_cells = malloc(num_chunks * sizeof(long));
+
+    if (chunks.begin != NULL && chunks.offset != NULL && chunks.num_cells != NULL) {
+        // split the text behind the newline following every n-th byte
+        chunks.begin[0] = 0;
+        for (i = 1; i < num_chunks; ++i) {
+            chunks.begin[i] = size / num_chunks * i;
+            if (chunks.begin[i] < chunks.begin[i - 1]) {
+                chunks.begin[i] = chunks.begin[i - 1];
+            }
+            newline = memchr(data + chunks.begin[i], '\n', size - chunks.begin[i]);
+            chunks.begin[i] = newline != NULL ? (size_t)(newline - data) + 1 : size;
+        }
+        chunks.begin[num_chunks] = size;
+
+        ok = parse_chunks(&chunks, num_chunks, num_chunks > 1 ? pool : NULL, list);
+    }
+
+    free(chunks.begin);
+    free(chunks.offset);
+    free(chunks.num_cells);
+    return ok;
+}
+
+int
+cell_reader_parse_text(CellList *list, const char *data, size_t size, ThreadPool *pool)
+{
+    list->cells = NULL;
+    list->num_cells = 0;
+    if (!append_text(list, data, size, pool)) {
+        cell_list_free(list);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Returns the end of the line a position is in.
+ * @param p the position.
+ * @param end the end of the text.
+ * @return the position of the newline, or end if there is none.
+ */
+static inline const char *
+line_end(const char *p, const char *end)
+{
+    const char *newline = memchr(p, '\n', end - p);
+    return newline != NULL ? newline : end;
+}
+
+/**
+ * Checks whether the rule given in the header of a run length encoded pattern is B3/S23.
+ * @param p the beginning of the header line.
+ * @param end the end of the header line.
+ * @return true if the header names no rule or B3/S23, false otherwise.
+ */
+static int
+is_conway_rule(const char *p, const char *end)
+{
+    char rule[16];
+    size_t len = 0;
+
+    // find the "rule" key
+    for (; p + 4 <= end; ++p) {
+        if (strncmp(p, "rule", 4) == 0) {
+            break;
+        }
+    }
+    if (p + 4 > end) {
+        return 1;
+    }
+
+    // copy the value without blanks, lower case
+    for (p += 4; p < end && (*p == ' ' || *p == '\t' || *p == '='); ++p);
+    for (; p < end && *p != ',' && len < sizeof(rule) - 1; ++p) {
+        if (!isspace((unsigned char)*p)) {
+            rule[len++] = tolower((unsigned char)*p);
+        }
+    }
+    rule[len] = '\0';
+
+    return strcmp(rule, "b3/s23") == 0 || strcmp(rule, "23/3") == 0;
+}
+
+/**
+ * Appends a run of alive cells to a run list (a run_function).
+ */
+static void
+append_run(void *arg, long x, long y, long len)
+{
+    RunList *runs = (RunList *)arg;
+    CellList *list = runs->list;
+    Point2D *cells;
+    size_t capacity, max_cells = SIZE_MAX / sizeof(Point2D);
+
+    if (runs->failed) {
+        return;
+    }
+
+    // the cells must fit into the address space
+    if ((unsigned long)len > max_cells - list->num_cells) {
+        runs->failed = 1;
+        return;
+    }
+
+    if (list->num_cells + len > runs->capacity) {
+        capacity = runs->capacity < max_cells / 2 ? runs->capacity * 2 : max_cells;
+        if (capacity < list->num_cells + len) {
+            capacity = list->num_cells + len;
+        }
+        cells = realloc(list->cells, capacity * sizeof(Point2D));
+        if (cells == NULL) {
+            runs->failed = 1;
+            return;
+        }
+        list->cells = cells;
+        runs->capacity = capacity;
+    }
+
+    for (; len > 0; --len, ++x) {
+        list->cells[list->num_cells].x = x;
+        list->cells[list->num_cells].y = y;
+        list->num_cells++;
+    }
+}
+
+InputFormat
+cell_reader_sniff(const char *data, size_t size, size_t *body)
+{
+    const char *p = data, *end = data + size;
+
+    // skip comment lines (this includes the "#Life 1.06" header) and blank lines
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+        if (p == end || *p != '#') {
+            break;
+        }
+        p = line_end(p, end);
+    }
+
+    // back to the beginning of the line
+    while (p > data && p[-1] != '\n') p--;
+    *body = p - data;
+
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p < end && *p == 'x' ? INPUT_RLE : INPUT_TEXT;
+}
+
+int
+cell_reader_decode_rle(const char *data, size_t size, run_function *f, void *arg)
+{
+    const char *p = data, *end = data + size, *header_end;
+    long x = 0, y = 0, count;
+    unsigned int d;
+
+    header_end = line_end(p, end);
+    if (!is_conway_rule(p, header_end)) {
+        return 0;
+    }
+
+    for (p = header_end; p < end; ++p) {
+        if (isspace((unsigned char)*p)) {
+            continue;
+        }
+
+        // an optional run count precedes every tag
+        count = 1;
+        if ((d = (unsigned char)*p - '0') < 10) {
+            for (count = 0; p < end && (d = (unsigned char)*p - '0') < 10; ++p) {
+                if (count > (LONG_MAX - 9) / 10) {
+                    return 0;
+                }
+                count = count * 10 + d;
+            }
+            if (p == end) {
+                return 0;
+            }
+        }
+
+        // the coordinates never decrease, so a run must not carry them beyond LONG_MAX
+        if (count > LONG_MAX - (*p == '$' ? y : x)) {
+            return 0;
+        }
+
+        switch (*p) {
+        case 'b':
+            x += count;
+            break;
+        case '$':
+            y += count;
+            x = 0;
+            break;
+        case '!':
+            return 1;
+        default:
+            // 'o' and the letters of multi-state patterns are alive cells
+            if (!isalpha((unsigned char)*p)) {
+                return 0;
+            }
+            f(arg, x, y, count);
+            x += count;
+        }
+    }
+
+    return 1;
+}
+
+int
+cell_reader_parse(CellList *list, const char *data, size_t size, ThreadPool *pool)
+{
+    RunList runs;
+    size_t body;
+
+    if (cell_reader_sniff(data, size, &body) == INPUT_TEXT) {
+        return cell_reader_parse_text(list, data + body, size - body, pool);
+    }
+
+    list->cells = NULL;
+    list->num_cells = 0;
+    runs.list = list;
+    runs.capacity = 0;
+    runs.failed = 0;
+    if (!cell_reader_decode_rle(data + body, size - body, &append_run, &runs) || runs.failed) {
+        cell_list_free(list);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Appends bytes to a text buffer.
+ * @param buf the text buffer.
+ * @param data the bytes.
+ * @param size the number of bytes.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static int
+append_bytes(TextBuffer *buf, const char *data, size_t size)
+{
+    if (!text_buffer_reserve(buf, size)) {
+        return 0;
+    }
+    memcpy(buf->data + buf->size, data, size);
+    buf->size += size;
+    return 1;
+}
+
+/**
+ * Parses the complete lines of a streamed chunk of coordinate pairs; the incomplete line at the end of the chunk is
+ * kept for the next chunk.
+ * @param list the list the parsed cells are appended to.
+ * @param pending the incomplete line of the previous chunk; replaced by the one of this chunk.
+ * @param data the chunk.
+ * @param size the size of the chunk.
+ * @param pool a thread pool used to parse large chunks in parallel, or NULL.
+ * @return true if the lines were parsed successfully, false otherwise.
+ */
+static int
+append_lines(CellList *list, TextBuffer *pending, const char *data, size_t size, ThreadPool *pool)
+{
+    const char *first, *last;
+
+    first = memchr(data, '\n', size);
+    if (first == NULL) {
+        return append_bytes(pending, data, size);
+    }
+    for (last = data + size - 1; *last != '\n'; --last);
+
+    // the first line of the chunk completes the pending one
+    if (!append_bytes(pending, data, first + 1 - data) || !append_text(list, pending->data, pending->size, NULL)) {
+        return 0;
+    }
+    pending->size = 0;
+
+    if (!append_text(list, first + 1, last - first, pool)) {
+        return 0;
+    }
+    return append_bytes(pending, last + 1, data + size - (last + 1));
+}
+
+/**
+ * Determines whether the beginning of an input is a list of coordinate pairs once the header comments are skipped.
+ * @param data the beginning of the input.
+ * @param size the size of the beginning of the input.
+ * @param complete a flag indicating that the input ends here.
+ * @param body an output parameter for the offset of the first line which is not a comment.
+ * @return 1 for coordinate pairs, 0 for any other input, -1 if more of the input is needed to tell.
+ */
+static int
+is_text(const char *data, size_t size, int complete, size_t *body)
+{
+    const char *p, *end = data + size;
+    InputFormat format;
+
+    format = cell_reader_sniff(data, size, body);
+    if (!complete && memchr(data + *body, '\n', size - *body) == NULL) {
+        return -1;
+    }
+    if (format != INPUT_TEXT) {
+        return 0;
+    }
+
+    for (p = data + *body; p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'); ++p);
+    return p == end || *p == '-' || *p == '+' || (unsigned int)((unsigned char)*p - '0') < 10;
+}
+
+int
+cell_reader_parse_stream(CellList *list, int fd, ThreadPool *pool, char **raw, size_t *raw_size)
+{
+    InputStream *in;
+    TextBuffer head, pending;
+    const char *chunk;
+    size_t size, body;
+    int ok, text = -1;
+
+    list->cells = NULL;
+    list->num_cells = 0;
+    *raw = NULL;
+    *raw_size = 0;
+
+    if (!text_buffer_init(&head, 1 << 12)) {
+        return 0;
+    }
+    if (!text_buffer_init(&pending, 1 << 12)) {
+        text_buffer_destroy(&head);
+        return 0;
+    }
+    in = input_stream_create(fd, STREAM_CHUNK_SIZE);
+    if (in == NULL) {
+        text_buffer_destroy(&head);
+        text_buffer_destroy(&pending);
+        return 0;
+    }
+
+    // parse every chunk while the stream reads the next one
+    while ((ok = input_stream_next(in, &chunk, &size)) && size > 0) {
+        if (text == 1) {
+            ok = append_lines(list, &pending, chunk, size, pool);
+        } else {
+            // collect the beginning of the input until its format is known, other inputs entirely
+            ok = append_bytes(&head, chunk, size);
+            if (ok && text == -1 && (text = is_text(head.data, head.size, 0, &body)) == 1) {
+                ok = append_lines(list, &pending, head.data + body, head.size - body, pool);
+                text_buffer_destroy(&head);
+            }
+        }
+        if (!ok) {
+            break;
+        }
+    }
+
+    input_stream_destroy(in);
+
+    if (ok && text == -1 && (text = is_text(head.data, head.size, 1, &body)) == 1) {
+        ok = append_bytes(&pending, head.data + body, head.size - body);
+    }
+
+    if (ok && text == 1) {
+        // the input may end without a newline
+        ok = append_text(list, pending.data, pending.size, pool);
+    } else if (ok) {
+        *raw = head.data;
+        *raw_size = head.size;
+        head.data = NULL;
+    }
+
+    text_buffer_destroy(&head);
+    text_buffer_destroy(&pending);
+
+    if (!ok) {
+        cell_list_free(list);
+    }
+    return ok;
+}
+
+void
+cell_list_free(CellList *list)
+{
+    free(list->cells);
+    list->cells = NULL;
+    list->num_cells = 0;
+}
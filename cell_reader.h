@@ -0,0 +1,126 @@
+#ifndef CELL_READER_H
+#define CELL_READER_H
+
+#include <stdlib.h>
+
+#include "life.h"
+#include "thread_pool.h"
+
+/**
+ * Parsers for the input formats of the game of life; they turn the (mapped) content of an input file into a plain
+ * array of coordinates, which the engines put into their tables in bulk.
+ */
+
+/**
+ * The input formats recognized by cell_reader_sniff().
+ */
+typedef enum input_format {
+
+    /**
+     * Plain coordinate pairs ("x y", one per line), optionally preceded by '#' comment lines; this includes
+     * Life 1.06 ("#Life 1.06" header).
+     */
+    INPUT_TEXT,
+
+    /**
+     * Run length encoded ("x = .., y = .., rule = .." header line followed by runs of b, o and $ up to !).
+     */
+    INPUT_RLE
+
+} InputFormat;
+
+/**
+ * Define signature for functions receiving horizontal runs of alive cells.
+ * @param arg the argument passed to the decoder.
+ * @param x the X coordinate of the leftmost cell of the run.
+ * @param y the Y coordinate of the run.
+ * @param len the number of cells of the run.
+ */
+typedef void run_function(void *arg, long x, long y, long len);
+
+/**
+ * a type representing a list of cells.
+ */
+typedef struct cell_list {
+
+    /**
+     * The coordinates of the cells.
+     */
+    Point2D *cells;
+
+    /**
+     * The number of cells.
+     */
+    size_t num_cells;
+
+} CellList;
+
+/**
+ * Parses a list of coordinate pairs ("x y", one per line; blank lines are skipped).
+ * Large inputs are split at line boundaries and parsed by all threads of a pool.
+ * @param list a pointer to an allocated cell list instance; the cells are allocated on the heap.
+ * @param data the text.
+ * @param size the size of the text.
+ * @param pool a thread pool used to parse large inputs in parallel, or NULL.
+ * @return true if the text was parsed successfully, false on a syntax error or if memory ran out.
+ */
+int
+cell_reader_parse_text(CellList *list, const char *data, size_t size, ThreadPool *pool);
+
+/**
+ * Determines the format of an input by its content and skips its header comments.
+ * @param data the input.
+ * @param size the size of the input.
+ * @param body an output parameter for the offset of the first line which is not a comment.
+ * @return the input format.
+ */
+InputFormat
+cell_reader_sniff(const char *data, size_t size, size_t *body);
+
+/**
+ * Decodes a run length encoded pattern; rows are counted downwards from y = 0, columns from x = 0.
+ * Only the rule of Conway's game of life (B3/S23) is accepted.
+ * @param data the pattern, starting with the header line.
+ * @param size the size of the pattern.
+ * @param f the function receiving the runs of alive cells.
+ * @param arg the argument passed to f.
+ * @return true if the pattern was decoded successfully, false on a syntax error or an unsupported rule.
+ */
+int
+cell_reader_decode_rle(const char *data, size_t size, run_function *f, void *arg);
+
+/**
+ * Parses an input in any of the supported formats (see cell_reader_sniff()).
+ * @param list a pointer to an allocated cell list instance; the cells are allocated on the heap.
+ * @param data the input.
+ * @param size the size of the input.
+ * @param pool a thread pool used to parse large inputs in parallel, or NULL.
+ * @return true if the input was parsed successfully, false otherwise.
+ */
+int
+cell_reader_parse(CellList *list, const char *data, size_t size, ThreadPool *pool);
+
+/**
+ * Reads an input which cannot be mapped into memory (a pipe) in large chunks; a background thread reads the next
+ * chunk while the current one is parsed. Coordinate pairs (including Life 1.06) are parsed chunk by chunk, lines
+ * straddling two chunks are carried over to the next one. Any other input (RLE, binary snapshots) is collected and
+ * returned to the caller.
+ * @param list a pointer to an allocated cell list instance; the cells are allocated on the heap.
+ * @param fd the file descriptor to read from.
+ * @param pool a thread pool used to parse large chunks in parallel, or NULL.
+ * @param raw an output parameter for the whole input if it is no list of coordinate pairs (allocated on the heap, to be
+ * freed by the caller), NULL otherwise.
+ * @param raw_size an output parameter for the size of the raw input.
+ * @return true on success, false if reading failed (errno is set), on a syntax error or if memory ran out.
+ */
+int
+cell_reader_parse_stream(CellList *list, int fd, ThreadPool *pool, char **raw, size_t *raw_size);
+
+/**
+ * Frees the cells of a cell list.
+ * @param list the cell list.
+ */
+void
+cell_list_free(CellList *list);
+
+#endif
@@ -0,0 +1,360 @@
+
+#include "cell_set.h"
+
+#include <assert.h>
+
+/**
+ * Fowler-Noll-Vo 32-bit constants
+ * @see https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
+ */
+#define FNV_32_PRIME 16777619u
+#define FNV_32_BASIS 2166136261u
+
+/**
+ * Calculates a Fowler-Noll-Vo (FNV) 32-bit hash value of a packed key.
+ * @param key the packed key
+ * @return the calculated FNV hash value.
+ */
+static inline unsigned int
+hash_key(uint64_t key)
+{
+    unsigned int hash;
+    int i;
+
+    hash = FNV_32_BASIS;
+    for (i = 0; i < 8; ++i) {
+        hash = (hash * FNV_32_PRIME) ^ (unsigned char)(key >> (i * 8));
+    }
+
+    return hash;
+}
+
+/**
+ * Packs the coordinates of a 2D point into a single key.
+ * @param p the point
+ * @return the packed key.
+ */
+static inline uint64_t
+pack_point2d(const Point2D *p)
+{
+    return ((uint64_t)(uint32_t)p->x << 32) | (uint32_t)p->y;
+}
+
+/**
+ * Unpacks a key into a 2D point.
+ * @param key the packed key
+ * @param p the point to write
+ */
+static inline void
+unpack_point2d(uint64_t key, Point2D *p)
+{
+    p->x = (int32_t)(key >> 32);
+    p->y = (int32_t)key;
+}
+
+/**
+ * Checks if a number is a power of two.
+ * @param n the number to check.
+ * @return true if n is a power of two, false otherwise.
+ */
+static inline int
+is_pow2(size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * Rounds a number to the next power of two.
+ * @param n the number to round.
+ * @return the next power of two greather than n.
+ */
+static inline size_t
+ceil_pow2(size_t n)
+{
+    while (!is_pow2(n)) {
+        n = (n & (n - 1));
+    }
+    return n;
+}
+
+/**
+ * Returns the bucket index for a given hash value.
+ * @param hash_val the hash value
+ * @param num_buckets the total number of buckets
+ * @return the bucket index.
+ */
+static inline size_t
+bucket_idx(unsigned int hash_val, size_t num_buckets)
+{
+    assert(is_pow2(num_buckets));
+    return hash_val & (num_buckets - 1);
+}
+
+/**
+ * Returns the index of the next bucket to probe.
+ * @param idx the prev. checked index which caused a conflict
+ * @param num_buckets the total number of buckets
+ * @return the index of the next bucket to probe.
+ */
+static inline size_t
+probe(size_t idx, size_t num_buckets) {
+    return (idx + 1) & (num_buckets - 1); // linear probing
+}
+
+/**
+ * Calculates the probe distance for a cell set element, i.e. the distance between its desired and its actual bucket.
+ * @param elem the cell set element.
+ * @param idx the actual index.
+ * @param num_buckets the total number of buckets.
+ * @return the probe distance.
+ */
+static inline size_t
+probe_dist(CellSetElem *elem, size_t idx, size_t num_buckets)
+{
+    assert(is_pow2(num_buckets));
+    return (idx + num_buckets - bucket_idx(elem->hash_val, num_buckets)) & (num_buckets - 1);
+}
+
+/**
+ * Look up a cell set element by key.
+ * @param set the cell set.
+ * @param key the packed key.
+ * @param start_idx the bucket index for starting the search.
+ * @return the found cell set element or NULL if no element with given key is stored in the cell set.
+ */
+static inline CellSetElem *
+find_elem(CellSet *set, uint64_t key, size_t start_idx)
+{
+    size_t dist = 0;
+    size_t idx = start_idx;
+    CellSetElem *elem = &set->buckets[idx];
+
+    while (elem->is_occupied && dist < set->num_buckets) {
+        if (elem->key == key) {
+            return elem;
+        }
+
+        // stop searching when we found an element with lower probe distance
+        if (probe_dist(elem, idx, set->num_buckets) < dist) {
+            break;
+        }
+
+        // try next bucket
+        idx = probe(idx, set->num_buckets);
+        elem = &set->buckets[idx];
+        ++dist;
+    }
+
+    return NULL;
+}
+
+/**
+ * Inserts an element (known not to be present yet) into a bucket array using robin hood hashing.
+ * @param buckets the bucket array.
+ * @param num_buckets the number of buckets.
+ * @param elem_insert the element to insert.
+ */
+static inline void
+insert_elem(CellSetElem *buckets, size_t num_buckets, CellSetElem elem_insert)
+{
+    size_t idx, dist, dist_elem;
+    CellSetElem tmp, *elem;
+
+    idx = bucket_idx(elem_insert.hash_val, num_buckets);
+    elem = &buckets[idx];
+    dist = 0;
+    while (elem->is_occupied) {
+        // swap elements if probe difference is higher (robin hood hashing)
+        dist_elem = probe_dist(elem, idx, num_buckets);
+        if (dist_elem < dist) {
+            tmp = *elem;
+            *elem = elem_insert;
+            elem_insert = tmp;
+            dist = dist_elem;
+        }
+
+        idx = probe(idx, num_buckets);
+        elem = &buckets[idx];
+        ++dist;
+    }
+
+    // write empty bucket
+    *elem = elem_insert;
+}
+
+/**
+ * Looks for the next occupied element in the cell set.
+ * @param set the cell set.
+ * @param prev_idx the index of the prev. element.
+ * @return the index of the next occupied element, or num_buckets if there is none.
+ */
+static inline size_t
+next_elem_idx(CellSet *set, size_t prev_idx)
+{
+    size_t idx;
+
+    for (idx = prev_idx + 1; idx < set->num_buckets; ++idx) {
+        if (set->buckets[idx].is_occupied) {
+            break;
+        }
+    }
+
+    return idx;
+}
+
+/**
+ * Calculates the current load factor.
+ * @return the current load factor
+ */
+static inline float
+current_load(CellSet *set)
+{
+    return (float)set->num_elems / set->num_buckets;
+}
+
+/**
+ * Rehashes the cell set with a new bucket array twice the size.
+ * @param set the cell set to rehash
+ * @return true if the operation succeeded, false otherwise
+ */
+static int
+rehash(CellSet *set)
+{
+    CellSetElem *new_buckets;
+    size_t new_num_buckets, idx;
+
+    // allocate new bucket array
+    new_num_buckets = set->num_buckets * 2;
+    new_buckets = calloc(new_num_buckets, sizeof(CellSetElem));
+    if (new_buckets == NULL) {
+        return 0;
+    }
+
+    // perform rehashing
+    for (idx = 0; idx < set->num_buckets; ++idx) {
+        if (set->buckets[idx].is_occupied) {
+            insert_elem(new_buckets, new_num_buckets, set->buckets[idx]);
+        }
+    }
+
+    free(set->buckets);
+    set->num_buckets = new_num_buckets;
+    set->buckets = new_buckets;
+
+    return 1;
+}
+
+CellSet *
+cell_set_create(size_t num_buckets, float load_factor)
+{
+    if (load_factor <= 0 || load_factor >= 1) {
+        return NULL;
+    }
+
+    // allocate cell set first
+    CellSet *set = malloc(sizeof(CellSet));
+    if (set == NULL) {
+        return NULL;
+    }
+
+    // round no. of buckets to next power of two
+    num_buckets = ceil_pow2(num_buckets);
+
+    // allocate buckets
+    set->buckets = calloc(num_buckets, sizeof(CellSetElem));
+    if (set->buckets == NULL) {
+        free(set);
+        return NULL;
+    }
+
+    set->num_buckets = num_buckets;
+    set->load_factor = load_factor;
+    set->num_elems = 0;
+
+    return set;
+}
+
+int
+cell_set_put(CellSet *set, const Point2D *key)
+{
+    CellSetElem elem_insert;
+
+    elem_insert.key = pack_point2d(key);
+    elem_insert.hash_val = hash_key(elem_insert.key);
+    elem_insert.is_occupied = 1;
+
+    // nothing to do if the cell is already present
+    if (find_elem(set, elem_insert.key, bucket_idx(elem_insert.hash_val, set->num_buckets)) != NULL) {
+        return 1;
+    }
+
+    // grow and rehash if load factor reached defined threshold
+    if (current_load(set) > set->load_factor && !rehash(set)) {
+        return 0;
+    }
+
+    insert_elem(set->buckets, set->num_buckets, elem_insert);
+    set->num_elems++;
+
+    return 1;
+}
+
+int
+cell_set_contains(CellSet *set, const Point2D *key)
+{
+    uint64_t packed_key = pack_point2d(key);
+    size_t idx = bucket_idx(hash_key(packed_key), set->num_buckets);
+    return find_elem(set, packed_key, idx) != NULL;
+}
+
+void
+cell_set_clear(CellSet *set)
+{
+    size_t idx;
+
+    for (idx = 0; idx < set->num_buckets; ++idx) {
+        set->buckets[idx].is_occupied = 0;
+    }
+
+    set->num_elems = 0;
+}
+
+size_t
+cell_set_size(CellSet *set)
+{
+    return set->num_elems;
+}
+
+void
+cell_set_destroy(CellSet *set)
+{
+    free(set->buckets);
+    free(set);
+}
+
+void
+cell_set_iter_init(CellSet *set, CellSetIter *iter)
+{
+    iter->set = set;
+    iter->current_idx = -1;
+    iter->next_idx = (set->num_elems == 0) ? set->num_buckets : next_elem_idx(set, -1);
+}
+
+int
+cell_set_iter_has_next(CellSetIter *iter)
+{
+    return iter->next_idx < iter->set->num_buckets;
+}
+
+void
+cell_set_iter_next(CellSetIter *iter)
+{
+    iter->current_idx = iter->next_idx;
+    iter->next_idx = next_elem_idx(iter->set, iter->current_idx);
+}
+
+void
+cell_set_iter_get(CellSetIter *iter, Point2D *out_key)
+{
+    unpack_point2d(iter->set->buckets[iter->current_idx].key, out_key);
+}
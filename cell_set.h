@@ -0,0 +1,168 @@
+#ifndef CELL_SET_H
+#define CELL_SET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "life.h"
+
+/**
+ * A set-only variant of the cell table: buckets store nothing but the packed coordinates of a cell (plus the
+ * metadata needed for robin hood probing), i.e. there is no Cell payload at all.
+ *
+ * Coordinates are packed into 32 bits each, so they must be in the range of a 32-bit integer.
+ */
+
+/**
+ * a type representing a cell set element.
+ */
+typedef struct cell_set_elem {
+
+    /**
+     * The packed coordinates (x in the upper, y in the lower 32 bits).
+     */
+    uint64_t key;
+
+    /**
+     * The original hash value of the key.
+     */
+    unsigned int hash_val;
+
+    /**
+     * a flag indicating if the element is occupied.
+     */
+    unsigned int is_occupied;
+
+} CellSetElem;
+
+/**
+ * a type representing the cell set.
+ */
+typedef struct cell_set {
+
+    /**
+     * The number of buckets.
+     */
+    size_t num_buckets;
+
+    /**
+     * a factor that controls growing + rehashing of the cell set.
+     */
+    float load_factor;
+
+    /**
+     * The number of elements currently stored in the set.
+     */
+    size_t num_elems;
+
+    /**
+     * The buckets.
+     */
+    CellSetElem *buckets;
+
+} CellSet;
+
+/**
+ * a type representing the cell set iterator.
+ */
+typedef struct cell_set_iter {
+
+    /**
+     * The cell set the iterator iterates over.
+     */
+    CellSet *set;
+
+    /**
+     * The bucket index of the element the iterator currently points at.
+     */
+    size_t current_idx;
+
+    /**
+     * The bucket index of the element the iterator points next (num_buckets if there is none).
+     */
+    size_t next_idx;
+
+} CellSetIter;
+
+/**
+ * Creates a cell set.
+ * @param num_buckets the number of buckets to allocate.
+ * @param load_factor a factor controlling growing / rehashing of the cell set.
+ * @return a pointer to the cell set created on the heap.
+ */
+CellSet *
+cell_set_create(size_t num_buckets, float load_factor);
+
+/**
+ * Adds a cell to the cell set.
+ * @param set the cell set.
+ * @param key the coordinates of the cell.
+ * @return true if the cell was added successfully (or already present), false otherwise.
+ */
+int
+cell_set_put(CellSet *set, const Point2D *key);
+
+/**
+ * Checks if the cell set contains a cell.
+ * @param set the cell set.
+ * @param key the coordinates of the cell.
+ * @return true if the cell set contains the cell, false otherwise.
+ */
+int
+cell_set_contains(CellSet *set, const Point2D *key);
+
+/**
+ * Removes all cells from the cell set.
+ * @param set the cell set.
+ */
+void
+cell_set_clear(CellSet *set);
+
+/**
+ * Returns the no. of cells the cell set contains.
+ * @param set the cell set
+ * @return the number of cells the cell set contains.
+ */
+size_t
+cell_set_size(CellSet *set);
+
+/**
+ * Destroys a cell set and frees all resources.
+ * @param set the cell set.
+ */
+void
+cell_set_destroy(CellSet *set);
+
+/**
+ * Initializes a cell set iterator.
+ * WARNING: do not alter the cell set upon iteration!
+ * @param set the cell set.
+ * @param iter a pointer to an allocated cell set iterator instance.
+ */
+void
+cell_set_iter_init(CellSet *set, CellSetIter *iter);
+
+/**
+ * Check whether the iterator can deliver a next cell.
+ * @param iter the cell set iterator.
+ * @return true if the iterator can return a next cell, false otherwise.
+ */
+int
+cell_set_iter_has_next(CellSetIter *iter);
+
+/**
+ * Moves the iterator one step to the next cell.
+ * @param iter the cell set iterator.
+ */
+void
+cell_set_iter_next(CellSetIter *iter);
+
+/**
+ * Returns the coordinates of the cell an iterator currently points at.
+ * @param iter the cell set iterator.
+ * @param out_key an output parameter for the coordinates.
+ */
+void
+cell_set_iter_get(CellSetIter *iter, Point2D *out_key);
+
+#endif
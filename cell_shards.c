@@ -0,0 +1,129 @@
+
+#include "cell_shards.h"
+
+/**
+ * Records the coordinates of an edge cell.
+ * @param shard the shard the cell belongs to.
+ * @param key the cell's coordinates.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static int
+add_edge(CellShard *shard, const Point2D *key)
+{
+    Point2D *new_edges;
+    size_t new_max_edges;
+
+    if (shard->num_edges == shard->max_edges) {
+        new_max_edges = shard->max_edges == 0 ? 1024 : shard->max_edges * 2;
+        new_edges = realloc(shard->edges, new_max_edges * sizeof(Point2D));
+        if (new_edges == NULL) {
+            return 0;
+        }
+        shard->edges = new_edges;
+        shard->max_edges = new_max_edges;
+    }
+
+    shard->edges[shard->num_edges++] = *key;
+    return 1;
+}
+
+CellShards *
+cell_shards_create(size_t num_shards, unsigned int stripe_bits, size_t num_buckets, float load_factor)
+{
+    CellShards *s;
+    size_t i;
+
+    s = malloc(sizeof(CellShards));
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->shards = calloc(num_shards, sizeof(CellShard));
+    if (s->shards == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    s->num_shards = num_shards;
+    s->stripe_bits = stripe_bits;
+
+    for (i = 0; i < num_shards; ++i) {
+        s->shards[i].tbl = cell_table_create(num_buckets, load_factor);
+        if (s->shards[i].tbl == NULL) {
+            cell_shards_destroy(s);
+            return NULL;
+        }
+    }
+
+    return s;
+}
+
+int
+cell_shards_put(CellShards *s, const Point2D *key, const Cell *value)
+{
+    CellShard *shard = &s->shards[cell_shards_idx(s, key->y)];
+    Cell *c;
+
+    c = cell_table_get_or_put(shard->tbl, key, value);
+    if (c == NULL) {
+        return 0;
+    }
+
+    // record new cells in the edge rows only once
+    if (c == value && cell_shards_is_edge(s, key->y)) {
+        return add_edge(shard, key);
+    }
+
+    return 1;
+}
+
+int
+cell_shards_contains(CellShards *s, const Point2D *key)
+{
+    return cell_table_contains(s->shards[cell_shards_idx(s, key->y)].tbl, key);
+}
+
+size_t
+cell_shards_size(CellShards *s)
+{
+    size_t i, size = 0;
+
+    for (i = 0; i < s->num_shards; ++i) {
+        size += cell_table_size(s->shards[i].tbl);
+    }
+
+    return size;
+}
+
+void
+cell_shards_clear_shard(CellShards *s, size_t idx)
+{
+    cell_table_clear(s->shards[idx].tbl);
+    s->shards[idx].num_edges = 0;
+}
+
+void
+cell_shards_clear(CellShards *s)
+{
+    size_t i;
+
+    for (i = 0; i < s->num_shards; ++i) {
+        cell_shards_clear_shard(s, i);
+    }
+}
+
+void
+cell_shards_destroy(CellShards *s)
+{
+    size_t i;
+
+    for (i = 0; i < s->num_shards; ++i) {
+        if (s->shards[i].tbl != NULL) {
+            cell_table_destroy(s->shards[i].tbl);
+        }
+        free(s->shards[i].edges);
+    }
+
+    free(s->shards);
+    free(s);
+}
@@ -0,0 +1,154 @@
+#ifndef CELL_SHARDS_H
+#define CELL_SHARDS_H
+
+#include <stdlib.h>
+
+#include "cell_table.h"
+#include "life.h"
+
+/**
+ * A cell store split into shards by horizontal stripes: the plane is cut into stripes of 2^stripe_bits rows, and
+ * the stripes are dealt out to the shards round robin (stripe s belongs to shard s mod num_shards). Every shard is
+ * a cell table of its own, so distinct shards may be written by distinct threads at the same time.
+ *
+ * The stripes adjacent to a stripe of shard k belong to the shards k - 1 and k + 1, so a shard only depends on the
+ * cells in the edge rows (first and last row of a stripe) of these two shards; these are recorded per shard.
+ */
+
+/**
+ * a type representing a single shard.
+ */
+typedef struct cell_shard {
+
+    /**
+     * The cells of the shard.
+     */
+    CellTable *tbl;
+
+    /**
+     * The coordinates of the cells in the first or last row of a stripe (the halo of the neighbor shards).
+     */
+    Point2D *edges;
+
+    /**
+     * The number of edge cells.
+     */
+    size_t num_edges;
+
+    /**
+     * The capacity of the edges array.
+     */
+    size_t max_edges;
+
+} CellShard;
+
+/**
+ * a type representing the sharded cell store.
+ */
+typedef struct cell_shards {
+
+    /**
+     * The number of shards.
+     */
+    size_t num_shards;
+
+    /**
+     * The height of a stripe is 2^stripe_bits rows.
+     */
+    unsigned int stripe_bits;
+
+    /**
+     * The shards.
+     */
+    CellShard *shards;
+
+} CellShards;
+
+/**
+ * Creates a sharded cell store.
+ * @param num_shards the number of shards.
+ * @param stripe_bits the height of a stripe is 2^stripe_bits rows.
+ * @param num_buckets the (initial) number of buckets of every shard's cell table (must be a power of 2).
+ * @param load_factor a factor that controls growing + rehashing of the shards' cell tables.
+ * @return a pointer to the store created on the heap, or NULL on failure.
+ */
+CellShards *
+cell_shards_create(size_t num_shards, unsigned int stripe_bits, size_t num_buckets, float load_factor);
+
+/**
+ * Returns the index of the shard a row belongs to.
+ * @param s the sharded cell store.
+ * @param y the Y coordinate of the row.
+ * @return the shard index.
+ */
+static inline size_t
+cell_shards_idx(const CellShards *s, long y)
+{
+    long idx = (y >> s->stripe_bits) % (long)s->num_shards;
+    return idx < 0 ? idx + s->num_shards : idx;
+}
+
+/**
+ * Checks whether a row is the first or last row of a stripe.
+ * @param s the sharded cell store.
+ * @param y the Y coordinate of the row.
+ * @return true if the row is an edge row, false otherwise.
+ */
+static inline int
+cell_shards_is_edge(const CellShards *s, long y)
+{
+    long row = y & ((1L << s->stripe_bits) - 1);
+    return row == 0 || row == (1L << s->stripe_bits) - 1;
+}
+
+/**
+ * Puts a cell into the shard its coordinates belong to.
+ * Threads may put cells concurrently as long as they put them into distinct shards.
+ * @param s the sharded cell store.
+ * @param key the cell's coordinates.
+ * @param value the cell.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+cell_shards_put(CellShards *s, const Point2D *key, const Cell *value);
+
+/**
+ * Checks whether the store contains a cell.
+ * @param s the sharded cell store.
+ * @param key the cell's coordinates.
+ * @return true if the cell is contained, false otherwise.
+ */
+int
+cell_shards_contains(CellShards *s, const Point2D *key);
+
+/**
+ * Returns the number of cells stored in all shards.
+ * @param s the sharded cell store.
+ * @return the number of cells.
+ */
+size_t
+cell_shards_size(CellShards *s);
+
+/**
+ * Removes all cells from a single shard.
+ * @param s the sharded cell store.
+ * @param idx the shard index.
+ */
+void
+cell_shards_clear_shard(CellShards *s, size_t idx);
+
+/**
+ * Removes all cells from all shards.
+ * @param s the sharded cell store.
+ */
+void
+cell_shards_clear(CellShards *s);
+
+/**
+ * Frees all resources allocated for the store.
+ * @param s the sharded cell store.
+ */
+void
+cell_shards_destroy(CellShards *s);
+
+#endif
@@ -2,6 +2,7 @@
 #include "cell_table.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -12,6 +13,18 @@
 #define FNV_32_PRIME 16777619u
 #define FNV_32_BASIS 2166136261u
 
+/**
+ * States of a bucket (is_occpuied) besides the epoch it was occupied in; buckets are only claimed during concurrent
+ * insertion, while the claiming thread writes the entry.
+ */
+#define BUCKET_EMPTY    0
+#define BUCKET_CLAIMED  -1
+
+/**
+ * The last epoch before the epochs wrap around (see cell_table_clear()).
+ */
+#define EPOCH_MAX INT_MAX
+
 /**
  * Calculates a Fowler-Noll-Vo (FNV) 32-bit hash value of arbitrary data.
  * @param data the data to hash
@@ -93,6 +106,18 @@ bucket_idx(unsigned int hash_val, size_t num_buckets)
     return hash_val & (num_buckets - 1);
 }
 
+/**
+ * Checks if a cell table element is occupied, i.e. it was occupied in the current epoch of its table.
+ * @param elem the cell table element.
+ * @param epoch the current epoch of the table.
+ * @return true if the element is occupied, false otherwise.
+ */
+static inline int
+is_occupied(const CellTableElem *elem, int epoch)
+{
+    return elem->is_occpuied == epoch;
+}
+
 /**
  * Writes key and value to a cell table entry.
  * @param e the cell table entry to write
@@ -147,54 +172,94 @@ probe_dist(CellTableElem *elem, size_t idx, size_t num_buckets)
 }
 
 /**
- * Look up a cell table element by key.
- * @param tbl the cell table.
+ * Look up a cell table element by key in a bucket array.
+ * @param buckets the bucket array.
+ * @param num_buckets the number of buckets.
  * @param key the key.
  * @param start_idx the bucket index for starting the search.
- * @return the found cell table element or NULL if no element with given key is stored in the cell table.
+ * @param epoch the current epoch of the table.
+ * @return the found cell table element or NULL if no element with given key is stored in the bucket array.
  */
 static inline CellTableElem *
-find_elem(CellTable *tbl, const Point2D *key, size_t start_idx)
+find_elem_in(CellTableElem *buckets, size_t num_buckets, const Point2D *key, size_t start_idx, int epoch)
 {
     size_t dist = 0;
     size_t idx = start_idx;
-    CellTableElem *elem = &tbl->buckets[idx];
+    CellTableElem *elem = &buckets[idx];
 
-    while (elem->is_occpuied && dist < tbl->num_buckets) {
+    while (is_occupied(elem, epoch) && dist < num_buckets) {
         if (point2d_cmp(&elem->entry.key, key) == 0) {
             return elem;
         }
 
         // stop searching when we found an element with lower probe distance
-        if (probe_dist(elem, idx, tbl->num_buckets) < dist) {
+        if (probe_dist(elem, idx, num_buckets) < dist) {
             break;
         }
 
         // try next bucket
-        idx = probe(idx, tbl->num_buckets);
-        elem = &tbl->buckets[idx];
+        idx = probe(idx, num_buckets);
+        elem = &buckets[idx];
         ++dist;
     }
 
     return NULL;
 }
 
+/**
+ * Look up a cell table element by key.
+ * @param tbl the cell table.
+ * @param key the key.
+ * @param hash_val the hash value of the key.
+ * @return the found cell table element or NULL if no element with given key is stored in the cell table.
+ */
+static inline CellTableElem *
+find_elem(CellTable *tbl, const Point2D *key, unsigned int hash_val)
+{
+    CellTableElem *elem;
+
+    elem = find_elem_in(tbl->buckets, tbl->num_buckets, key, bucket_idx(hash_val, tbl->num_buckets), tbl->epoch);
+
+    // during an incremental rehash, a key not found in the new buckets may not have been migrated yet
+    // (a migrated key is always found in the new buckets first)
+    if (elem == NULL && tbl->old_buckets != NULL) {
+        elem = find_elem_in(tbl->old_buckets, tbl->old_num_buckets, key, bucket_idx(hash_val, tbl->old_num_buckets),
+                            tbl->epoch);
+    }
+
+    return elem;
+}
+
 /**
  * Looks for the next occupied element in the cell table.
  * @param tbl the cell table.
  * @param prev_idx the index of the prev. element.
+ * @param end_idx the bucket index to stop at (exclusive).
  * @param out_elem an output parameter for the found element.
  * @param out_idx an output parameter for the found element's bucket index.
  */
 static void
-next_elem_iter(CellTable *tbl, size_t prev_idx, CellTableElem **out_elem, size_t *out_idx)
+next_elem_iter(CellTable *tbl, size_t prev_idx, size_t end_idx, CellTableElem **out_elem, size_t *out_idx)
 {
     size_t idx;
     CellTableElem *elem;
 
-    for (idx = prev_idx + 1; idx < tbl->num_buckets; ++idx) {
+    for (idx = prev_idx + 1; idx < end_idx && idx < tbl->num_buckets; ++idx) {
         elem = &tbl->buckets[idx];
-        if (elem->is_occpuied) {
+        if (is_occupied(elem, tbl->epoch)) {
+            *out_elem = elem;
+            *out_idx = idx;
+            return;
+        }
+    }
+
+    // the old buckets of an incremental rehash follow, the migrated ones are skipped
+    if (idx < tbl->num_buckets + tbl->migrate_idx) {
+        idx = tbl->num_buckets + tbl->migrate_idx;
+    }
+    for (; idx < end_idx; ++idx) {
+        elem = &tbl->old_buckets[idx - tbl->num_buckets];
+        if (is_occupied(elem, tbl->epoch)) {
             *out_elem = elem;
             *out_idx = idx;
             return;
@@ -206,22 +271,52 @@ next_elem_iter(CellTable *tbl, size_t prev_idx, CellTableElem **out_elem, size_t
 }
 
 /**
- * Looks for the first occupied element in the cell table.
+ * Looks for the first occupied element in a range of buckets of the cell table.
  * @param tbl the cell table.
+ * @param begin_idx the bucket index to start at (inclusive).
+ * @param end_idx the bucket index to stop at (exclusive).
  * @param out_elem an output parameter for the found element.
  * @param out_idx an output parameter for the found element's bucket index.
  */
 static inline void
-first_elem_iter(CellTable *tbl, CellTableElem **out_elem, size_t *out_idx)
+first_elem_iter(CellTable *tbl, size_t begin_idx, size_t end_idx, CellTableElem **out_elem, size_t *out_idx)
 {
     if (tbl->num_elems == 0) {
         *out_elem = NULL;
         *out_idx = -1;
     } else {
-        next_elem_iter(tbl, -1, out_elem, out_idx);
+        next_elem_iter(tbl, begin_idx - 1, end_idx, out_elem, out_idx);
     }
 }
 
+/**
+ * Returns the number of bucket indices an iterator runs through (the buckets, followed by the old buckets).
+ * @param tbl the cell table.
+ * @return the number of bucket indices.
+ */
+static inline size_t
+iter_span(CellTable *tbl)
+{
+    return tbl->num_buckets + tbl->old_num_buckets;
+}
+
+/**
+ * Returns the smallest number of buckets that can take a number of elements without exceeding a load factor.
+ * @param num_elems the number of elements.
+ * @param load_factor the load factor.
+ * @return the number of buckets (a power of two).
+ */
+static inline size_t
+buckets_for(size_t num_elems, float load_factor)
+{
+    size_t num_buckets = 1;
+
+    while ((float)num_elems / num_buckets > load_factor) {
+        num_buckets *= 2;
+    }
+    return num_buckets;
+}
+
 /**
  * Calculates the current load factor.
  * @return the current load factor
@@ -233,58 +328,190 @@ current_load(CellTable *tbl)
 }
 
 /**
- * Rehashes the hash table with a new bucket array twice the size.
- * @param tbl the hash table to rehash
+ * Sorts the elements of a cluster (a run of occupied buckets following an empty one) by their desired bucket,
+ * which restores the robin hood order after insertion without displacement.
+ * @param tbl the cell table.
+ * @param begin the index of the first bucket of the cluster.
+ * @param len the number of buckets of the cluster.
+ */
+static void
+sort_cluster(CellTable *tbl, size_t begin, size_t len)
+{
+    size_t mask = tbl->num_buckets - 1;
+    size_t i, j, home;
+    CellTableElem tmp;
+
+    // insertion sort, clusters are short
+    for (i = 1; i < len; ++i) {
+        memcpy(&tmp, &tbl->buckets[(begin + i) & mask], sizeof(CellTableElem));
+        home = (bucket_idx(tmp.hash_val, tbl->num_buckets) - begin) & mask;
+        for (j = i; j > 0; --j) {
+            CellTableElem *prev = &tbl->buckets[(begin + j - 1) & mask];
+            if (((bucket_idx(prev->hash_val, tbl->num_buckets) - begin) & mask) <= home) {
+                break;
+            }
+            memcpy(&tbl->buckets[(begin + j) & mask], prev, sizeof(CellTableElem));
+        }
+        memcpy(&tbl->buckets[(begin + j) & mask], &tmp, sizeof(CellTableElem));
+    }
+}
+
+/**
+ * Puts an element into a bucket array by robin hood insertion; its key must not be present yet.
+ * @param buckets the bucket array.
+ * @param num_buckets the number of buckets.
+ * @param elem_insert the element to insert (used as scratch space while displacing other elements).
+ * @param epoch the current epoch of the table.
+ */
+static inline void
+place_elem(CellTableElem *buckets, size_t num_buckets, CellTableElem *elem_insert, int epoch)
+{
+    size_t idx, dist, dist_elem;
+    CellTableElem *elem;
+
+    idx = bucket_idx(elem_insert->hash_val, num_buckets);
+    elem = &buckets[idx];
+    dist = 0;
+    while (is_occupied(elem, epoch)) {
+        // swap elements if probe difference is higher (robin hood hashing)
+        dist_elem = probe_dist(elem, idx, num_buckets);
+        if (dist_elem < dist) {
+            swap_elems(elem_insert, elem);
+            dist = dist_elem;
+        }
+
+        idx = probe(idx, num_buckets);
+        elem = &buckets[idx];
+        ++dist;
+    }
+
+    // write empty bucket
+    memcpy(elem, elem_insert, sizeof(CellTableElem));
+}
+
+/**
+ * Migrates old buckets of an incremental rehash into the buckets; the old bucket array is released when all of them
+ * are migrated. The old buckets are left untouched, so lookups of unmigrated keys still find them.
+ * @param tbl the cell table.
+ * @param num_old_buckets the (maximum) number of old buckets to migrate.
+ */
+static void
+migrate(CellTable *tbl, size_t num_old_buckets)
+{
+    size_t end_idx;
+    CellTableElem elem;
+
+    end_idx = tbl->old_num_buckets - tbl->migrate_idx > num_old_buckets
+              ? tbl->migrate_idx + num_old_buckets : tbl->old_num_buckets;
+
+    for (; tbl->migrate_idx < end_idx; ++tbl->migrate_idx) {
+        if (is_occupied(&tbl->old_buckets[tbl->migrate_idx], tbl->epoch)) {
+            memcpy(&elem, &tbl->old_buckets[tbl->migrate_idx], sizeof(CellTableElem));
+            place_elem(tbl->buckets, tbl->num_buckets, &elem, tbl->epoch);
+        }
+    }
+
+    if (tbl->migrate_idx == tbl->old_num_buckets) {
+        free(tbl->old_buckets);
+        tbl->old_buckets = NULL;
+        tbl->old_num_buckets = 0;
+        tbl->migrate_idx = 0;
+    }
+}
+
+/**
+ * Drops the old bucket array of an incremental rehash without migrating it (e.g. when the table is cleared).
+ * @param tbl the cell table.
+ */
+static inline void
+drop_old_buckets(CellTable *tbl)
+{
+    free(tbl->old_buckets);
+    tbl->old_buckets = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+}
+
+/**
+ * Replaces the bucket array by a new one; the elements are left in the old bucket array, to be migrated by migrate()
+ * (an incremental rehash still in progress is completed first).
+ * @param tbl the cell table.
+ * @param new_num_buckets the number of buckets of the new bucket array (a power of two).
  * @return true if the operation succeeded, false otherwise
  */
 static int
-rehash(CellTable *tbl)
+resize(CellTable *tbl, size_t new_num_buckets)
 {
     CellTableElem *new_buckets;
-    size_t new_num_buckets, idx, new_idx, dist, dist_elem;
-    CellTableElem *elem, *new_elem;
+
+    cell_table_finish_rehash(tbl);
 
     // allocate new bucket array
-    new_num_buckets = tbl->num_buckets * 2;
     new_buckets = calloc(new_num_buckets, sizeof(CellTableElem));
     if (new_buckets == NULL) {
         return 0;
     }
 
+    tbl->old_buckets = tbl->buckets;
+    tbl->old_num_buckets = tbl->num_buckets;
+    tbl->migrate_idx = 0;
+    tbl->buckets = new_buckets;
+    tbl->num_buckets = new_num_buckets;
+
+    return 1;
+}
+
+/**
+ * Rehashes the hash table with a new bucket array twice the size; in incremental mode, the elements are only
+ * migrated by the following insertions.
+ * @param tbl the hash table to rehash
+ * @return true if the operation succeeded, false otherwise
+ */
+static int
+rehash(CellTable *tbl)
+{
+    if (!resize(tbl, tbl->num_buckets * 2)) {
+        return 0;
+    }
+
     // perform rehashing
-    for (idx = 0; idx < tbl->num_buckets; ++idx) {
-        elem = &tbl->buckets[idx];
+    if (tbl->rehash_step == 0) {
+        cell_table_finish_rehash(tbl);
+    }
 
-        // skip empty buckets
-        if (!elem->is_occpuied) {
-            continue;
-        }
+    return 1;
+}
 
-        // get index of new bucket
-        new_idx = bucket_idx(elem->hash_val, new_num_buckets);
-        new_elem = &new_buckets[new_idx];
-
-        dist = 0;
-        while (new_elem->is_occpuied) {
-            // swap elements if probe difference is higher (robin hood hashing)
-            dist_elem = probe_dist(new_elem, new_idx, new_num_buckets);
-            if (dist_elem < dist) {
-                swap_elems(new_elem, elem);
-                dist = dist_elem;
-            }
+/**
+ * Inserts an entry whose key is known not to be present in the cell table yet.
+ * @param tbl the cell table.
+ * @param key the key.
+ * @param hash_val the hash value of the key.
+ * @param value the value.
+ * @return true if the entry was added successfully, false otherwise.
+ */
+static int
+insert_entry(CellTable *tbl, const Point2D *key, unsigned int hash_val, const Cell *value)
+{
+    CellTableElem elem_insert;
 
-            new_idx = probe(new_idx, new_num_buckets);
-            new_elem = &new_buckets[new_idx];
-            ++dist;
-        }
+    // grow and rehash if load factor reached defined threshold
+    if (current_load(tbl) > tbl->load_factor && !rehash(tbl)) {
+        return 0;
+    }
 
-        // write new bucket
-        memcpy(new_elem, elem, sizeof(CellTableElem));
+    // advance an incremental rehash in progress
+    if (tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->rehash_step);
     }
 
-    free(tbl->buckets);
-    tbl->num_buckets = new_num_buckets;
-    tbl->buckets = new_buckets;
+    // write entry to insert; new keys always go to the new buckets
+    write_entry(&elem_insert.entry, key, value);
+    elem_insert.hash_val = hash_val;
+    elem_insert.is_occpuied = tbl->epoch;
+    place_elem(tbl->buckets, tbl->num_buckets, &elem_insert, tbl->epoch);
+
+    tbl->num_elems++;
 
     return 1;
 }
@@ -315,73 +542,241 @@ cell_table_create(size_t num_buckets, float load_factor)
     tbl->num_buckets = num_buckets;
     tbl->load_factor = load_factor;
     tbl->num_elems = 0;
+    tbl->epoch = 1;
+    tbl->old_buckets = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+    tbl->rehash_step = 0;
 
     return tbl;
 }
 
+void
+cell_table_set_incremental_rehash(CellTable *tbl, int incremental)
+{
+    // a rehash starts with num_buckets * load_factor elements and is due again after as many insertions; migrating
+    // ceil(1 / load_factor) old buckets per insertion completes it in time
+    tbl->rehash_step = incremental ? (size_t)(1.0f / tbl->load_factor) + 1 : 0;
+    if (!incremental) {
+        cell_table_finish_rehash(tbl);
+    }
+}
+
+int
+cell_table_reserve(CellTable *tbl, size_t num_elems)
+{
+    size_t num_buckets = buckets_for(num_elems, tbl->load_factor);
+
+    if (num_buckets <= tbl->num_buckets) {
+        return 1;
+    }
+    if (!resize(tbl, num_buckets)) {
+        return 0;
+    }
+    cell_table_finish_rehash(tbl);
+    return 1;
+}
+
+int
+cell_table_shrink_to_fit(CellTable *tbl)
+{
+    size_t num_buckets = buckets_for(tbl->num_elems, tbl->load_factor);
+
+    if (num_buckets >= tbl->num_buckets) {
+        return 1;
+    }
+    if (!resize(tbl, num_buckets)) {
+        return 0;
+    }
+    cell_table_finish_rehash(tbl);
+    return 1;
+}
+
+void
+cell_table_finish_rehash(CellTable *tbl)
+{
+    if (tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->old_num_buckets);
+    }
+}
+
 int
 cell_table_put(CellTable *tbl, const Point2D *key, const Cell *value)
 {
     unsigned int hash_val;
-    size_t idx, dist, dist_elem;
-    CellTableElem elem_insert, *elem;
+    CellTableElem *elem;
 
     hash_val = hash_point2d(key);
-    idx = bucket_idx(hash_val, tbl->num_buckets);
 
     // check if we have to update an existing value first
-    elem = find_elem(tbl, key, idx);
+    elem = find_elem(tbl, key, hash_val);
     if (elem != NULL) {
         elem->entry.value = (Cell *)value;
         return 1;
     }
 
-    // grow and rehash if load factor reached defined threshold
-    if (current_load(tbl) > tbl->load_factor && !rehash(tbl)) {
+    return insert_entry(tbl, key, hash_val, value);
+}
+
+int
+cell_table_begin_concurrent(CellTable *tbl, size_t num_elems)
+{
+    if (!cell_table_reserve(tbl, num_elems)) {
         return 0;
     }
+    cell_table_finish_rehash(tbl);
+    return 1;
+}
 
-    // write entry to insert
-    write_entry(&elem_insert.entry, key, value);
-    elem_insert.hash_val = hash_val;
-    elem_insert.is_occpuied = 1;
+int
+cell_table_put_concurrent(CellTable *tbl, const Point2D *key, const Cell *value)
+{
+    unsigned int hash_val = hash_point2d(key);
+    size_t max_elems = (size_t)(tbl->num_buckets * tbl->load_factor);
+    size_t idx, dist;
+    CellTableElem *elem;
+    int state;
 
-    elem = &tbl->buckets[idx];
-    dist = 0;
-    while (elem->is_occpuied) {
-        // swap elements if probe difference is higher (robin hood hashing)
-        dist_elem = probe_dist(elem, idx, tbl->num_buckets);
-        if (dist_elem < dist) {
-            swap_elems(&elem_insert, elem);
-            dist = dist_elem;
+    idx = bucket_idx(hash_val, tbl->num_buckets);
+    for (dist = 0; dist < tbl->num_buckets; ++dist) {
+        elem = &tbl->buckets[idx];
+        state = __atomic_load_n(&elem->is_occpuied, __ATOMIC_ACQUIRE);
+
+        // a bucket of an earlier epoch is empty
+        if (state != tbl->epoch && state != BUCKET_CLAIMED) {
+            // reserve room for the element first, the table must not exceed its load factor
+            if (__atomic_add_fetch(&tbl->num_elems, 1, __ATOMIC_RELAXED) > max_elems) {
+                __atomic_sub_fetch(&tbl->num_elems, 1, __ATOMIC_RELAXED);
+                return 0;
+            }
+
+            if (__atomic_compare_exchange_n(&elem->is_occpuied, &state, BUCKET_CLAIMED, 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+                write_entry(&elem->entry, key, value);
+                elem->hash_val = hash_val;
+                __atomic_store_n(&elem->is_occpuied, tbl->epoch, __ATOMIC_RELEASE);
+                return 1;
+            }
+
+            // another thread was faster, state holds the bucket's new state
+            __atomic_sub_fetch(&tbl->num_elems, 1, __ATOMIC_RELAXED);
+        }
+
+        // wait until the entry of a claimed bucket is written
+        while (state == BUCKET_CLAIMED) {
+            state = __atomic_load_n(&elem->is_occpuied, __ATOMIC_ACQUIRE);
+        }
+
+        if (point2d_cmp(&elem->entry.key, key) == 0) {
+            return 1;
         }
 
         idx = probe(idx, tbl->num_buckets);
+    }
+
+    return 0;
+}
+
+int
+cell_table_contains_concurrent(CellTable *tbl, const Point2D *key)
+{
+    size_t idx, dist;
+    CellTableElem *elem;
+    int state;
+
+    idx = bucket_idx(hash_point2d(key), tbl->num_buckets);
+    for (dist = 0; dist < tbl->num_buckets; ++dist) {
         elem = &tbl->buckets[idx];
-        ++dist;
+        do {
+            state = __atomic_load_n(&elem->is_occpuied, __ATOMIC_ACQUIRE);
+        } while (state == BUCKET_CLAIMED);
+
+        if (state != tbl->epoch) {
+            return 0;
+        }
+        if (point2d_cmp(&elem->entry.key, key) == 0) {
+            return 1;
+        }
+
+        idx = probe(idx, tbl->num_buckets);
     }
 
-    // write empty bucket
-    memcpy(elem, &elem_insert, sizeof(CellTableElem));
+    return 0;
+}
 
-    tbl->num_elems++;
+void
+cell_table_end_concurrent(CellTable *tbl)
+{
+    size_t mask = tbl->num_buckets - 1;
+    size_t empty_idx, begin, len, i;
 
-    return 1;
+    if (tbl->num_elems == 0) {
+        return;
+    }
+
+    // start right after an empty bucket, so no cluster is cut in two
+    for (empty_idx = 0; is_occupied(&tbl->buckets[empty_idx], tbl->epoch); ++empty_idx) {
+        assert(empty_idx < tbl->num_buckets);
+    }
+
+    for (i = 1; i < tbl->num_buckets; i += len + 1) {
+        begin = (empty_idx + i) & mask;
+        for (len = 0; is_occupied(&tbl->buckets[(begin + len) & mask], tbl->epoch); ++len);
+        if (len > 1) {
+            sort_cluster(tbl, begin, len);
+        }
+    }
+}
+
+Cell *
+cell_table_get_or_put(CellTable *tbl, const Point2D *key, const Cell *value)
+{
+    unsigned int hash_val;
+    CellTableElem *elem;
+
+    hash_val = hash_point2d(key);
+
+    elem = find_elem(tbl, key, hash_val);
+    if (elem != NULL) {
+        return elem->entry.value;
+    }
+
+    return insert_entry(tbl, key, hash_val, value) ? (Cell *)value : NULL;
 }
 
 int
 cell_table_contains(CellTable *tbl, const Point2D *key)
 {
-    size_t idx = bucket_idx(hash_point2d(key), tbl->num_buckets);
-    CellTableElem *elem = find_elem(tbl, key, idx);
+    CellTableElem *elem = find_elem(tbl, key, hash_point2d(key));
     return elem != NULL;
 }
 
+void
+cell_table_contains_batch(CellTable *tbl, const Point2D *keys, size_t num_keys, unsigned char *out_mask)
+{
+    unsigned int hash_vals[CELL_TABLE_BATCH_SIZE];
+    size_t begin, i, n;
+
+    for (begin = 0; begin < num_keys; begin += n) {
+        n = num_keys - begin < CELL_TABLE_BATCH_SIZE ? num_keys - begin : CELL_TABLE_BATCH_SIZE;
+
+        // hash all keys and prefetch the buckets their lookups start at
+        for (i = 0; i < n; ++i) {
+            hash_vals[i] = hash_point2d(&keys[begin + i]);
+            __builtin_prefetch(&tbl->buckets[bucket_idx(hash_vals[i], tbl->num_buckets)]);
+        }
+
+        // resolve the lookups
+        for (i = 0; i < n; ++i) {
+            out_mask[begin + i] = find_elem(tbl, &keys[begin + i], hash_vals[i]) != NULL;
+        }
+    }
+}
+
 Cell *
 cell_table_get(CellTable *tbl, const Point2D *key)
 {
-    size_t idx = bucket_idx(hash_point2d(key), tbl->num_buckets);
-    CellTableElem *elem = find_elem(tbl, key, idx);
+    CellTableElem *elem = find_elem(tbl, key, hash_point2d(key));
     return (elem != NULL) ? elem->entry.value : NULL;
 }
 
@@ -459,17 +854,71 @@ cell_table_remove(CellTable *tbl, const Point2D *key)
     return NULL;
 }
 
+int
+cell_table_load(CellTable *tbl, const CellTableElem *buckets, size_t num_buckets, size_t num_elems)
+{
+    CellTableElem *new_buckets;
+    size_t idx, num_occupied = 0;
+    int epoch = 1;
+
+    if (!is_pow2(num_buckets) || num_elems > num_buckets) {
+        return 0;
+    }
+
+    // the occupied buckets of the copied table carry the latest stamp, the others are left over from earlier epochs
+    // (an epoch wraparound resets all stamps)
+    for (idx = 0; idx < num_buckets; ++idx) {
+        if (buckets[idx].is_occpuied < BUCKET_EMPTY) {
+            return 0;
+        }
+        if (buckets[idx].is_occpuied > epoch) {
+            epoch = buckets[idx].is_occpuied;
+            num_occupied = 0;
+        }
+        num_occupied += buckets[idx].is_occpuied == epoch;
+    }
+    if (num_elems > 0 && num_occupied != num_elems) {
+        return 0;
+    }
+
+    new_buckets = malloc(num_buckets * sizeof(CellTableElem));
+    if (new_buckets == NULL) {
+        return 0;
+    }
+    memcpy(new_buckets, buckets, num_buckets * sizeof(CellTableElem));
+
+    // the buckets of an empty table may all be left over
+    if (num_elems == 0) {
+        for (idx = 0; idx < num_buckets; ++idx) {
+            new_buckets[idx].is_occpuied = BUCKET_EMPTY;
+        }
+        epoch = 1;
+    }
+
+    drop_old_buckets(tbl);
+    free(tbl->buckets);
+    tbl->buckets = new_buckets;
+    tbl->num_buckets = num_buckets;
+    tbl->num_elems = num_elems;
+    tbl->epoch = epoch;
+
+    return 1;
+}
+
 void
 cell_table_clear(CellTable *tbl)
 {
     size_t idx;
-    CellTableElem *elem;
 
-    for (idx = 0; idx < tbl->num_buckets; ++idx) {
-        elem = &tbl->buckets[idx];
-        // mark bucket heads as free
-        elem->is_occpuied = 0;
+    // buckets occupied in an earlier epoch are empty; only when the epochs wrap around, all buckets are marked free
+    if (tbl->epoch == EPOCH_MAX) {
+        for (idx = 0; idx < tbl->num_buckets; ++idx) {
+            tbl->buckets[idx].is_occpuied = BUCKET_EMPTY;
+        }
+        tbl->epoch = 0;
     }
+    tbl->epoch++;
+    drop_old_buckets(tbl);
 
     tbl->num_elems = 0;
 }
@@ -483,6 +932,7 @@ cell_table_size(CellTable *tbl)
 void
 cell_table_destroy(CellTable *tbl)
 {
+    free(tbl->old_buckets);
     free(tbl->buckets);
     free(tbl);
 }
@@ -493,7 +943,21 @@ cell_table_iter_init(CellTable *tbl, CellTableIter *iter)
     iter->tbl = tbl;
     iter->current = NULL;
     iter->current_idx = -1;
-    first_elem_iter(tbl, &iter->next, &iter->next_idx);
+    iter->end_idx = iter_span(tbl);
+    first_elem_iter(tbl, 0, iter->end_idx, &iter->next, &iter->next_idx);
+}
+
+void
+cell_table_iter_init_part(CellTable *tbl, CellTableIter *iter, size_t part, size_t num_parts)
+{
+    size_t span = iter_span(tbl);
+    size_t begin_idx = span / num_parts * part;
+
+    iter->tbl = tbl;
+    iter->current = NULL;
+    iter->current_idx = -1;
+    iter->end_idx = part + 1 == num_parts ? span : span / num_parts * (part + 1);
+    first_elem_iter(tbl, begin_idx, iter->end_idx, &iter->next, &iter->next_idx);
 }
 
 int
@@ -507,7 +971,7 @@ cell_table_iter_next(CellTableIter *iter)
 {
     iter->current = iter->next;
     iter->current_idx = iter->next_idx;
-    next_elem_iter(iter->tbl, iter->current_idx, &iter->next, &iter->next_idx);
+    next_elem_iter(iter->tbl, iter->current_idx, iter->end_idx, &iter->next, &iter->next_idx);
 }
 
 CellTableEntry *
@@ -534,9 +998,11 @@ cell_table_map(CellTable *tbl, map_function map_func)
     size_t idx;
     CellTableElem *elem;
 
+    cell_table_finish_rehash(tbl);
+
     for (idx = 0; idx < tbl->num_buckets; ++idx) {
         elem = &tbl->buckets[idx];
-        if (elem->is_occpuied) {
+        if (is_occupied(elem, tbl->epoch)) {
             map_func(&elem->entry);
         }
     }
@@ -22,6 +22,101 @@ typedef struct cell_table_entry {
 
 } CellTableEntry;
 
+/*
+ * The cell table is a robin hood hash table (cell_table.c); built with CELL_TABLE_SWISS defined, it is a swiss table
+ * with the same API instead (cell_table_swiss.c). The two backends differ in their bucket layout.
+ */
+#ifdef CELL_TABLE_SWISS
+
+/**
+ * The number of buckets whose control bytes are tested at once (one SSE2 register).
+ */
+#define CELL_TABLE_GROUP_SIZE 16
+
+/**
+ * a type representing a cell table element (a slot of the swiss table backend, see cell_table_swiss.c).
+ */
+typedef struct cell_table_elem {
+
+    /**
+     * the cell table entry (containing key and value).
+     */
+    CellTableEntry entry;
+
+} CellTableElem;
+
+/**
+ * The size of a bucket in the raw bucket array (see cell_table_load()): the slots are followed by one control byte
+ * per bucket.
+ */
+#define CELL_TABLE_BUCKET_SIZE (sizeof(CellTableElem) + 1)
+
+/**
+ * a type representing the cell table.
+ */
+typedef struct cell_table {
+
+    /**
+     * The number of buckets (a power of two, at least CELL_TABLE_GROUP_SIZE).
+     */
+    size_t num_buckets;
+
+    /**
+     * a factor that controls growing + rehashing of the cell table.
+     */
+    float load_factor;
+
+    /**
+     * The number of elements currently stored in the table.
+     */
+    size_t num_elems;
+
+    /**
+     * The number of buckets holding a removed element (tombstones); they count towards the load.
+     */
+    size_t num_deleted;
+
+    /**
+     * The buckets (slots), followed by the control bytes in the same allocation.
+     */
+    CellTableElem *buckets;
+
+    /**
+     * The control bytes, one per bucket: the 7-bit fingerprint of the key of an occupied bucket, or a negative
+     * marker for an empty, deleted or claimed one.
+     */
+    signed char *ctrl;
+
+    /**
+     * The bucket array being migrated into the buckets during an incremental rehash, or NULL.
+     * Its unmigrated elements still belong to the table; the migrated ones are stale copies.
+     */
+    CellTableElem *old_buckets;
+
+    /**
+     * The control bytes of the old buckets.
+     */
+    signed char *old_ctrl;
+
+    /**
+     * The number of old buckets (0 if there is no incremental rehash in progress).
+     */
+    size_t old_num_buckets;
+
+    /**
+     * The index of the next old bucket to migrate.
+     */
+    size_t migrate_idx;
+
+    /**
+     * The number of old buckets migrated per insertion, or 0 if the table is rehashed all at once.
+     */
+    size_t rehash_step;
+
+} CellTable;
+
+#else
+
 /**
  * a type representing a cell table element.
  */
@@ -38,7 +133,8 @@ typedef struct cell_table_elem {
     unsigned int hash_val;
 
     /**
-     * a flag indicating if the cell table entry is occupied.
+     * The epoch of the cell table in which the entry was occupied; the entry is occupied only if it matches the
+     * current epoch of the table (0: never occupied).
      */
     int is_occpuied;
 
@@ -49,6 +145,11 @@ typedef struct cell_table_elem {
 
 } CellTableElem; // TODO: rename to bucket
 
+/**
+ * The size of a bucket in the raw bucket array (see cell_table_load()).
+ */
+#define CELL_TABLE_BUCKET_SIZE sizeof(CellTableElem)
+
 /**
  * a type representing the cell table.
  */
@@ -69,13 +170,41 @@ typedef struct cell_table {
      */
     size_t num_elems;
 
+    /**
+     * The current epoch (1 .. INT_MAX); cell_table_clear() empties all buckets at once by starting a new one.
+     */
+    int epoch;
+
     /**
      * The buckets.
      */
     CellTableElem *buckets;
 
+    /**
+     * The bucket array being migrated into the buckets during an incremental rehash, or NULL.
+     * Its unmigrated elements still belong to the table; the migrated ones are stale copies.
+     */
+    CellTableElem *old_buckets;
+
+    /**
+     * The number of old buckets (0 if there is no incremental rehash in progress).
+     */
+    size_t old_num_buckets;
+
+    /**
+     * The index of the next old bucket to migrate.
+     */
+    size_t migrate_idx;
+
+    /**
+     * The number of old buckets migrated per insertion, or 0 if the table is rehashed all at once.
+     */
+    size_t rehash_step;
+
 } CellTable;
 
+#endif
+
 /**
  * a type representing the cell table iterator.
  */
@@ -92,7 +221,8 @@ typedef struct cell_table_iter {
     CellTableElem *current;
 
     /**
-     * The bucket index of the element the iterator currently points at.
+     * The bucket index of the element the iterator currently points at; the old buckets of an incremental rehash
+     * follow the buckets.
      */
     size_t current_idx;
 
@@ -106,6 +236,11 @@ typedef struct cell_table_iter {
      */
     size_t next_idx;
 
+    /**
+     * The bucket index the iteration stops at (exclusive).
+     */
+    size_t end_idx;
+
 } CellTableIter;
 
 typedef void map_function(CellTableEntry *e);
@@ -119,6 +254,42 @@ typedef void map_function(CellTableEntry *e);
 CellTable *
 cell_table_create(size_t num_buckets, float load_factor);
 
+/**
+ * Switches a cell table between rehashing all at once (the default) and incremental rehashing.
+ * An incremental rehash keeps the old bucket array next to the new one; every insertion migrates a few old buckets
+ * (enough to finish before the next rehash is due) and lookups consult both arrays until the migration is done.
+ * @param tbl the cell table.
+ * @param incremental true to rehash incrementally, false to rehash all at once.
+ */
+void
+cell_table_set_incremental_rehash(CellTable *tbl, int incremental);
+
+/**
+ * Grows a cell table so that it can take a number of elements without exceeding its load factor, i.e. without
+ * rehashing (completing an incremental rehash in progress); the bucket array is replaced at most once.
+ * @param tbl the cell table.
+ * @param num_elems the number of elements the table shall be able to hold.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+cell_table_reserve(CellTable *tbl, size_t num_elems);
+
+/**
+ * Shrinks a cell table to the smallest number of buckets that holds its elements without exceeding its load factor
+ * (completing an incremental rehash in progress), e.g. after its population has crashed.
+ * @param tbl the cell table.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+cell_table_shrink_to_fit(CellTable *tbl);
+
+/**
+ * Completes an incremental rehash in progress, so that all entries are stored in tbl->buckets.
+ * @param tbl the cell table.
+ */
+void
+cell_table_finish_rehash(CellTable *tbl);
+
 /**
  * Adds an entry to the cell table.
  * @param tbl the cell table.
@@ -129,6 +300,16 @@ cell_table_create(size_t num_buckets, float load_factor);
 int
 cell_table_put(CellTable *tbl, const Point2D *key, const Cell *value);
 
+/**
+ * Retrieves the value for a key from the cell table, adding the given value first if the key is not present yet.
+ * @param tbl the cell table.
+ * @param key the key.
+ * @param value the value to add if the key is not present.
+ * @return the value stored for the key (i.e. the given value if it was added), or NULL if adding failed.
+ */
+Cell *
+cell_table_get_or_put(CellTable *tbl, const Point2D *key, const Cell *value);
+
 /**
  * Retrieves a value by key from the cell table.
  * @param tbl the cell table.
@@ -147,6 +328,67 @@ cell_table_get(CellTable *tbl, const Point2D *key);
 int
 cell_table_contains(CellTable *tbl, const Point2D *key);
 
+/**
+ * The number of keys cell_table_contains_batch() hashes and prefetches ahead of resolving their lookups.
+ */
+#define CELL_TABLE_BATCH_SIZE 32
+
+/**
+ * Checks for every key of a batch if the cell table contains an entry with that key. The keys are hashed and the
+ * buckets their lookups start at are prefetched first (CELL_TABLE_BATCH_SIZE keys at a time), then the lookups are
+ * resolved, so that the cache misses of independent lookups overlap.
+ * @param tbl the cell table.
+ * @param keys the keys.
+ * @param num_keys the number of keys.
+ * @param out_mask an output parameter: out_mask[i] is set to true if the cell table contains keys[i], false otherwise.
+ */
+void
+cell_table_contains_batch(CellTable *tbl, const Point2D *keys, size_t num_keys, unsigned char *out_mask);
+
+/**
+ * Prepares a cell table for concurrent insertion (see cell_table_put_concurrent()).
+ * The table is grown so that it can take the given number of elements (see cell_table_reserve()); it is never grown
+ * during the concurrent phase.
+ * @param tbl the cell table.
+ * @param num_elems the number of elements the table shall be able to hold.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+cell_table_begin_concurrent(CellTable *tbl, size_t num_elems);
+
+/**
+ * Puts an entry into the cell table; may be called from several threads at once.
+ * Buckets are claimed by an atomic compare-and-swap and found by plain probing (no robin hood displacement).
+ * An existing entry for the key is left untouched. Between cell_table_begin_concurrent() and
+ * cell_table_end_concurrent() no other function but cell_table_put_concurrent() and cell_table_contains_concurrent()
+ * may be called.
+ * @param tbl the cell table.
+ * @param key the key.
+ * @param value the value.
+ * @return true if the entry is stored in the cell table, false if the table is full; the entry must then be put
+ *         after cell_table_end_concurrent().
+ */
+int
+cell_table_put_concurrent(CellTable *tbl, const Point2D *key, const Cell *value);
+
+/**
+ * Checks if the cell table contains an entry with a given key; may be called concurrently to
+ * cell_table_put_concurrent().
+ * @param tbl the cell table.
+ * @param key the key.
+ * @return true if the cell table contains an entry for the given key, false otherwise.
+ */
+int
+cell_table_contains_concurrent(CellTable *tbl, const Point2D *key);
+
+/**
+ * Ends concurrent insertion and restores the robin hood order of the buckets (nothing to do for the swiss table
+ * backend).
+ * @param tbl the cell table.
+ */
+void
+cell_table_end_concurrent(CellTable *tbl);
+
 /**
  * Removes an entry from the cell table.
  * @param tbl the cell table.
@@ -163,6 +405,19 @@ cell_table_remove(CellTable *tbl, const Point2D *key);
 void
 cell_table_clear(CellTable *tbl);
 
+/**
+ * Replaces all entries of the cell table by a copy of a raw bucket array (e.g. taken from a snapshot of another
+ * cell table of the same backend, see CELL_TABLE_BUCKET_SIZE); no key is rehashed. The values of the copied entries
+ * are undefined and have to be set afterwards.
+ * @param tbl the cell table.
+ * @param buckets the bucket array.
+ * @param num_buckets the number of buckets (must be a power of 2).
+ * @param num_elems the number of occupied buckets.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+cell_table_load(CellTable *tbl, const CellTableElem *buckets, size_t num_buckets, size_t num_elems);
+
 /**
  * Returns the no. of elements the cell table contains.
  * @param tbl the cell table
@@ -187,6 +442,19 @@ cell_table_destroy(CellTable *tbl);
 void
 cell_table_iter_init(CellTable *tbl, CellTableIter *iter);
 
+/**
+ * Initializes a cell table iterator visiting only one part of the cell table.
+ * The bucket array is split into num_parts contiguous ranges of (almost) equal size; iterators over distinct parts
+ * visit disjoint sets of entries and may be used concurrently.
+ * WARNING: do not alter the cell table upon iteration!
+ * @param tbl the cell table.
+ * @param iter a pointer to an allocated cell table iterator instance.
+ * @param part the index of the part to iterate over (0 .. num_parts - 1).
+ * @param num_parts the number of parts.
+ */
+void
+cell_table_iter_init_part(CellTable *tbl, CellTableIter *iter, size_t part, size_t num_parts);
+
 /**
  * Check whether the iterator can deliver a next element.
  * @param iter the cell table iterator.
@@ -227,7 +495,7 @@ Cell *
 cell_table_iter_get_val(CellTableIter *iter);
 
 /**
- * Applies a given function to all cell table entries.
+ * Applies a given function to all cell table entries (completing an incremental rehash in progress first).
  * @param tbl the cell table
  * @param f the function to apply
  */
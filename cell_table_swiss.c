@@ -0,0 +1,989 @@
+#include "cell_table.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifndef CELL_TABLE_SWISS
+#error "cell_table_swiss.c must be built with CELL_TABLE_SWISS defined"
+#endif
+
+/**
+ * A swiss table: next to the slots, every bucket has a control byte which holds the 7 low bits of the hash value of
+ * its key (the fingerprint), or a negative marker if the bucket holds no key. Buckets are probed in aligned groups of
+ * CELL_TABLE_GROUP_SIZE: the control bytes of a group are compared with the fingerprint of the key looked up all at
+ * once (a single SSE2 compare, or a plain loop without SSE2), and only the slots whose fingerprint matches are
+ * compared with the key. A lookup stops at the first group with an empty bucket, so most misses cost a single load of
+ * control bytes. The remaining hash bits select the group to start at; groups are probed quadratically.
+ */
+
+/**
+ * Fowler-Noll-Vo 32-bit constants
+ * @see https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
+ */
+#define FNV_32_PRIME 16777619u
+#define FNV_32_BASIS 2166136261u
+
+/**
+ * Control bytes of buckets holding no key (all negative, fingerprints are 0 .. 127); buckets are only claimed during
+ * concurrent insertion, while the claiming thread writes the entry.
+ */
+#define CTRL_EMPTY   ((signed char)-128)
+#define CTRL_DELETED ((signed char)-2)
+#define CTRL_CLAIMED ((signed char)-1)
+
+/**
+ * Calculates a Fowler-Noll-Vo (FNV) 32-bit hash value of arbitrary data.
+ * @param data the data to hash
+ * @param size the size of the data to hash
+ * @return the calculated FNV hash value.
+ */
+static inline unsigned int
+hash_bytes(const void *data, size_t size)
+{
+    unsigned int hash;
+    unsigned char *_data = (unsigned char *)data;
+
+    hash = FNV_32_BASIS;
+    while (size-- > 0)
+        hash = (hash * FNV_32_PRIME) ^ *_data++;
+
+    return hash;
+}
+
+/**
+ * Calculates a Fowler-Noll-Vo (FNV) 32-bit hash value of 2D points.
+ * @param p the point
+ * @return the calculated FNV hash value.
+ */
+static inline unsigned int
+hash_point2d(const Point2D *p)
+{
+    return hash_bytes(p, sizeof(Point2D));
+}
+
+/**
+ * Checks two 2D points for equality.
+ * @param p1 the first point
+ * @param p2 the second point
+ * @return true if p1 == p2, false otherwise.
+ */
+static inline int
+point2d_equals(const Point2D *p1, const Point2D *p2)
+{
+    return p1->x == p2->x && p1->y == p2->y;
+}
+
+/**
+ * Checks if a number is a power of two.
+ * @param n the number to check.
+ * @return true if n is a power of two, false otherwise.
+ */
+static inline int
+is_pow2(size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * Rounds a number to a power of two.
+ * @param n the number to round.
+ * @return the power of two.
+ */
+static inline size_t
+ceil_pow2(size_t n)
+{
+    while (!is_pow2(n)) {
+        n = (n & (n - 1));
+    }
+    return n;
+}
+
+/**
+ * Returns the fingerprint of a hash value (the control byte of a bucket holding a key with that hash value).
+ * @param hash_val the hash value.
+ * @return the fingerprint.
+ */
+static inline signed char
+fingerprint(unsigned int hash_val)
+{
+    return (signed char)(hash_val & 0x7f);
+}
+
+/**
+ * Returns the index of the group a probe sequence starts at.
+ * @param hash_val the hash value.
+ * @param num_buckets the number of buckets.
+ * @return the group index.
+ */
+static inline size_t
+group_idx(unsigned int hash_val, size_t num_buckets)
+{
+    assert(is_pow2(num_buckets) && num_buckets >= CELL_TABLE_GROUP_SIZE);
+    return (hash_val >> 7) & (num_buckets / CELL_TABLE_GROUP_SIZE - 1);
+}
+
+/**
+ * Returns the buckets of a group whose control byte equals a given value.
+ * @param group the control bytes of the group (aligned to CELL_TABLE_GROUP_SIZE).
+ * @param c the value.
+ * @return a bit mask with bit i set if the control byte of the i-th bucket of the group equals c.
+ */
+static inline unsigned int
+group_match(const signed char *group, signed char c)
+{
+#ifdef __SSE2__
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)group), _mm_set1_epi8(c)));
+#else
+    unsigned int mask = 0;
+    int i;
+
+    for (i = 0; i < CELL_TABLE_GROUP_SIZE; ++i) {
+        mask |= (unsigned int)(group[i] == c) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Returns the buckets of a group which hold no key (empty or deleted ones, there are no claimed buckets outside of
+ * concurrent insertion).
+ * @param group the control bytes of the group (aligned to CELL_TABLE_GROUP_SIZE).
+ * @return a bit mask with bit i set if the i-th bucket of the group holds no key.
+ */
+static inline unsigned int
+group_match_free(const signed char *group)
+{
+#ifdef __SSE2__
+    return (unsigned int)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+    unsigned int mask = 0;
+    int i;
+
+    for (i = 0; i < CELL_TABLE_GROUP_SIZE; ++i) {
+        mask |= (unsigned int)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Returns the index of the lowest bit set in a (non-zero) bit mask.
+ * @param mask the bit mask.
+ * @return the index of the lowest bit set.
+ */
+static inline size_t
+lowest_bit(unsigned int mask)
+{
+    return (size_t)__builtin_ctz(mask);
+}
+
+/**
+ * Writes key and value to a cell table entry.
+ * @param e the cell table entry to write
+ * @param key the key
+ * @param value the value
+ */
+static inline void
+write_entry(CellTableEntry *e, const Point2D *key, const Cell *value)
+{
+    e->key.x = key->x;
+    e->key.y = key->y;
+    e->value = (Cell *)value;
+}
+
+/**
+ * Allocates a bucket array with all buckets empty: the slots, followed by the control bytes.
+ * @param num_buckets the number of buckets (a power of two, at least CELL_TABLE_GROUP_SIZE).
+ * @param out_ctrl an output parameter for the control bytes.
+ * @return the bucket array, or NULL if memory ran out.
+ */
+static CellTableElem *
+alloc_buckets(size_t num_buckets, signed char **out_ctrl)
+{
+    CellTableElem *buckets;
+
+    // the size is a multiple of the group size, as is the offset of the control bytes
+    buckets = aligned_alloc(CELL_TABLE_GROUP_SIZE, num_buckets * CELL_TABLE_BUCKET_SIZE);
+    if (buckets == NULL) {
+        return NULL;
+    }
+
+    *out_ctrl = (signed char *)(buckets + num_buckets);
+    memset(*out_ctrl, CTRL_EMPTY, num_buckets);
+    return buckets;
+}
+
+/**
+ * Look up a cell table element by key in a bucket array.
+ * @param buckets the bucket array.
+ * @param ctrl the control bytes of the bucket array.
+ * @param num_buckets the number of buckets.
+ * @param key the key.
+ * @param hash_val the hash value of the key.
+ * @return the found cell table element or NULL if no element with given key is stored in the bucket array.
+ */
+static inline CellTableElem *
+find_elem_in(CellTableElem *buckets, const signed char *ctrl, size_t num_buckets, const Point2D *key,
+             unsigned int hash_val)
+{
+    size_t group_mask = num_buckets / CELL_TABLE_GROUP_SIZE - 1;
+    size_t group = group_idx(hash_val, num_buckets);
+    signed char fp = fingerprint(hash_val);
+    size_t step;
+    unsigned int match;
+    CellTableElem *elem;
+
+    for (step = 0; step <= group_mask; ++step) {
+        match = group_match(&ctrl[group * CELL_TABLE_GROUP_SIZE], fp);
+        while (match != 0) {
+            elem = &buckets[group * CELL_TABLE_GROUP_SIZE + lowest_bit(match)];
+            if (point2d_equals(&elem->entry.key, key)) {
+                return elem;
+            }
+            match &= match - 1;
+        }
+
+        // the key would have been put into the first group with an empty bucket
+        if (group_match(&ctrl[group * CELL_TABLE_GROUP_SIZE], CTRL_EMPTY) != 0) {
+            break;
+        }
+
+        // quadratic probing, visits all groups
+        group = (group + step + 1) & group_mask;
+    }
+
+    return NULL;
+}
+
+/**
+ * Look up a cell table element by key.
+ * @param tbl the cell table.
+ * @param key the key.
+ * @param hash_val the hash value of the key.
+ * @return the found cell table element or NULL if no element with given key is stored in the cell table.
+ */
+static inline CellTableElem *
+find_elem(CellTable *tbl, const Point2D *key, unsigned int hash_val)
+{
+    CellTableElem *elem;
+
+    elem = find_elem_in(tbl->buckets, tbl->ctrl, tbl->num_buckets, key, hash_val);
+
+    // during an incremental rehash, a key not found in the new buckets may not have been migrated yet
+    // (a migrated key is always found in the new buckets first)
+    if (elem == NULL && tbl->old_buckets != NULL) {
+        elem = find_elem_in(tbl->old_buckets, tbl->old_ctrl, tbl->old_num_buckets, key, hash_val);
+    }
+
+    return elem;
+}
+
+/**
+ * Puts an element into a bucket array; its key must not be present yet.
+ * @param buckets the bucket array.
+ * @param ctrl the control bytes of the bucket array.
+ * @param num_buckets the number of buckets.
+ * @param key the key.
+ * @param hash_val the hash value of the key.
+ * @param value the value.
+ * @return true if a deleted bucket was reused, false if an empty one was taken.
+ */
+static inline int
+place_elem(CellTableElem *buckets, signed char *ctrl, size_t num_buckets, const Point2D *key, unsigned int hash_val,
+           const Cell *value)
+{
+    size_t group_mask = num_buckets / CELL_TABLE_GROUP_SIZE - 1;
+    size_t group = group_idx(hash_val, num_buckets);
+    size_t step, idx;
+    unsigned int match;
+    int was_deleted;
+
+    // the load factor keeps a free bucket in the table
+    for (step = 0; ; ++step) {
+        assert(step <= group_mask);
+        match = group_match_free(&ctrl[group * CELL_TABLE_GROUP_SIZE]);
+        if (match != 0) {
+            break;
+        }
+        group = (group + step + 1) & group_mask;
+    }
+
+    idx = group * CELL_TABLE_GROUP_SIZE + lowest_bit(match);
+    was_deleted = ctrl[idx] == CTRL_DELETED;
+    write_entry(&buckets[idx].entry, key, value);
+    ctrl[idx] = fingerprint(hash_val);
+
+    return was_deleted;
+}
+
+/**
+ * Looks for the next occupied element in the cell table.
+ * @param tbl the cell table.
+ * @param prev_idx the index of the prev. element.
+ * @param end_idx the bucket index to stop at (exclusive).
+ * @param out_elem an output parameter for the found element.
+ * @param out_idx an output parameter for the found element's bucket index.
+ */
+static void
+next_elem_iter(CellTable *tbl, size_t prev_idx, size_t end_idx, CellTableElem **out_elem, size_t *out_idx)
+{
+    size_t idx;
+
+    for (idx = prev_idx + 1; idx < end_idx && idx < tbl->num_buckets; ++idx) {
+        if (tbl->ctrl[idx] >= 0) {
+            *out_elem = &tbl->buckets[idx];
+            *out_idx = idx;
+            return;
+        }
+    }
+
+    // the old buckets of an incremental rehash follow, the migrated ones are skipped
+    if (idx < tbl->num_buckets + tbl->migrate_idx) {
+        idx = tbl->num_buckets + tbl->migrate_idx;
+    }
+    for (; idx < end_idx; ++idx) {
+        if (tbl->old_ctrl[idx - tbl->num_buckets] >= 0) {
+            *out_elem = &tbl->old_buckets[idx - tbl->num_buckets];
+            *out_idx = idx;
+            return;
+        }
+    }
+
+    *out_elem = NULL;
+    *out_idx = -1;
+}
+
+/**
+ * Looks for the first occupied element in a range of buckets of the cell table.
+ * @param tbl the cell table.
+ * @param begin_idx the bucket index to start at (inclusive).
+ * @param end_idx the bucket index to stop at (exclusive).
+ * @param out_elem an output parameter for the found element.
+ * @param out_idx an output parameter for the found element's bucket index.
+ */
+static inline void
+first_elem_iter(CellTable *tbl, size_t begin_idx, size_t end_idx, CellTableElem **out_elem, size_t *out_idx)
+{
+    if (tbl->num_elems == 0) {
+        *out_elem = NULL;
+        *out_idx = -1;
+    } else {
+        next_elem_iter(tbl, begin_idx - 1, end_idx, out_elem, out_idx);
+    }
+}
+
+/**
+ * Returns the number of bucket indices an iterator runs through (the buckets, followed by the old buckets).
+ * @param tbl the cell table.
+ * @return the number of bucket indices.
+ */
+static inline size_t
+iter_span(CellTable *tbl)
+{
+    return tbl->num_buckets + tbl->old_num_buckets;
+}
+
+/**
+ * Returns the smallest number of buckets that can take a number of elements without exceeding a load factor.
+ * @param num_elems the number of elements.
+ * @param load_factor the load factor.
+ * @return the number of buckets (a power of two, at least CELL_TABLE_GROUP_SIZE).
+ */
+static inline size_t
+buckets_for(size_t num_elems, float load_factor)
+{
+    size_t num_buckets = CELL_TABLE_GROUP_SIZE;
+
+    while ((float)num_elems / num_buckets > load_factor) {
+        num_buckets *= 2;
+    }
+    return num_buckets;
+}
+
+/**
+ * Calculates the current load factor (deleted buckets included).
+ * @return the current load factor
+ */
+static inline float
+current_load(CellTable *tbl)
+{
+    return (float)(tbl->num_elems + tbl->num_deleted) / tbl->num_buckets;
+}
+
+/**
+ * Migrates old buckets of an incremental rehash into the buckets; the old bucket array is released when all of them
+ * are migrated. The old buckets are left untouched, so lookups of unmigrated keys still find them.
+ * @param tbl the cell table.
+ * @param num_old_buckets the (maximum) number of old buckets to migrate.
+ */
+static void
+migrate(CellTable *tbl, size_t num_old_buckets)
+{
+    size_t end_idx;
+    CellTableEntry *e;
+
+    end_idx = tbl->old_num_buckets - tbl->migrate_idx > num_old_buckets
+              ? tbl->migrate_idx + num_old_buckets : tbl->old_num_buckets;
+
+    for (; tbl->migrate_idx < end_idx; ++tbl->migrate_idx) {
+        if (tbl->old_ctrl[tbl->migrate_idx] >= 0) {
+            e = &tbl->old_buckets[tbl->migrate_idx].entry;
+            place_elem(tbl->buckets, tbl->ctrl, tbl->num_buckets, &e->key, hash_point2d(&e->key), e->value);
+        }
+    }
+
+    if (tbl->migrate_idx == tbl->old_num_buckets) {
+        free(tbl->old_buckets);
+        tbl->old_buckets = NULL;
+        tbl->old_ctrl = NULL;
+        tbl->old_num_buckets = 0;
+        tbl->migrate_idx = 0;
+    }
+}
+
+/**
+ * Drops the old bucket array of an incremental rehash without migrating it (e.g. when the table is cleared).
+ * @param tbl the cell table.
+ */
+static inline void
+drop_old_buckets(CellTable *tbl)
+{
+    free(tbl->old_buckets);
+    tbl->old_buckets = NULL;
+    tbl->old_ctrl = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+}
+
+/**
+ * Replaces the bucket array by a new one; the elements are left in the old bucket array, to be migrated by migrate()
+ * (an incremental rehash still in progress is completed first). Deleted buckets are not migrated.
+ * @param tbl the cell table.
+ * @param new_num_buckets the number of buckets of the new bucket array (a power of two).
+ * @return true if the operation succeeded, false otherwise
+ */
+static int
+resize(CellTable *tbl, size_t new_num_buckets)
+{
+    CellTableElem *new_buckets;
+    signed char *new_ctrl;
+
+    cell_table_finish_rehash(tbl);
+
+    // allocate new bucket array
+    new_buckets = alloc_buckets(new_num_buckets, &new_ctrl);
+    if (new_buckets == NULL) {
+        return 0;
+    }
+
+    tbl->old_buckets = tbl->buckets;
+    tbl->old_ctrl = tbl->ctrl;
+    tbl->old_num_buckets = tbl->num_buckets;
+    tbl->migrate_idx = 0;
+    tbl->buckets = new_buckets;
+    tbl->ctrl = new_ctrl;
+    tbl->num_buckets = new_num_buckets;
+    tbl->num_deleted = 0;
+
+    return 1;
+}
+
+/**
+ * Rehashes the hash table with a new bucket array twice the size, or of the same size if mostly deleted buckets
+ * made the load reach the load factor; in incremental mode, the elements are only migrated by the following
+ * insertions.
+ * @param tbl the hash table to rehash
+ * @return true if the operation succeeded, false otherwise
+ */
+static int
+rehash(CellTable *tbl)
+{
+    size_t new_num_buckets = tbl->num_buckets;
+
+    if ((float)tbl->num_elems / tbl->num_buckets > tbl->load_factor / 2) {
+        new_num_buckets *= 2;
+    }
+    if (!resize(tbl, new_num_buckets)) {
+        return 0;
+    }
+
+    // perform rehashing
+    if (tbl->rehash_step == 0) {
+        cell_table_finish_rehash(tbl);
+    }
+
+    return 1;
+}
+
+/**
+ * Inserts an entry whose key is known not to be present in the cell table yet.
+ * @param tbl the cell table.
+ * @param key the key.
+ * @param hash_val the hash value of the key.
+ * @param value the value.
+ * @return true if the entry was added successfully, false otherwise.
+ */
+static int
+insert_entry(CellTable *tbl, const Point2D *key, unsigned int hash_val, const Cell *value)
+{
+    // grow and rehash if load factor reached defined threshold
+    if (current_load(tbl) > tbl->load_factor && !rehash(tbl)) {
+        return 0;
+    }
+
+    // advance an incremental rehash in progress
+    if (tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->rehash_step);
+    }
+
+    // new keys always go to the new buckets
+    if (place_elem(tbl->buckets, tbl->ctrl, tbl->num_buckets, key, hash_val, value)) {
+        tbl->num_deleted--;
+    }
+
+    tbl->num_elems++;
+
+    return 1;
+}
+
+CellTable *
+cell_table_create(size_t num_buckets, float load_factor)
+{
+    if (load_factor <= 0 || load_factor >= 1) {
+        return NULL;
+    }
+
+    // allocate cell table first
+    CellTable *tbl = malloc(sizeof(CellTable));
+    if (tbl == NULL) {
+        return NULL;
+    }
+
+    // round no. of buckets to next power of two, at least one group
+    num_buckets = ceil_pow2(num_buckets);
+    if (num_buckets < CELL_TABLE_GROUP_SIZE) {
+        num_buckets = CELL_TABLE_GROUP_SIZE;
+    }
+
+    // allocate buckets
+    tbl->buckets = alloc_buckets(num_buckets, &tbl->ctrl);
+    if (tbl->buckets == NULL) {
+        free(tbl);
+        return NULL;
+    }
+
+    tbl->num_buckets = num_buckets;
+    tbl->load_factor = load_factor;
+    tbl->num_elems = 0;
+    tbl->num_deleted = 0;
+    tbl->old_buckets = NULL;
+    tbl->old_ctrl = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+    tbl->rehash_step = 0;
+
+    return tbl;
+}
+
+void
+cell_table_set_incremental_rehash(CellTable *tbl, int incremental)
+{
+    // a rehash starts with num_buckets * load_factor elements and is due again after as many insertions; migrating
+    // ceil(1 / load_factor) old buckets per insertion completes it in time
+    tbl->rehash_step = incremental ? (size_t)(1.0f / tbl->load_factor) + 1 : 0;
+    if (!incremental) {
+        cell_table_finish_rehash(tbl);
+    }
+}
+
+int
+cell_table_reserve(CellTable *tbl, size_t num_elems)
+{
+    size_t num_buckets = buckets_for(num_elems, tbl->load_factor);
+
+    // deleted buckets take room as well, a rehash drops them
+    if (num_buckets <= tbl->num_buckets
+        && (float)(num_elems + tbl->num_deleted) / tbl->num_buckets <= tbl->load_factor) {
+        return 1;
+    }
+    if (!resize(tbl, num_buckets > tbl->num_buckets ? num_buckets : tbl->num_buckets)) {
+        return 0;
+    }
+    cell_table_finish_rehash(tbl);
+    return 1;
+}
+
+int
+cell_table_shrink_to_fit(CellTable *tbl)
+{
+    size_t num_buckets = buckets_for(tbl->num_elems, tbl->load_factor);
+
+    if (num_buckets >= tbl->num_buckets) {
+        return 1;
+    }
+    if (!resize(tbl, num_buckets)) {
+        return 0;
+    }
+    cell_table_finish_rehash(tbl);
+    return 1;
+}
+
+void
+cell_table_finish_rehash(CellTable *tbl)
+{
+    if (tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->old_num_buckets);
+    }
+}
+
+int
+cell_table_put(CellTable *tbl, const Point2D *key, const Cell *value)
+{
+    unsigned int hash_val;
+    CellTableElem *elem;
+
+    hash_val = hash_point2d(key);
+
+    // check if we have to update an existing value first
+    elem = find_elem(tbl, key, hash_val);
+    if (elem != NULL) {
+        elem->entry.value = (Cell *)value;
+        return 1;
+    }
+
+    return insert_entry(tbl, key, hash_val, value);
+}
+
+int
+cell_table_begin_concurrent(CellTable *tbl, size_t num_elems)
+{
+    if (!cell_table_reserve(tbl, num_elems)) {
+        return 0;
+    }
+    cell_table_finish_rehash(tbl);
+    return 1;
+}
+
+int
+cell_table_put_concurrent(CellTable *tbl, const Point2D *key, const Cell *value)
+{
+    unsigned int hash_val = hash_point2d(key);
+    signed char fp = fingerprint(hash_val);
+    size_t max_elems = (size_t)(tbl->num_buckets * tbl->load_factor) - tbl->num_deleted;
+    size_t group_mask = tbl->num_buckets / CELL_TABLE_GROUP_SIZE - 1;
+    size_t group, step, idx;
+    signed char state;
+
+    // the buckets of a group are probed one by one, in the order place_elem() takes them; deleted buckets are not
+    // reused, the key may be stored behind them
+    group = group_idx(hash_val, tbl->num_buckets);
+    for (step = 0; step <= group_mask; ++step) {
+        for (idx = group * CELL_TABLE_GROUP_SIZE; idx < (group + 1) * CELL_TABLE_GROUP_SIZE; ++idx) {
+            state = __atomic_load_n(&tbl->ctrl[idx], __ATOMIC_ACQUIRE);
+
+            if (state == CTRL_EMPTY) {
+                // reserve room for the element first, the table must not exceed its load factor
+                if (__atomic_add_fetch(&tbl->num_elems, 1, __ATOMIC_RELAXED) > max_elems) {
+                    __atomic_sub_fetch(&tbl->num_elems, 1, __ATOMIC_RELAXED);
+                    return 0;
+                }
+
+                if (__atomic_compare_exchange_n(&tbl->ctrl[idx], &state, CTRL_CLAIMED, 0,
+                                                __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+                    write_entry(&tbl->buckets[idx].entry, key, value);
+                    __atomic_store_n(&tbl->ctrl[idx], fp, __ATOMIC_RELEASE);
+                    return 1;
+                }
+
+                // another thread was faster, state holds the bucket's new state
+                __atomic_sub_fetch(&tbl->num_elems, 1, __ATOMIC_RELAXED);
+            }
+
+            // wait until the entry of a claimed bucket is written
+            while (state == CTRL_CLAIMED) {
+                state = __atomic_load_n(&tbl->ctrl[idx], __ATOMIC_ACQUIRE);
+            }
+
+            if (state == fp && point2d_equals(&tbl->buckets[idx].entry.key, key)) {
+                return 1;
+            }
+        }
+
+        group = (group + step + 1) & group_mask;
+    }
+
+    return 0;
+}
+
+int
+cell_table_contains_concurrent(CellTable *tbl, const Point2D *key)
+{
+    unsigned int hash_val = hash_point2d(key);
+    signed char fp = fingerprint(hash_val);
+    size_t group_mask = tbl->num_buckets / CELL_TABLE_GROUP_SIZE - 1;
+    size_t group, step, idx;
+    signed char state;
+
+    group = group_idx(hash_val, tbl->num_buckets);
+    for (step = 0; step <= group_mask; ++step) {
+        for (idx = group * CELL_TABLE_GROUP_SIZE; idx < (group + 1) * CELL_TABLE_GROUP_SIZE; ++idx) {
+            do {
+                state = __atomic_load_n(&tbl->ctrl[idx], __ATOMIC_ACQUIRE);
+            } while (state == CTRL_CLAIMED);
+
+            if (state == CTRL_EMPTY) {
+                return 0;
+            }
+            if (state == fp && point2d_equals(&tbl->buckets[idx].entry.key, key)) {
+                return 1;
+            }
+        }
+
+        group = (group + step + 1) & group_mask;
+    }
+
+    return 0;
+}
+
+void
+cell_table_end_concurrent(CellTable *tbl)
+{
+    // concurrently put elements sit where place_elem() would have put them
+    (void)tbl;
+}
+
+Cell *
+cell_table_get_or_put(CellTable *tbl, const Point2D *key, const Cell *value)
+{
+    unsigned int hash_val;
+    CellTableElem *elem;
+
+    hash_val = hash_point2d(key);
+
+    elem = find_elem(tbl, key, hash_val);
+    if (elem != NULL) {
+        return elem->entry.value;
+    }
+
+    return insert_entry(tbl, key, hash_val, value) ? (Cell *)value : NULL;
+}
+
+int
+cell_table_contains(CellTable *tbl, const Point2D *key)
+{
+    CellTableElem *elem = find_elem(tbl, key, hash_point2d(key));
+    return elem != NULL;
+}
+
+void
+cell_table_contains_batch(CellTable *tbl, const Point2D *keys, size_t num_keys, unsigned char *out_mask)
+{
+    unsigned int hash_vals[CELL_TABLE_BATCH_SIZE];
+    size_t begin, i, n, group;
+    unsigned int match;
+
+    for (begin = 0; begin < num_keys; begin += n) {
+        n = num_keys - begin < CELL_TABLE_BATCH_SIZE ? num_keys - begin : CELL_TABLE_BATCH_SIZE;
+
+        // hash all keys and prefetch the control bytes of the groups their lookups start at
+        for (i = 0; i < n; ++i) {
+            hash_vals[i] = hash_point2d(&keys[begin + i]);
+            __builtin_prefetch(&tbl->ctrl[group_idx(hash_vals[i], tbl->num_buckets) * CELL_TABLE_GROUP_SIZE]);
+        }
+
+        // prefetch the first slot whose fingerprint matches, most lookups are resolved by it
+        for (i = 0; i < n; ++i) {
+            group = group_idx(hash_vals[i], tbl->num_buckets);
+            match = group_match(&tbl->ctrl[group * CELL_TABLE_GROUP_SIZE], fingerprint(hash_vals[i]));
+            if (match != 0) {
+                __builtin_prefetch(&tbl->buckets[group * CELL_TABLE_GROUP_SIZE + lowest_bit(match)]);
+            }
+        }
+
+        // resolve the lookups
+        for (i = 0; i < n; ++i) {
+            out_mask[begin + i] = find_elem(tbl, &keys[begin + i], hash_vals[i]) != NULL;
+        }
+    }
+}
+
+Cell *
+cell_table_get(CellTable *tbl, const Point2D *key)
+{
+    CellTableElem *elem = find_elem(tbl, key, hash_point2d(key));
+    return (elem != NULL) ? elem->entry.value : NULL;
+}
+
+Cell *
+cell_table_remove(CellTable *tbl, const Point2D *key)
+{
+    CellTableElem *elem;
+    size_t idx, group_begin;
+
+    cell_table_finish_rehash(tbl);
+
+    elem = find_elem(tbl, key, hash_point2d(key));
+    if (elem == NULL) {
+        return NULL;
+    }
+
+    // a bucket in a group with an empty bucket can become empty again, no probe sequence continues behind the group;
+    // otherwise it becomes a tombstone
+    idx = elem - tbl->buckets;
+    group_begin = idx - idx % CELL_TABLE_GROUP_SIZE;
+    if (group_match(&tbl->ctrl[group_begin], CTRL_EMPTY) != 0) {
+        tbl->ctrl[idx] = CTRL_EMPTY;
+    } else {
+        tbl->ctrl[idx] = CTRL_DELETED;
+        tbl->num_deleted++;
+    }
+
+    tbl->num_elems--;
+
+    return elem->entry.value;
+}
+
+int
+cell_table_load(CellTable *tbl, const CellTableElem *buckets, size_t num_buckets, size_t num_elems)
+{
+    CellTableElem *new_buckets;
+    signed char *new_ctrl;
+    size_t idx, num_occupied = 0, num_deleted = 0;
+
+    if (!is_pow2(num_buckets) || num_buckets < CELL_TABLE_GROUP_SIZE || num_elems > num_buckets) {
+        return 0;
+    }
+
+    new_buckets = alloc_buckets(num_buckets, &new_ctrl);
+    if (new_buckets == NULL) {
+        return 0;
+    }
+    memcpy(new_buckets, buckets, num_buckets * CELL_TABLE_BUCKET_SIZE);
+
+    // every bucket is empty, deleted or holds a key matching its fingerprint, and all keys are counted
+    for (idx = 0; idx < num_buckets; ++idx) {
+        if (new_ctrl[idx] >= 0) {
+            if (new_ctrl[idx] != fingerprint(hash_point2d(&new_buckets[idx].entry.key))) {
+                break;
+            }
+            num_occupied++;
+        } else if (new_ctrl[idx] == CTRL_DELETED) {
+            num_deleted++;
+        } else if (new_ctrl[idx] != CTRL_EMPTY) {
+            break;
+        }
+    }
+    if (idx < num_buckets || num_occupied != num_elems) {
+        free(new_buckets);
+        return 0;
+    }
+
+    drop_old_buckets(tbl);
+    free(tbl->buckets);
+    tbl->buckets = new_buckets;
+    tbl->ctrl = new_ctrl;
+    tbl->num_buckets = num_buckets;
+    tbl->num_elems = num_elems;
+    tbl->num_deleted = num_deleted;
+
+    return 1;
+}
+
+void
+cell_table_clear(CellTable *tbl)
+{
+    // mark buckets as empty, the slots are left as they are
+    memset(tbl->ctrl, CTRL_EMPTY, tbl->num_buckets);
+    drop_old_buckets(tbl);
+
+    tbl->num_elems = 0;
+    tbl->num_deleted = 0;
+}
+
+size_t
+cell_table_size(CellTable *tbl)
+{
+    return tbl->num_elems;
+}
+
+void
+cell_table_destroy(CellTable *tbl)
+{
+    free(tbl->old_buckets);
+    free(tbl->buckets);
+    free(tbl);
+}
+
+void
+cell_table_iter_init(CellTable *tbl, CellTableIter *iter)
+{
+    iter->tbl = tbl;
+    iter->current = NULL;
+    iter->current_idx = -1;
+    iter->end_idx = iter_span(tbl);
+    first_elem_iter(tbl, 0, iter->end_idx, &iter->next, &iter->next_idx);
+}
+
+void
+cell_table_iter_init_part(CellTable *tbl, CellTableIter *iter, size_t part, size_t num_parts)
+{
+    size_t span = iter_span(tbl);
+    size_t begin_idx = span / num_parts * part;
+
+    iter->tbl = tbl;
+    iter->current = NULL;
+    iter->current_idx = -1;
+    iter->end_idx = part + 1 == num_parts ? span : span / num_parts * (part + 1);
+    first_elem_iter(tbl, begin_idx, iter->end_idx, &iter->next, &iter->next_idx);
+}
+
+int
+cell_table_iter_has_next(CellTableIter *iter)
+{
+    return iter->next != NULL;
+}
+
+void
+cell_table_iter_next(CellTableIter *iter)
+{
+    iter->current = iter->next;
+    iter->current_idx = iter->next_idx;
+    next_elem_iter(iter->tbl, iter->current_idx, iter->end_idx, &iter->next, &iter->next_idx);
+}
+
+CellTableEntry *
+cell_table_iter_get(CellTableIter *iter)
+{
+    return &iter->current->entry;
+}
+
+Point2D *
+cell_table_iter_get_key(CellTableIter *iter)
+{
+    return &iter->current->entry.key;
+}
+
+Cell *
+cell_table_iter_get_val(CellTableIter *iter)
+{
+    return iter->current->entry.value;
+}
+
+void
+cell_table_map(CellTable *tbl, map_function map_func)
+{
+    size_t idx;
+
+    cell_table_finish_rehash(tbl);
+
+    for (idx = 0; idx < tbl->num_buckets; ++idx) {
+        if (tbl->ctrl[idx] >= 0) {
+            map_func(&tbl->buckets[idx].entry);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Writes a checkpoint to the temporary file and renames it to the checkpoint file.
+ * @param w the checkpoint writer.
+ * @param generation the number of the generation.
+ * @param cells the cells.
+ * @param num_cells the number of cells.
+ * @return 0 on success, or the error number of the failed operation.
+ */
+static int
+write_checkpoint(CheckpointWriter *w, uint64_t generation, SnapshotCell *cells, size_t num_cells)
+{
+    FILE *f;
+    int ok;
+
+    f = fopen(w->tmp_path, "wb");
+    if (f == NULL) {
+        return errno;
+    }
+
+    ok = snapshot_write(f, generation, w->origin, cells, num_cells, NULL, 0, 0) && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+
+    if (!ok || rename(w->tmp_path, w->path) != 0) {
+        return errno != 0 ? errno : EIO;
+    }
+    return 0;
+}
+
+/**
+ * The main loop of the writer thread.
+ * @param data the checkpoint writer.
+ * @return always NULL.
+ */
+static void *
+writer_main(void *data)
+{
+    CheckpointWriter *w = (CheckpointWriter *)data;
+    SnapshotCell *cells;
+    size_t num_cells;
+    uint64_t generation;
+    int error;
+
+    for (;;) {
+        // wait for a checkpoint
+        pthread_mutex_lock(&w->lock);
+        while (!w->shutdown && w->cells == NULL) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (w->cells == NULL) {
+            pthread_mutex_unlock(&w->lock);
+            return NULL;
+        }
+        cells = w->cells;
+        num_cells = w->num_cells;
+        generation = w->generation;
+        w->cells = NULL;
+        pthread_mutex_unlock(&w->lock);
+
+        errno = 0;
+        error = write_checkpoint(w, generation, cells, num_cells);
+        free(cells);
+
+        pthread_mutex_lock(&w->lock);
+        if (w->error == 0) {
+            w->error = error;
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+char *
+checkpoint_path(const char *dir)
+{
+    char *path;
+
+    path = malloc(strlen(dir) + sizeof(CHECKPOINT_FILE) + 1);
+    if (path == NULL) {
+        return NULL;
+    }
+    sprintf(path, "%s/%s", dir, CHECKPOINT_FILE);
+    return path;
+}
+
+CheckpointWriter *
+checkpoint_writer_create(const char *dir, uint64_t origin)
+{
+    CheckpointWriter *w;
+
+    w = malloc(sizeof(CheckpointWriter));
+    if (w == NULL) {
+        return NULL;
+    }
+
+    w->path = checkpoint_path(dir);
+    w->tmp_path = w->path != NULL ? malloc(strlen(w->path) + sizeof(".tmp")) : NULL;
+    if (w->tmp_path == NULL) {
+        free(w->path);
+        free(w);
+        return NULL;
+    }
+    sprintf(w->tmp_path, "%s.tmp", w->path);
+
+    w->origin = origin;
+    w->cells = NULL;
+    w->num_cells = 0;
+    w->generation = 0;
+    w->error = 0;
+    w->shutdown = 0;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+
+    if (pthread_create(&w->writer, NULL, &writer_main, w) != 0) {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+        free(w->tmp_path);
+        free(w->path);
+        free(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+int
+checkpoint_writer_submit(CheckpointWriter *w, uint64_t generation, SnapshotCell *cells, size_t num_cells)
+{
+    int error;
+
+    pthread_mutex_lock(&w->lock);
+    free(w->cells);
+    w->cells = cells;
+    w->num_cells = num_cells;
+    w->generation = generation;
+    error = w->error;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    if (error != 0) {
+        errno = error;
+        return 0;
+    }
+    return 1;
+}
+
+int
+checkpoint_writer_destroy(CheckpointWriter *w)
+{
+    int error;
+
+    pthread_mutex_lock(&w->lock);
+    w->shutdown = 1;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_join(w->writer, NULL);
+    error = w->error;
+
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    free(w->tmp_path);
+    free(w->path);
+    free(w);
+
+    if (error != 0) {
+        errno = error;
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,121 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "snapshot.h"
+
+/**
+ * Periodic checkpoints of long runs: the engine hands a packed copy of the alive cells to a background thread, which
+ * writes it as a snapshot (see snapshot.h) while the engine keeps advancing generations. Every checkpoint replaces
+ * the previous one atomically (written to a temporary file, synced and renamed). Every checkpoint records the identity
+ * of the input the run started from (see snapshot_origin), so a resumed run can refuse a checkpoint of another input.
+ */
+
+/**
+ * The name of the checkpoint file in the checkpoint directory.
+ */
+#define CHECKPOINT_FILE "checkpoint.snap"
+
+/**
+ * a type representing a checkpoint writer.
+ */
+typedef struct checkpoint_writer {
+
+    /**
+     * the path of the checkpoint file.
+     */
+    char *path;
+
+    /**
+     * the path of the temporary file a checkpoint is written to before it replaces the checkpoint file.
+     */
+    char *tmp_path;
+
+    /**
+     * the background thread writing the checkpoints.
+     */
+    pthread_t writer;
+
+    /**
+     * the identity of the input the run started from, stored in every checkpoint.
+     */
+    uint64_t origin;
+
+    /**
+     * protects all members below.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * signaled when a checkpoint was submitted (or the writer shuts down).
+     */
+    pthread_cond_t cond;
+
+    /**
+     * the cells of the pending checkpoint, or NULL if there is none.
+     */
+    SnapshotCell *cells;
+
+    /**
+     * the number of cells of the pending checkpoint.
+     */
+    size_t num_cells;
+
+    /**
+     * the generation of the pending checkpoint.
+     */
+    uint64_t generation;
+
+    /**
+     * the error number of the first failed write, or 0.
+     */
+    int error;
+
+    /**
+     * a flag telling the writer to exit once the pending checkpoint is written.
+     */
+    int shutdown;
+
+} CheckpointWriter;
+
+/**
+ * Returns the path of the checkpoint file in a directory.
+ * @param dir the checkpoint directory.
+ * @return the path allocated on the heap, or NULL on failure.
+ */
+char *
+checkpoint_path(const char *dir);
+
+/**
+ * Creates a checkpoint writer and starts its background thread.
+ * @param dir the checkpoint directory (must exist).
+ * @param origin the identity of the input the run started from.
+ * @return a pointer to the checkpoint writer created on the heap, or NULL on failure.
+ */
+CheckpointWriter *
+checkpoint_writer_create(const char *dir, uint64_t origin);
+
+/**
+ * Submits a checkpoint; the writer takes ownership of the cells. A checkpoint which was submitted earlier but is not
+ * being written yet is dropped in favor of the new one, so the caller never waits for the disk.
+ * @param w the checkpoint writer.
+ * @param generation the number of the generation.
+ * @param cells the cells (allocated on the heap, sorted by the writer).
+ * @param num_cells the number of cells.
+ * @return true on success, false if an earlier checkpoint could not be written (errno is set).
+ */
+int
+checkpoint_writer_submit(CheckpointWriter *w, uint64_t generation, SnapshotCell *cells, size_t num_cells);
+
+/**
+ * Writes the pending checkpoint (if any), stops the background thread and frees all resources.
+ * @param w the checkpoint writer.
+ * @return true on success, false if a checkpoint could not be written (errno is set).
+ */
+int
+checkpoint_writer_destroy(CheckpointWriter *w);
+
+#endif
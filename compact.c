@@ -0,0 +1,368 @@
+#include "compact.h"
+
+#include <string.h>
+
+#include "radix_sort.h"
+
+/**
+ * Fowler-Noll-Vo 32-bit constants
+ * @see https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
+ */
+#define FNV_32_PRIME 16777619u
+#define FNV_32_BASIS 2166136261u
+
+/**
+ * The maximum size of an encoded cell (two varints of 32-bit values).
+ */
+#define COMPACT_CELL_MAX 10
+
+/**
+ * a type representing the state shared by the threads encoding a compact file.
+ */
+typedef struct compact_encoder {
+
+    /**
+     * The sorted cells, packed by radix_sort_pack(y, x).
+     */
+    const uint64_t *keys;
+
+    /**
+     * The number of cells.
+     */
+    size_t num_cells;
+
+    /**
+     * The block index being filled; the offsets are relative to the buffer of the encoding thread at first.
+     */
+    CompactBlock *index;
+
+    /**
+     * The number of blocks.
+     */
+    size_t num_blocks;
+
+    /**
+     * Per thread: the encoded blocks, or NULL if memory ran out.
+     */
+    unsigned char **buffers;
+
+    /**
+     * Per thread: the size of the encoded blocks.
+     */
+    size_t *buffer_sizes;
+
+} CompactEncoder;
+
+/**
+ * a type representing the state shared by the threads decoding a compact file.
+ */
+typedef struct compact_decoder {
+
+    /**
+     * The compact file.
+     */
+    const Compact *c;
+
+    /**
+     * The output array.
+     */
+    Point2D *cells;
+
+    /**
+     * Per thread: a flag indicating that all blocks of the thread were decoded successfully.
+     */
+    int *ok;
+
+} CompactDecoder;
+
+/**
+ * Calculates a Fowler-Noll-Vo (FNV-1a) 32-bit hash value of arbitrary data.
+ * @param data the data to hash
+ * @param size the size of the data to hash
+ * @return the calculated FNV hash value.
+ */
+static inline uint32_t
+checksum(const unsigned char *data, size_t size)
+{
+    uint32_t hash = FNV_32_BASIS;
+
+    while (size-- > 0)
+        hash = (hash ^ *data++) * FNV_32_PRIME;
+
+    return hash;
+}
+
+/**
+ * Returns the range of blocks handled by a thread.
+ * @param num_blocks the number of blocks.
+ * @param thread_idx the index of the thread.
+ * @param num_threads the number of threads.
+ * @param begin an output parameter for the first block.
+ * @param end an output parameter for the end of the range.
+ */
+static inline void
+block_range(size_t num_blocks, size_t thread_idx, size_t num_threads, size_t *begin, size_t *end)
+{
+    *begin = num_blocks * thread_idx / num_threads;
+    *end = num_blocks * (thread_idx + 1) / num_threads;
+}
+
+/**
+ * Encodes the blocks of a thread into its buffer (run by every thread).
+ */
+static void
+encode_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+    CompactEncoder *enc = (CompactEncoder *)arg;
+    size_t begin, end, b, i, first, last;
+    uint32_t x, y, prev_x, prev_y;
+    unsigned char *buf, *p, *block;
+
+    block_range(enc->num_blocks, thread_idx, num_threads, &begin, &end);
+    first = begin * COMPACT_BLOCK_CELLS;
+    last = end * COMPACT_BLOCK_CELLS < enc->num_cells ? end * COMPACT_BLOCK_CELLS : enc->num_cells;
+
+    buf = malloc((last - first) * COMPACT_CELL_MAX + 1);
+    enc->buffers[thread_idx] = buf;
+    if (buf == NULL) {
+        return;
+    }
+
+    for (p = buf, b = begin; b < end; ++b) {
+        block = p;
+        i = b * COMPACT_BLOCK_CELLS;
+        prev_y = (uint32_t)radix_sort_x(enc->keys[i]);
+        prev_x = (uint32_t)radix_sort_y(enc->keys[i]);
+        enc->index[b].x = (int32_t)prev_x;
+        enc->index[b].y = (int32_t)prev_y;
+
+        last = i + COMPACT_BLOCK_CELLS < enc->num_cells ? i + COMPACT_BLOCK_CELLS : enc->num_cells;
+        for (++i; i < last; ++i) {
+            y = (uint32_t)radix_sort_x(enc->keys[i]);
+            x = (uint32_t)radix_sort_y(enc->keys[i]);
+            p = compact_put_varint(p, y - prev_y);
+            if (y == prev_y) {
+                p = compact_put_varint(p, x - prev_x - 1);
+            } else {
+                p = compact_put_varint(p, compact_zigzag(x - prev_x));
+            }
+            prev_x = x;
+            prev_y = y;
+        }
+
+        enc->index[b].offset = block - buf;
+        enc->index[b].size = p - block;
+        enc->index[b].checksum = checksum(block, p - block);
+    }
+
+    enc->buffer_sizes[thread_idx] = p - buf;
+}
+
+/**
+ * Decodes the blocks of a thread (run by every thread).
+ */
+static void
+decode_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+    CompactDecoder *dec = (CompactDecoder *)arg;
+    size_t begin, end, b;
+
+    block_range(dec->c->header->num_blocks, thread_idx, num_threads, &begin, &end);
+
+    dec->ok[thread_idx] = 1;
+    for (b = begin; b < end && dec->ok[thread_idx]; ++b) {
+        dec->ok[thread_idx] = compact_decode_block(dec->c, b, dec->cells + b * dec->c->header->block_cells);
+    }
+}
+
+int
+compact_parse(Compact *c, const void *data, size_t size)
+{
+    const CompactHeader *header = (const CompactHeader *)data;
+    const CompactBlock *index;
+    size_t remaining, b;
+    uint64_t cells;
+
+    if (size < sizeof(CompactHeader) || memcmp(header->magic, COMPACT_MAGIC, sizeof(header->magic)) != 0) {
+        return 0;
+    }
+
+    if (header->version != COMPACT_VERSION || header->block_cells == 0) {
+        return 0;
+    }
+
+    // the cells must fit into an array of points (with one spare entry)
+    if (header->num_cells > SIZE_MAX / sizeof(Point2D) - 1) {
+        return 0;
+    }
+
+    // every block but the last one is full
+    if (header->num_blocks != (header->num_cells + header->block_cells - 1) / header->block_cells) {
+        return 0;
+    }
+
+    // the index and the blocks must fit into the region
+    remaining = size - sizeof(CompactHeader);
+    if (header->num_blocks > remaining / sizeof(CompactBlock)) {
+        return 0;
+    }
+    remaining -= header->num_blocks * sizeof(CompactBlock);
+
+    index = (const CompactBlock *)(header + 1);
+    for (b = 0; b < header->num_blocks; ++b) {
+        if (index[b].offset > remaining || index[b].size > remaining - index[b].offset) {
+            return 0;
+        }
+
+        // every cell but the first one of a block takes at least two bytes
+        cells = b + 1 < header->num_blocks ? header->block_cells : header->num_cells - b * header->block_cells;
+        if (cells - 1 > index[b].size / 2) {
+            return 0;
+        }
+    }
+
+    c->header = header;
+    c->index = index;
+    c->blocks = (const unsigned char *)(index + header->num_blocks);
+
+    return 1;
+}
+
+int
+compact_decode_block(const Compact *c, size_t block, Point2D *cells)
+{
+    const CompactBlock *b = &c->index[block];
+    const unsigned char *p = c->blocks + b->offset, *end = p + b->size;
+    size_t i, n = compact_block_size(c, block);
+    uint32_t x, y, dy, d;
+
+    if (checksum(p, b->size) != b->checksum) {
+        return 0;
+    }
+
+    x = (uint32_t)b->x;
+    y = (uint32_t)b->y;
+    cells[0].x = (int32_t)x;
+    cells[0].y = (int32_t)y;
+
+    for (i = 1; i < n; ++i) {
+        if (!compact_get_varint(&p, end, &dy) || !compact_get_varint(&p, end, &d)) {
+            return 0;
+        }
+        if (dy == 0) {
+            x += d + 1;
+        } else {
+            y += dy;
+            x += compact_unzigzag(d);
+        }
+        cells[i].x = (int32_t)x;
+        cells[i].y = (int32_t)y;
+    }
+
+    return p == end;
+}
+
+int
+compact_decode(const Compact *c, Point2D *cells, ThreadPool *pool)
+{
+    CompactDecoder dec;
+    size_t num_threads, i;
+    int ok = 1;
+
+    num_threads = pool != NULL && c->header->num_blocks > 1 ? thread_pool_size(pool) : 1;
+
+    dec.c = c;
+    dec.cells = cells;
+    dec.ok = malloc(num_threads * sizeof(int));
+    if (dec.ok == NULL) {
+        return 0;
+    }
+
+    if (num_threads > 1) {
+        thread_pool_run(pool, &decode_part, &dec);
+    } else {
+        decode_part(&dec, 0, 1);
+    }
+
+    for (i = 0; i < num_threads; ++i) {
+        ok = ok && dec.ok[i];
+    }
+
+    free(dec.ok);
+    return ok;
+}
+
+int
+compact_write(FILE *f, uint64_t generation, const SnapshotCell *cells, size_t num_cells, ThreadPool *pool)
+{
+    CompactHeader header;
+    CompactEncoder enc;
+    uint64_t *keys;
+    size_t num_threads, i, b, begin, end, offset;
+    int ok = 0;
+
+    // sort by y, then x
+    keys = malloc(num_cells * sizeof(uint64_t) + 1);
+    if (keys == NULL) {
+        return 0;
+    }
+    for (i = 0; i < num_cells; ++i) {
+        keys[i] = radix_sort_pack(cells[i].y, cells[i].x);
+    }
+    if (!radix_sort(keys, num_cells, pool)) {
+        free(keys);
+        return 0;
+    }
+
+    enc.keys = keys;
+    enc.num_cells = num_cells;
+    enc.num_blocks = (num_cells + COMPACT_BLOCK_CELLS - 1) / COMPACT_BLOCK_CELLS;
+    num_threads = pool != NULL && enc.num_blocks > 1 ? thread_pool_size(pool) : 1;
+    enc.index = malloc(enc.num_blocks * sizeof(CompactBlock) + 1);
+    enc.buffers = calloc(num_threads, sizeof(unsigned char *));
+    enc.buffer_sizes = calloc(num_threads, sizeof(size_t));
+
+    if (enc.index != NULL && enc.buffers != NULL && enc.buffer_sizes != NULL) {
+        if (num_threads > 1) {
+            thread_pool_run(pool, &encode_part, &enc);
+        } else {
+            encode_part(&enc, 0, 1);
+        }
+
+        // make the block offsets relative to the end of the index
+        ok = 1;
+        for (i = 0, offset = 0; i < num_threads; ++i) {
+            ok = ok && enc.buffers[i] != NULL;
+            block_range(enc.num_blocks, i, num_threads, &begin, &end);
+            for (b = begin; b < end; ++b) {
+                enc.index[b].offset += offset;
+            }
+            offset += enc.buffer_sizes[i];
+        }
+
+        memset(&header, 0, sizeof(CompactHeader));
+        memcpy(header.magic, COMPACT_MAGIC, sizeof(header.magic));
+        header.version = COMPACT_VERSION;
+        header.block_cells = COMPACT_BLOCK_CELLS;
+        header.generation = generation;
+        header.num_cells = num_cells;
+        header.num_blocks = enc.num_blocks;
+
+        ok = ok && fwrite(&header, sizeof(CompactHeader), 1, f) == 1
+             && fwrite(enc.index, sizeof(CompactBlock), enc.num_blocks, f) == enc.num_blocks;
+        for (i = 0; ok && i < num_threads; ++i) {
+            ok = fwrite(enc.buffers[i], 1, enc.buffer_sizes[i], f) == enc.buffer_sizes[i];
+        }
+    }
+
+    if (enc.buffers != NULL) {
+        for (i = 0; i < num_threads; ++i) {
+            free(enc.buffers[i]);
+        }
+    }
+    free(enc.buffers);
+    free(enc.buffer_sizes);
+    free(enc.index);
+    free(keys);
+    return ok;
+}
@@ -0,0 +1,247 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "life.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+
+/**
+ * A compact file format for the cells of a generation, meant for archiving large states:
+ *
+ *   header | index (num_blocks x CompactBlock) | blocks
+ *
+ * The cells are sorted by y, then x, and split into blocks of block_cells cells (the last block may hold fewer).
+ * The first cell of every block is stored in the index; each following cell is encoded relative to its predecessor
+ * as the varint row delta, followed by either the varint gap to the previous cell in the same row (row delta 0) or
+ * the zigzag varint X delta (new row). Blocks can be decoded independently (random access, parallel decoding) and
+ * are protected by a checksum. All header and index values are stored in native byte order.
+ */
+
+/**
+ * The magic bytes a compact file starts with.
+ */
+#define COMPACT_MAGIC "LIFECMPT"
+
+/**
+ * The current version of the compact format.
+ */
+#define COMPACT_VERSION 1
+
+/**
+ * The number of cells per block written by compact_write().
+ */
+#define COMPACT_BLOCK_CELLS 4096
+
+/**
+ * a type representing the header of a compact file.
+ */
+typedef struct compact_header {
+
+    /**
+     * The magic bytes (COMPACT_MAGIC without the terminating null byte).
+     */
+    char magic[8];
+
+    /**
+     * The version of the compact format.
+     */
+    uint32_t version;
+
+    /**
+     * The number of cells per block.
+     */
+    uint32_t block_cells;
+
+    /**
+     * The number of the generation.
+     */
+    uint64_t generation;
+
+    /**
+     * The number of cells.
+     */
+    uint64_t num_cells;
+
+    /**
+     * The number of blocks.
+     */
+    uint64_t num_blocks;
+
+} CompactHeader;
+
+/**
+ * a type representing an entry of the block index.
+ */
+typedef struct compact_block {
+
+    /**
+     * The offset of the encoded block from the end of the index.
+     */
+    uint64_t offset;
+
+    /**
+     * The size of the encoded block.
+     */
+    uint32_t size;
+
+    /**
+     * The FNV-1a hash of the encoded block.
+     */
+    uint32_t checksum;
+
+    /**
+     * The coordinates of the first cell of the block.
+     */
+    int32_t x;
+    int32_t y;
+
+} CompactBlock;
+
+/**
+ * a type representing a compact file in memory.
+ */
+typedef struct compact {
+
+    /**
+     * The header.
+     */
+    const CompactHeader *header;
+
+    /**
+     * The block index.
+     */
+    const CompactBlock *index;
+
+    /**
+     * The encoded blocks.
+     */
+    const unsigned char *blocks;
+
+} Compact;
+
+/**
+ * Writes an unsigned integer as a varint (7 bits per byte, least significant first).
+ * @param p the output position (with room for 5 bytes).
+ * @param v the integer.
+ * @return the position after the written bytes.
+ */
+static inline unsigned char *
+compact_put_varint(unsigned char *p, uint32_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+/**
+ * Reads a varint.
+ * @param p the position to start at; advanced behind the varint.
+ * @param end the end of the input.
+ * @param out an output parameter for the integer.
+ * @return true if a varint of at most 32 bits was found, false otherwise.
+ */
+static inline int
+compact_get_varint(const unsigned char **p, const unsigned char *end, uint32_t *out)
+{
+    const unsigned char *s = *p;
+    uint32_t v = 0;
+    unsigned int shift;
+
+    for (shift = 0; shift < 35 && s < end; shift += 7) {
+        v |= (uint32_t)(*s & 0x7f) << shift;
+        if (!(*s++ & 0x80)) {
+            *out = v;
+            *p = s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Maps a (wrapped around) signed difference to an unsigned integer, small magnitudes to small values.
+ * @param d the difference of two 32-bit coordinates, computed modulo 2^32.
+ * @return the zigzag encoded difference.
+ */
+static inline uint32_t
+compact_zigzag(uint32_t d)
+{
+    return (d << 1) ^ (uint32_t)((int32_t)d >> 31);
+}
+
+/**
+ * Reverses compact_zigzag().
+ * @param v the zigzag encoded difference.
+ * @return the difference modulo 2^32.
+ */
+static inline uint32_t
+compact_unzigzag(uint32_t v)
+{
+    return (v >> 1) ^ -(v & 1);
+}
+
+/**
+ * Checks whether a memory region holds a compact file with a consistent index and sets up a compact instance
+ * pointing into it (the blocks themselves are checked when they are decoded).
+ * @param c a pointer to an allocated compact instance.
+ * @param data the memory region (e.g. a mapped file).
+ * @param size the size of the memory region.
+ * @return true if the region holds a compact file, false otherwise.
+ */
+int
+compact_parse(Compact *c, const void *data, size_t size);
+
+/**
+ * Returns the number of cells of a block.
+ * @param c the compact file.
+ * @param block the index of the block.
+ * @return the number of cells.
+ */
+static inline size_t
+compact_block_size(const Compact *c, size_t block)
+{
+    return block + 1 < c->header->num_blocks
+           ? c->header->block_cells
+           : c->header->num_cells - block * (size_t)c->header->block_cells;
+}
+
+/**
+ * Decodes a single block; cell i of the file is the cell i % block_cells of block i / block_cells.
+ * @param c the compact file.
+ * @param block the index of the block.
+ * @param cells the output array (with room for compact_block_size() cells).
+ * @return true if the block was decoded successfully, false if it is corrupt.
+ */
+int
+compact_decode_block(const Compact *c, size_t block, Point2D *cells);
+
+/**
+ * Decodes all cells, sorted by y, then x.
+ * @param c the compact file.
+ * @param cells the output array (with room for num_cells cells).
+ * @param pool a thread pool decoding the blocks in parallel, or NULL.
+ * @return true if all blocks were decoded successfully, false if one of them is corrupt.
+ */
+int
+compact_decode(const Compact *c, Point2D *cells, ThreadPool *pool);
+
+/**
+ * Writes a compact file.
+ * @param f the output file.
+ * @param generation the number of the generation.
+ * @param cells the cells (in any order).
+ * @param num_cells the number of cells.
+ * @param pool a thread pool sorting and encoding the cells in parallel, or NULL.
+ * @return true if the file was written successfully, false otherwise.
+ */
+int
+compact_write(FILE *f, uint64_t generation, const SnapshotCell *cells, size_t num_cells, ThreadPool *pool);
+
+#endif
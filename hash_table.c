@@ -2,9 +2,15 @@
 #include "hash_table.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
+/**
+ * The last epoch before the epochs wrap around (see hash_table_clear()).
+ */
+#define EPOCH_MAX UCHAR_MAX
+
 /**
  * Checks if a number is a power of two.
  * @param n the number to check.
@@ -31,16 +37,61 @@ ceil_pow2(size_t n)
 }
 
 /**
- * Returns the index of the bucket for a given key.
+ * Returns the bucket index for a given key; during an incremental rehash, this is the index of the key's old bucket
+ * as long as that one has not been migrated (the old buckets follow the buckets).
  * @param tbl a pointer to the hash table instance as returned by hash_table_create().
  * @param key the key.
  * @return the bucket index.
  */
 static inline size_t
-bucket_idx(HashTable *tbl, const hash_table_key_t key)
+bucket_idx_of(HashTable *tbl, const hash_table_key_t key)
 {
+    unsigned int hash_val = tbl->hash_func(key);
+    size_t idx;
+
     assert(is_pow2(tbl->num_buckets));
-    return tbl->hash_func(key) & (tbl->num_buckets - 1);
+
+    if (tbl->old_buckets != NULL) {
+        idx = hash_val & (tbl->old_num_buckets - 1);
+        if (idx >= tbl->migrate_idx) {
+            return tbl->num_buckets + idx;
+        }
+    }
+    return hash_val & (tbl->num_buckets - 1);
+}
+
+/**
+ * Returns the first element of a bucket; a bucket last written in an earlier epoch is empty.
+ * @param tbl a pointer to the hash table instance.
+ * @param idx the bucket index (the old buckets of an incremental rehash follow the buckets).
+ * @return the first element of the bucket or NULL if the bucket is empty.
+ */
+static inline HashTableElem *
+bucket_head(HashTable *tbl, size_t idx)
+{
+    if (idx >= tbl->num_buckets) {
+        return tbl->old_buckets[idx - tbl->num_buckets];
+    }
+    return tbl->bucket_epochs[idx] == tbl->epoch ? tbl->buckets[idx] : NULL;
+}
+
+/**
+ * Returns a bucket for modification; a bucket last written in an earlier epoch is emptied first.
+ * @param tbl a pointer to the hash table instance.
+ * @param idx the bucket index (the old buckets of an incremental rehash follow the buckets).
+ * @return a pointer to the head of the bucket.
+ */
+static inline HashTableElem **
+bucket_of(HashTable *tbl, size_t idx)
+{
+    if (idx >= tbl->num_buckets) {
+        return &tbl->old_buckets[idx - tbl->num_buckets];
+    }
+    if (tbl->bucket_epochs[idx] != tbl->epoch) {
+        tbl->buckets[idx] = NULL;
+        tbl->bucket_epochs[idx] = tbl->epoch;
+    }
+    return &tbl->buckets[idx];
 }
 
 /**
@@ -48,24 +99,27 @@ bucket_idx(HashTable *tbl, const hash_table_key_t key)
  * @param tbl a pointer to the hash table instance.
  * @param key the key.
  * @param val the value.
- * @param bucket_idx the bucket index for the given key.
- * @return a newly created hash table element allocated on the heap, or NULL if heap allocation failed.
+ * @return a hash table element taken from the free list or the slabs, or NULL if heap allocation failed.
  */
 static inline HashTableElem *
-create_elem(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val, size_t bucket_idx)
+create_elem(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val)
 {
     HashTableElem *new_elem;
 
-    // allocate heap memory
-    new_elem = (HashTableElem *)malloc(sizeof(HashTableElem));
-    if (new_elem == NULL) {
-        return NULL;
+    // reuse a removed element first
+    new_elem = tbl->free_list;
+    if (new_elem != NULL) {
+        tbl->free_list = new_elem->next;
+    } else {
+        new_elem = (HashTableElem *)arena_alloc(tbl->slabs, sizeof(HashTableElem));
+        if (new_elem == NULL) {
+            return NULL;
+        }
     }
 
     // set struct members
     new_elem->entry.key = key;
     new_elem->entry.val = val;
-    new_elem->bucket_idx = bucket_idx;
     new_elem->next = NULL;
 
     return new_elem;
@@ -81,12 +135,9 @@ static inline HashTableElem *
 find_elem(HashTable *tbl, const hash_table_key_t key)
 {
     HashTableElem *e;
-    size_t idx;
     int cmp_val;
 
-    idx = bucket_idx(tbl, key);
-
-    for (e = tbl->buckets[idx]; e != NULL; e = e->next) {
+    for (e = bucket_head(tbl, bucket_idx_of(tbl, key)); e != NULL; e = e->next) {
         cmp_val = tbl->cmp_func(e->entry.key, key);
         if (cmp_val == 0) {
             return e;
@@ -98,76 +149,104 @@ find_elem(HashTable *tbl, const hash_table_key_t key)
 }
 
 /**
- * Returns the next hash table element for a current element and bucket index.
+ * Returns the first hash table element within a range of buckets; the old buckets of an incremental rehash follow
+ * the buckets.
  * @param tbl a pointer to the hash table instance.
- * @param bucket_idx the index of the current bucket.
- * @param current the current hash table element.
- * @return the next hash table element or NULL if there is no other element left.
+ * @param begin_idx the bucket index to start at (inclusive).
+ * @param end_idx the bucket index to stop at (exclusive).
+ * @param out_idx an output parameter for the bucket index of the found element.
+ * @return the first hash table element or NULL if no element is present.
  */
 static inline HashTableElem *
-next_elem(HashTable *tbl, HashTableElem *current)
+first_elem(HashTable *tbl, size_t begin_idx, size_t end_idx, size_t *out_idx)
 {
     size_t idx;
 
-    assert(current != NULL);
-
-    // case 1: bucket contains another element
-    if (current->next != NULL) {
-        return current->next;
+    if (hash_table_size(tbl) == 0) {
+        return NULL;
     }
-    // case 2: look for next non-empty bucket
-    for (idx = current->bucket_idx + 1; idx < tbl->num_buckets; ++idx) {
-        if (tbl->buckets[idx] != NULL) {
+
+    for (idx = begin_idx; idx < end_idx && idx < tbl->num_buckets; ++idx) {
+        if (bucket_head(tbl, idx) != NULL) {
+            *out_idx = idx;
             return tbl->buckets[idx];
         }
     }
+
+    // the migrated old buckets are empty
+    if (idx < tbl->num_buckets + tbl->migrate_idx) {
+        idx = tbl->num_buckets + tbl->migrate_idx;
+    }
+    for (; idx < end_idx; ++idx) {
+        if (bucket_head(tbl, idx) != NULL) {
+            *out_idx = idx;
+            return tbl->old_buckets[idx - tbl->num_buckets];
+        }
+    }
     return NULL;
 }
 
 /**
- * Returns the first hash table element.
+ * Returns the next hash table element for a current element and bucket index.
  * @param tbl a pointer to the hash table instance.
- * @return the first hash table element or NULL if no element is present.
+ * @param current the current hash table element.
+ * @param idx the bucket index of the current element; set to the bucket index of the next element.
+ * @param end_idx the bucket index to stop at (exclusive).
+ * @return the next hash table element or NULL if there is no other element left.
  */
 static inline HashTableElem *
-first_elem(HashTable *tbl)
+next_elem(HashTable *tbl, HashTableElem *current, size_t *idx, size_t end_idx)
 {
-    size_t idx;
+    assert(current != NULL);
 
-    if (hash_table_size(tbl) == 0) {
-        return NULL;
+    // case 1: bucket contains another element
+    if (current->next != NULL) {
+        return current->next;
     }
+    // case 2: look for next non-empty bucket
+    return first_elem(tbl, *idx + 1, end_idx, idx);
+}
 
-    for (idx = 0; idx < tbl->num_buckets; ++idx) {
-        if (tbl->buckets[idx] != NULL) {
-            return tbl->buckets[idx];
-        }
-    }
+/**
+ * Returns the number of bucket indices an iteration runs through (the buckets, followed by the old buckets).
+ * @param tbl a pointer to the hash table instance.
+ * @return the number of bucket indices.
+ */
+static inline size_t
+iter_span(HashTable *tbl)
+{
+    return tbl->num_buckets + tbl->old_num_buckets;
+}
 
-    /* NOTREACHED */
-    assert(true);
-    return NULL;
+/**
+ * Frees the old bucket array of an incremental rehash.
+ * @param tbl the hash table.
+ */
+static inline void
+drop_old_buckets(HashTable *tbl)
+{
+    free(tbl->old_buckets);
+    tbl->old_buckets = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
 }
 
 /**
- * Frees memory allocated for the hash table elements.
+ * Releases all hash table elements at once by resetting the slabs; the buckets are emptied by starting a new epoch,
+ * only when the epochs wrap around, the epochs of all buckets are reset.
  * @param tbl the hash table.
  */
 static inline void
 free_elems(HashTable *tbl)
 {
-    size_t i;
-    HashTableElem *p, *e;
-
-    for (i = 0; i < tbl->num_buckets; ++i) {
-        p = tbl->buckets[i];
-        while (p != NULL) {
-            e = p->next;
-            free(p);
-            p = e;
-        }
-        tbl->buckets[i] = NULL;
+    if (tbl->epoch == EPOCH_MAX) {
+        memset(tbl->bucket_epochs, 0, tbl->num_buckets);
+        tbl->epoch = 0;
     }
+    tbl->epoch++;
+    drop_old_buckets(tbl);
+    arena_reset(tbl->slabs);
+    tbl->free_list = NULL;
 }
 
 /**
@@ -181,7 +260,55 @@ current_load(HashTable *tbl)
 }
 
 /**
- * Rehashes the hash table with 2x no. of buckets.
+ * Migrates old buckets of an incremental rehash into the buckets; the old bucket array is freed when all of them are
+ * migrated. Elements are relinked, but never moved.
+ * @param tbl the hash table.
+ * @param num_old_buckets the (maximum) number of old buckets to migrate.
+ */
+static void
+migrate(HashTable *tbl, size_t num_old_buckets)
+{
+    HashTableElem *elem, *elem_next, *e, *p;
+    size_t idx;
+    int cmp_val;
+
+    for (; num_old_buckets > 0 && tbl->migrate_idx < tbl->old_num_buckets; --num_old_buckets, ++tbl->migrate_idx) {
+        elem = tbl->old_buckets[tbl->migrate_idx];
+        tbl->old_buckets[tbl->migrate_idx] = NULL;
+
+        for (; elem != NULL; elem = elem_next) {
+            elem_next = elem->next;
+
+            // calculate new bucket index
+            idx = tbl->hash_func(elem->entry.key) & (tbl->num_buckets - 1);
+
+            // find correct position in new bucket
+            for (e = *bucket_of(tbl, idx), p = NULL; e != NULL; p = e, e = e->next) {
+                cmp_val = tbl->cmp_func(e->entry.key, elem->entry.key);
+                assert(cmp_val != 0);
+                if (cmp_val > 0) {
+                    break;
+                }
+            }
+
+            // insert element into new bucket
+            elem->next = e;
+            if (p == NULL) {
+                tbl->buckets[idx] = elem;
+            } else {
+                p->next = elem;
+            }
+        }
+    }
+
+    if (tbl->migrate_idx == tbl->old_num_buckets) {
+        drop_old_buckets(tbl);
+    }
+}
+
+/**
+ * Rehashes the hash table with 2x no. of buckets; in incremental mode, the elements are only migrated by the
+ * following insertions (an incremental rehash still in progress is completed first).
  * @param tbl the hash table to rehash
  * @return true if the operation succeeded, false otherwise
  */
@@ -189,52 +316,40 @@ static int
 rehash(HashTable *tbl)
 {
     HashTableElem **new_buckets;
+    unsigned char *new_bucket_epochs;
     size_t new_num_buckets, idx;
-    HashTableElem *elem, *elem_next, *e, *p;
-    int cmp_val;
 
-    // allocate new bucket array
+    if (tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->old_num_buckets);
+    }
+
+    // allocate new bucket array; its buckets are of no epoch yet
     new_num_buckets = tbl->num_buckets * 2;
-    new_buckets = calloc(new_num_buckets, sizeof(HashTableElem *));
-    if (new_buckets == NULL) {
+    new_buckets = malloc(new_num_buckets * sizeof(HashTableElem *));
+    new_bucket_epochs = calloc(new_num_buckets, 1);
+    if (new_buckets == NULL || new_bucket_epochs == NULL) {
+        free(new_buckets);
+        free(new_bucket_epochs);
         return 0;
     }
 
-    // perform rehashing
-    elem = first_elem(tbl);
-    while (elem != NULL) {
-        elem_next = next_elem(tbl, elem);
-
-        // calculate new bucket index
-        idx = tbl->hash_func(elem->entry.key) & (new_num_buckets - 1);
-
-        // find correct position in new bucket
-        for (e = new_buckets[idx], p = NULL; e != NULL; p = e, e = e->next) {
-            cmp_val = tbl->cmp_func(e->entry.key, elem->entry.key);
-            assert(cmp_val != 0);
-            if (cmp_val > 0) {
-                break;
-            }
-        }
-
-        // insert element into new bucket
-        if (p == NULL) {
-            // insert as head
-            elem->next = new_buckets[idx];
-            elem->bucket_idx = idx;
-            new_buckets[idx] = elem;
-        } else {
-            elem->next = e;
-            elem->bucket_idx = idx;
-            p->next = elem;
-        }
-
-        elem = elem_next;
+    // the old buckets carry no epochs, the ones of earlier epochs are emptied
+    for (idx = 0; idx < tbl->num_buckets; ++idx) {
+        tbl->buckets[idx] = bucket_head(tbl, idx);
     }
+    free(tbl->bucket_epochs);
+    tbl->bucket_epochs = new_bucket_epochs;
 
-    free(tbl->buckets);
-    tbl->num_buckets = new_num_buckets;
+    tbl->old_buckets = tbl->buckets;
+    tbl->old_num_buckets = tbl->num_buckets;
+    tbl->migrate_idx = 0;
     tbl->buckets = new_buckets;
+    tbl->num_buckets = new_num_buckets;
+
+    // perform rehashing
+    if (tbl->rehash_step == 0) {
+        migrate(tbl, tbl->old_num_buckets);
+    }
 
     return 1;
 }
@@ -253,12 +368,32 @@ hash_table_create(size_t num_buckets, float load_factor, hash_function *hash_fun
         return NULL;
     }
 
-    // allocate buckets
-    tbl->buckets = calloc(num_buckets, sizeof(HashTableElem *));
-    if (tbl->buckets == NULL) {
+    // allocate buckets; they are of no epoch yet
+    tbl->buckets = malloc(num_buckets * sizeof(HashTableElem *));
+    tbl->bucket_epochs = calloc(num_buckets, 1);
+    if (tbl->buckets == NULL || tbl->bucket_epochs == NULL) {
+        free(tbl->buckets);
+        free(tbl->bucket_epochs);
+        free(tbl);
+        return NULL;
+    }
+    tbl->epoch = 1;
+
+    // allocate the first slab for the elements
+    tbl->slabs = arena_create(HASH_TABLE_SLAB_SIZE);
+    if (tbl->slabs == NULL) {
+        free(tbl->buckets);
+        free(tbl->bucket_epochs);
         free(tbl);
         return NULL;
     }
+    tbl->free_list = NULL;
+
+    // rehash all at once by default
+    tbl->old_buckets = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+    tbl->rehash_step = 0;
 
     // set values for hash table struct members
     tbl->num_buckets = num_buckets;
@@ -270,63 +405,102 @@ hash_table_create(size_t num_buckets, float load_factor, hash_function *hash_fun
     return tbl;
 }
 
-int
-hash_table_put(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val)
+void
+hash_table_set_incremental_rehash(HashTable *tbl, int incremental)
 {
-    HashTableElem *elem, *prev_elem, *new_elem;
-    size_t idx;
-    int cmp_val;
+    // a rehash starts with num_buckets * load_factor elements and is due again after as many insertions; migrating
+    // ceil(1 / load_factor) old buckets per insertion completes it in time
+    tbl->rehash_step = incremental ? (size_t)(1.0f / tbl->load_factor) + 1 : 0;
+    if (!incremental && tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->old_num_buckets);
+    }
+}
 
-    idx = bucket_idx(tbl, key);
+/**
+ * Looks for the hash table element for a given key and adds a new element if there is none.
+ * @param tbl a pointer to the hash table instance.
+ * @param key the key.
+ * @param val the value of the element to add.
+ * @param out_added an output parameter set to true if a new element was added, false otherwise.
+ * @return the hash table element for the key, or NULL if heap allocation failed.
+ */
+static HashTableElem *
+find_or_add_elem(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val, int *out_added)
+{
+    HashTableElem **bucket, *elem, *prev_elem, *new_elem;
+    int cmp_val;
 
-    // handle empty bucket case
-    if (tbl->buckets[idx] == NULL) {
-        new_elem = create_elem(tbl, key, val, idx);
-        if (new_elem == NULL) {
-            return 0;
-        }
-        tbl->buckets[idx] = new_elem;
-    }
-    // target bucket is not empty => find correct position in bucket
-    else {
-        // look for correct position in the bucket
-        for (elem = tbl->buckets[idx], prev_elem = NULL; elem != NULL; prev_elem = elem, elem = elem->next) {
-            cmp_val = tbl->cmp_func(elem->entry.key, key);
-            if (cmp_val >= 0)
-                break;
-        }
+    bucket = bucket_of(tbl, bucket_idx_of(tbl, key));
 
-        // found equal element => replace value
+    // look for correct position in the bucket (empty buckets included)
+    for (elem = *bucket, prev_elem = NULL; elem != NULL; prev_elem = elem, elem = elem->next) {
+        cmp_val = tbl->cmp_func(elem->entry.key, key);
         if (cmp_val == 0) {
-            elem->entry.val = val;
-            return 1;
-        }
-        // found greater element => insert new element into bucket before the found element
-        else {
-            new_elem = create_elem(tbl, key, val, idx);
-            if (new_elem == NULL) {
-                return 0;
-            }
-            if (prev_elem == NULL) {
-                // insert as head
-                new_elem->next = tbl->buckets[idx];
-                tbl->buckets[idx] = new_elem;
-            } else {
-                new_elem->next = elem;
-                prev_elem->next = new_elem;
-            }
+            // found equal element
+            *out_added = 0;
+            return elem;
+        } else if (cmp_val > 0) {
+            break;
         }
     }
 
+    // found greater element or end of bucket => insert new element into bucket before the found element
+    new_elem = create_elem(tbl, key, val);
+    if (new_elem == NULL) {
+        return NULL;
+    }
+    if (prev_elem == NULL) {
+        // insert as head
+        new_elem->next = *bucket;
+        *bucket = new_elem;
+    } else {
+        new_elem->next = elem;
+        prev_elem->next = new_elem;
+    }
+
     tbl->num_elems++;
 
+    // rehashing relinks but never moves elements => new_elem stays valid
+    if (tbl->old_buckets != NULL) {
+        migrate(tbl, tbl->rehash_step);
+    }
     if (current_load(tbl) > tbl->load_factor) {
         rehash(tbl);
     }
 
+    *out_added = 1;
+    return new_elem;
+}
+
+int
+hash_table_put(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val)
+{
+    HashTableElem *elem;
+    int added;
+
+    elem = find_or_add_elem(tbl, key, val, &added);
+    if (elem == NULL) {
+        return 0;
+    }
+
+    // found equal element => replace value
+    if (!added) {
+        elem->entry.val = val;
+    }
+
     return 1;
 }
 
+hash_table_val_t
+hash_table_get_or_put(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val)
+{
+    HashTableElem *elem;
+    int added;
+
+    elem = find_or_add_elem(tbl, key, val, &added);
+    return (elem != NULL) ? elem->entry.val : HASH_TABLE_VAL_NONE;
+}
+
 hash_table_val_t
 hash_table_get(HashTable *tbl, const hash_table_key_t key)
 {
@@ -343,15 +517,14 @@ hash_table_contains(HashTable *tbl, const hash_table_key_t key)
 hash_table_val_t
 hash_table_remove(HashTable *tbl, const hash_table_key_t key)
 {
-    HashTableElem *e, *p;
-    size_t idx;
+    HashTableElem **bucket, *e, *p;
     hash_table_val_t val;
     int cmp_val;
 
-    idx = bucket_idx(tbl, key);
+    bucket = bucket_of(tbl, bucket_idx_of(tbl, key));
 
     // find element
-    for (e = tbl->buckets[idx], p = NULL; e != NULL; p =e, e = e->next) {
+    for (e = *bucket, p = NULL; e != NULL; p =e, e = e->next) {
         cmp_val = tbl->cmp_func(e->entry.key, key);
         if (cmp_val == 0) {
             val = e->entry.val;
@@ -359,14 +532,15 @@ hash_table_remove(HashTable *tbl, const hash_table_key_t key)
             // remove element from hash table
             if (p == NULL) {
                 // case 1: element is head
-                tbl->buckets[idx] = e->next;
+                *bucket = e->next;
             }
             else {
                 // case 2: element is in list
                 p->next = e->next;
             }
             tbl->num_elems--;
-            free(e);
+            e->next = tbl->free_list;
+            tbl->free_list = e;
 
             return val;
         } else if (cmp_val > 0) {
@@ -380,7 +554,9 @@ void
 hash_table_map(HashTable *tbl, map_function map_func)
 {
     HashTableElem* elem;
-    for (elem = first_elem(tbl); elem != NULL; elem = next_elem(tbl, elem)) {
+    size_t idx, end_idx = iter_span(tbl);
+    for (elem = first_elem(tbl, 0, end_idx, &idx); elem != NULL;
+         elem = next_elem(tbl, elem, &idx, end_idx)) {
         map_func(&elem->entry);
     }
 }
@@ -396,7 +572,19 @@ hash_table_iter_init(HashTable *tbl, HashTableIter *iter)
 {
     iter->tbl = tbl;
     iter->current = NULL;
-    iter->next = first_elem(tbl);
+    iter->end_idx = iter_span(tbl);
+    iter->next = first_elem(tbl, 0, iter->end_idx, &iter->next_idx);
+}
+
+void
+hash_table_iter_init_part(HashTable *tbl, HashTableIter *iter, size_t part, size_t num_parts)
+{
+    size_t span = iter_span(tbl);
+
+    iter->tbl = tbl;
+    iter->current = NULL;
+    iter->end_idx = part + 1 == num_parts ? span : span / num_parts * (part + 1);
+    iter->next = first_elem(tbl, span / num_parts * part, iter->end_idx, &iter->next_idx);
 }
 
 int
@@ -413,7 +601,7 @@ hash_table_iter_next(HashTableIter *iter)
     }
 
     iter->current = iter->next;
-    iter->next = next_elem(iter->tbl, iter->current);
+    iter->next = next_elem(iter->tbl, iter->current, &iter->next_idx, iter->end_idx);
 }
 
 HashTableEntry *
@@ -450,12 +638,16 @@ hash_table_clear(HashTable *tbl)
 void
 hash_table_destroy(HashTable *tbl)
 {
-    // free hash table elements first
-    free_elems(tbl);
+    // free the slabs holding the hash table elements first
+    arena_destroy(tbl->slabs);
+    tbl->slabs = NULL;
+    drop_old_buckets(tbl);
 
     // free bucket array
     free(tbl->buckets);
+    free(tbl->bucket_epochs);
     tbl->buckets = NULL;
+    tbl->bucket_epochs = NULL;
 
     // free hash table
     free(tbl);
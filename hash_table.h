@@ -3,6 +3,8 @@
 
 #include <stdlib.h>
 
+#include "arena.h"
+
 /**
  * A basic hash table implementation.
  */
@@ -10,6 +12,11 @@
 typedef void* hash_table_key_t;
 typedef void* hash_table_val_t;
 
+/**
+ * The size of the slabs the elements of a hash table are allocated from.
+ */
+#define HASH_TABLE_SLAB_SIZE (1 << 16)
+
 /**
  * Constants used to indicate none.
  */
@@ -37,11 +44,6 @@ typedef struct hash_table_elem {
      */
     HashTableEntry entry;
 
-    /**
-     * The bucket the element resides in.
-     */
-    size_t bucket_idx;
-
     /**
      * a pointer to the next hash element in the bucket.
      */
@@ -91,6 +93,47 @@ typedef struct hash_table {
      */
     HashTableElem **buckets;
 
+    /**
+     * the epoch in which each bucket was last written; a bucket of an earlier epoch is empty.
+     */
+    unsigned char *bucket_epochs;
+
+    /**
+     * the current epoch (1 .. UCHAR_MAX); hash_table_clear() empties all buckets at once by starting a new one.
+     */
+    unsigned char epoch;
+
+    /**
+     * the slabs the elements are allocated from; released all at once by hash_table_clear().
+     */
+    Arena *slabs;
+
+    /**
+     * removed elements, reused before new ones are taken from the slabs.
+     */
+    HashTableElem *free_list;
+
+    /**
+     * the bucket array being migrated into the buckets during an incremental rehash, or NULL.
+     * A key whose old bucket has not been migrated yet is stored in the old bucket.
+     */
+    HashTableElem **old_buckets;
+
+    /**
+     * the number of old buckets (0 if there is no incremental rehash in progress).
+     */
+    size_t old_num_buckets;
+
+    /**
+     * the index of the next old bucket to migrate.
+     */
+    size_t migrate_idx;
+
+    /**
+     * the number of old buckets migrated per insertion, or 0 if the table is rehashed all at once.
+     */
+    size_t rehash_step;
+
 } HashTable;
 
 /**
@@ -113,6 +156,16 @@ typedef struct hash_table_iter {
      */
     HashTableElem *next;
 
+    /**
+     * the bucket index of the next element; the old buckets of an incremental rehash follow the buckets.
+     */
+    size_t next_idx;
+
+    /**
+     * the bucket index the iteration stops at (exclusive).
+     */
+    size_t end_idx;
+
 } HashTableIter;
 
 /**
@@ -126,6 +179,17 @@ typedef struct hash_table_iter {
 HashTable *
 hash_table_create(size_t num_buckets, float load_factor, hash_function *hash_func, compare_function *cmp_func);
 
+/**
+ * Switches a hash table between rehashing all at once (the default) and incremental rehashing.
+ * An incremental rehash keeps the old bucket array next to the new one and every insertion migrates a few old
+ * buckets (enough to finish before the next rehash is due); a key is looked up in its old bucket until that one is
+ * migrated.
+ * @param tbl a pointer to the hash table instance.
+ * @param incremental true to rehash incrementally, false to rehash all at once.
+ */
+void
+hash_table_set_incremental_rehash(HashTable *tbl, int incremental);
+
 /**
  * Puts a key, value pair into the hash table.
  * @param tbl a pointer to the hash table instance as returned by hash_table_create().
@@ -136,6 +200,17 @@ hash_table_create(size_t num_buckets, float load_factor, hash_function *hash_fun
 int
 hash_table_put(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val);
 
+/**
+ * Retrieves the value for a given key, putting the given key, value pair into the hash table first if the key is not
+ * present yet.
+ * @param tbl a pointer to the hash table instance as returned by hash_table_create().
+ * @param key the key.
+ * @param val the value to put if the key is not present.
+ * @return the value stored for the key (i.e. val if the pair was inserted), or NULL if inserting failed.
+ */
+hash_table_val_t
+hash_table_get_or_put(HashTable *tbl, const hash_table_key_t key, const hash_table_val_t val);
+
 /**
  * Retrieves a value for a given key from the hash table instance.
  * @param tbl a pointer to the hash table instance.
@@ -188,6 +263,19 @@ hash_table_size(HashTable *tbl);
 void
 hash_table_iter_init(HashTable *tbl, HashTableIter *iter);
 
+/**
+ * Initializes an iterator instance for iterating over the entries of one part of a hash table.
+ * The bucket array is split into num_parts contiguous ranges of (almost) equal size; iterators over distinct parts
+ * visit disjoint sets of entries and may be used concurrently.
+ * WARNING: do not modify the hash table upon iteration!
+ * @param tbl a pointer to the hash table instance.
+ * @param iter a pointer to a allocated hash table iterator instance.
+ * @param part the index of the part to iterate over (0 .. num_parts - 1).
+ * @param num_parts the number of parts.
+ */
+void
+hash_table_iter_init_part(HashTable *tbl, HashTableIter *iter, size_t part, size_t num_parts);
+
 /**
  * Checks if the iterator can deliver another item.
  * @param iter a pointer to the hash table iterator instance.
@@ -228,7 +316,7 @@ hash_table_val_t
 hash_table_iter_get_value(HashTableIter *iter);
 
 /**
- * Removes all entries currently present in the hash table.
+ * Removes all entries currently present in the hash table; the elements are released with their slabs at once.
  * @param tbl a pointer to the hash table instance.
  */
 void
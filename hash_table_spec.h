@@ -0,0 +1,749 @@
+/**
+ * A hash table specialized at compile time for one key and value type.
+ *
+ * Works like the generic hash table (see hash_table.h), but keys are stored inline in the elements and the hash and
+ * compare functions are known to the compiler, so bucket walks need neither indirect calls nor a pointer chase to
+ * reach a key. A table is instantiated by defining the following macros and including this header (which may be
+ * included once per instantiation):
+ *
+ *   HASH_TABLE_SPEC_PREFIX    the prefix of the generated functions, e.g. point_table
+ *   HASH_TABLE_SPEC_TYPE      the name of the generated table type, e.g. PointTable (the element and iterator types
+ *                             are named PointTableElem and PointTableIter)
+ *   HASH_TABLE_SPEC_KEY_T     the key type, e.g. Point2D
+ *   HASH_TABLE_SPEC_VAL_T     the value type, e.g. Cell *
+ *   HASH_TABLE_SPEC_HASH      a function unsigned int (const KEY_T *) hashing a key
+ *   HASH_TABLE_SPEC_CMP       a function int (const KEY_T *, const KEY_T *) comparing two keys (a total order)
+ *   HASH_TABLE_SPEC_VAL_NONE  (optional) the value returned when a key is not present, NULL by default
+ *
+ * The generated functions behave like their hash_table_*() counterparts, except that keys are passed as pointers and
+ * copied into the table. The macros are undefined at the end of this header. Including the header without defining
+ * HASH_TABLE_SPEC_PREFIX only declares the helpers below (e.g. for the hash function of an instantiation).
+ */
+
+#ifndef HASH_TABLE_SPEC_H
+#define HASH_TABLE_SPEC_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "hash_table.h"
+
+#define HASH_TABLE_SPEC_CONCAT_(a, b) a##b
+#define HASH_TABLE_SPEC_CONCAT(a, b) HASH_TABLE_SPEC_CONCAT_(a, b)
+
+/**
+ * FNV hash function implementation for arbitrary bytes, inlined so that the loop is unrolled for constant sizes
+ * (same hash values as hash_bytes()).
+ * @param data the value to hash
+ * @param size the size of the value
+ * @return the calculated hash value.
+ */
+static inline unsigned int
+hash_table_spec_bytes(const void *data, size_t size)
+{
+    const unsigned char *_data = (const unsigned char *)data;
+    unsigned int hash = FNV_32_BASIS;
+
+    while (size-- > 0)
+        hash = (hash * FNV_32_PRIME) ^ *_data++;
+
+    return hash;
+}
+
+#endif /* HASH_TABLE_SPEC_H */
+
+#ifdef HASH_TABLE_SPEC_PREFIX
+
+#if !defined(HASH_TABLE_SPEC_TYPE) || !defined(HASH_TABLE_SPEC_KEY_T) || !defined(HASH_TABLE_SPEC_VAL_T) \
+    || !defined(HASH_TABLE_SPEC_HASH) || !defined(HASH_TABLE_SPEC_CMP)
+#error "hash_table_spec.h: all table parameters must be defined before inclusion"
+#endif
+
+#ifndef HASH_TABLE_SPEC_VAL_NONE
+#define HASH_TABLE_SPEC_VAL_NONE NULL
+#endif
+
+#define HTS_TBL HASH_TABLE_SPEC_TYPE
+#define HTS_ELEM HASH_TABLE_SPEC_CONCAT(HASH_TABLE_SPEC_TYPE, Elem)
+#define HTS_ITER HASH_TABLE_SPEC_CONCAT(HASH_TABLE_SPEC_TYPE, Iter)
+#define HTS_FN(name) HASH_TABLE_SPEC_CONCAT(HASH_TABLE_SPEC_PREFIX, _##name)
+#define HTS_KEY HASH_TABLE_SPEC_KEY_T
+#define HTS_VAL HASH_TABLE_SPEC_VAL_T
+
+/**
+ * Represents an element put into a bucket of the hash table.
+ */
+typedef struct HTS_ELEM {
+
+    /**
+     * the key (stored inline).
+     */
+    HTS_KEY key;
+
+    /**
+     * the value.
+     */
+    HTS_VAL val;
+
+    /**
+     * a pointer to the next hash element in the bucket.
+     */
+    struct HTS_ELEM *next;
+
+} HTS_ELEM;
+
+/**
+ * Represents a hash table.
+ */
+typedef struct HTS_TBL {
+
+    /**
+     * the number of buckets.
+     */
+    size_t num_buckets;
+
+    /**
+     * a factor that controls growing + rehashing of the hash table.
+     */
+    float load_factor;
+
+    /**
+     * the number of elements currently held by the hash table.
+     */
+    size_t num_elems;
+
+    /**
+     * an array of buckets.
+     */
+    HTS_ELEM **buckets;
+
+    /**
+     * the epoch in which each bucket was last written, the current epoch (see hash_table.h).
+     */
+    unsigned char *bucket_epochs;
+    unsigned char epoch;
+
+    /**
+     * the slabs the elements are allocated from (see hash_table.h).
+     */
+    Arena *slabs;
+
+    /**
+     * removed elements, reused before new ones are taken from the slabs.
+     */
+    HTS_ELEM *free_list;
+
+    /**
+     * the bucket array being migrated during an incremental rehash, or NULL (see hash_table.h).
+     */
+    HTS_ELEM **old_buckets;
+
+    /**
+     * the number of old buckets (0 if there is no incremental rehash in progress).
+     */
+    size_t old_num_buckets;
+
+    /**
+     * the index of the next old bucket to migrate.
+     */
+    size_t migrate_idx;
+
+    /**
+     * the number of old buckets migrated per insertion, or 0 if the table is rehashed all at once.
+     */
+    size_t rehash_step;
+
+} HTS_TBL;
+
+/**
+ * Represents a hash table iterator.
+ */
+typedef struct HTS_ITER {
+
+    /**
+     * the hash table for iterating over.
+     */
+    HTS_TBL *tbl;
+
+    /**
+     * a pointer to the current element in the current bucket.
+     */
+    HTS_ELEM *current;
+
+    /**
+     * a pointer to the next element (may be in another bucket).
+     */
+    HTS_ELEM *next;
+
+    /**
+     * the bucket index of the next element; the old buckets of an incremental rehash follow the buckets.
+     */
+    size_t next_idx;
+
+    /**
+     * the bucket index the iteration stops at (exclusive).
+     */
+    size_t end_idx;
+
+} HTS_ITER;
+
+/**
+ * Returns the bucket index for a given key; during an incremental rehash, this is the index of the key's old bucket
+ * as long as that one has not been migrated (the old buckets follow the buckets).
+ */
+static inline size_t
+HTS_FN(bucket_idx_of)(const HTS_TBL *tbl, const HTS_KEY *key)
+{
+    unsigned int hash_val = HASH_TABLE_SPEC_HASH(key);
+    size_t idx;
+
+    if (tbl->old_buckets != NULL) {
+        idx = hash_val & (tbl->old_num_buckets - 1);
+        if (idx >= tbl->migrate_idx) {
+            return tbl->num_buckets + idx;
+        }
+    }
+    return hash_val & (tbl->num_buckets - 1);
+}
+
+/**
+ * Returns the first element of a bucket; a bucket last written in an earlier epoch is empty.
+ */
+static inline HTS_ELEM *
+HTS_FN(bucket_head)(const HTS_TBL *tbl, size_t idx)
+{
+    if (idx >= tbl->num_buckets) {
+        return tbl->old_buckets[idx - tbl->num_buckets];
+    }
+    return tbl->bucket_epochs[idx] == tbl->epoch ? tbl->buckets[idx] : NULL;
+}
+
+/**
+ * Returns a bucket for modification; a bucket last written in an earlier epoch is emptied first.
+ */
+static inline HTS_ELEM **
+HTS_FN(bucket_of)(HTS_TBL *tbl, size_t idx)
+{
+    if (idx >= tbl->num_buckets) {
+        return &tbl->old_buckets[idx - tbl->num_buckets];
+    }
+    if (tbl->bucket_epochs[idx] != tbl->epoch) {
+        tbl->buckets[idx] = NULL;
+        tbl->bucket_epochs[idx] = tbl->epoch;
+    }
+    return &tbl->buckets[idx];
+}
+
+/**
+ * Returns the first hash table element within a range of buckets (see first_elem() in hash_table.c).
+ */
+static inline HTS_ELEM *
+HTS_FN(first_elem)(const HTS_TBL *tbl, size_t begin_idx, size_t end_idx, size_t *out_idx)
+{
+    size_t idx;
+
+    if (tbl->num_elems == 0) {
+        return NULL;
+    }
+    for (idx = begin_idx; idx < end_idx && idx < tbl->num_buckets; ++idx) {
+        if (HTS_FN(bucket_head)(tbl, idx) != NULL) {
+            *out_idx = idx;
+            return tbl->buckets[idx];
+        }
+    }
+
+    // the migrated old buckets are empty
+    if (idx < tbl->num_buckets + tbl->migrate_idx) {
+        idx = tbl->num_buckets + tbl->migrate_idx;
+    }
+    for (; idx < end_idx; ++idx) {
+        if (HTS_FN(bucket_head)(tbl, idx) != NULL) {
+            *out_idx = idx;
+            return tbl->old_buckets[idx - tbl->num_buckets];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Returns the next hash table element for a current element and its bucket index (updated to the next element's).
+ */
+static inline HTS_ELEM *
+HTS_FN(next_elem)(const HTS_TBL *tbl, const HTS_ELEM *current, size_t *idx, size_t end_idx)
+{
+    if (current->next != NULL) {
+        return current->next;
+    }
+    return HTS_FN(first_elem)(tbl, *idx + 1, end_idx, idx);
+}
+
+/**
+ * Returns the number of bucket indices an iteration runs through (the buckets, followed by the old buckets).
+ */
+static inline size_t
+HTS_FN(iter_span)(const HTS_TBL *tbl)
+{
+    return tbl->num_buckets + tbl->old_num_buckets;
+}
+
+/**
+ * Frees the old bucket array of an incremental rehash.
+ */
+static inline void
+HTS_FN(drop_old_buckets)(HTS_TBL *tbl)
+{
+    free(tbl->old_buckets);
+    tbl->old_buckets = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+}
+
+/**
+ * Releases all hash table elements at once by resetting the slabs; the buckets are emptied by starting a new epoch
+ * (the epochs of all buckets are only reset when the epochs wrap around).
+ */
+static inline void
+HTS_FN(free_elems)(HTS_TBL *tbl)
+{
+    if (tbl->epoch == UCHAR_MAX) {
+        memset(tbl->bucket_epochs, 0, tbl->num_buckets);
+        tbl->epoch = 0;
+    }
+    tbl->epoch++;
+    HTS_FN(drop_old_buckets)(tbl);
+    arena_reset(tbl->slabs);
+    tbl->free_list = NULL;
+}
+
+/**
+ * Migrates old buckets of an incremental rehash into the buckets; elements are relinked, but never moved.
+ */
+static inline void
+HTS_FN(migrate)(HTS_TBL *tbl, size_t num_old_buckets)
+{
+    HTS_ELEM *elem, *elem_next, *e, *p;
+    size_t idx;
+
+    for (; num_old_buckets > 0 && tbl->migrate_idx < tbl->old_num_buckets; --num_old_buckets, ++tbl->migrate_idx) {
+        elem = tbl->old_buckets[tbl->migrate_idx];
+        tbl->old_buckets[tbl->migrate_idx] = NULL;
+
+        for (; elem != NULL; elem = elem_next) {
+            elem_next = elem->next;
+
+            // find correct position in new bucket
+            idx = HASH_TABLE_SPEC_HASH(&elem->key) & (tbl->num_buckets - 1);
+            for (e = *HTS_FN(bucket_of)(tbl, idx), p = NULL; e != NULL; p = e, e = e->next) {
+                if (HASH_TABLE_SPEC_CMP(&e->key, &elem->key) > 0) {
+                    break;
+                }
+            }
+
+            elem->next = e;
+            if (p == NULL) {
+                tbl->buckets[idx] = elem;
+            } else {
+                p->next = elem;
+            }
+        }
+    }
+
+    if (tbl->migrate_idx == tbl->old_num_buckets) {
+        HTS_FN(drop_old_buckets)(tbl);
+    }
+}
+
+/**
+ * Rehashes the hash table with 2x no. of buckets; in incremental mode, the elements are only migrated by the
+ * following insertions (an incremental rehash still in progress is completed first).
+ * @return true if the operation succeeded, false otherwise
+ */
+static inline int
+HTS_FN(rehash)(HTS_TBL *tbl)
+{
+    HTS_ELEM **new_buckets;
+    unsigned char *new_bucket_epochs;
+    size_t new_num_buckets, idx;
+
+    if (tbl->old_buckets != NULL) {
+        HTS_FN(migrate)(tbl, tbl->old_num_buckets);
+    }
+
+    new_num_buckets = tbl->num_buckets * 2;
+    new_buckets = malloc(new_num_buckets * sizeof(HTS_ELEM *));
+    new_bucket_epochs = calloc(new_num_buckets, 1);
+    if (new_buckets == NULL || new_bucket_epochs == NULL) {
+        free(new_buckets);
+        free(new_bucket_epochs);
+        return 0;
+    }
+
+    // the old buckets carry no epochs, the ones of earlier epochs are emptied
+    for (idx = 0; idx < tbl->num_buckets; ++idx) {
+        tbl->buckets[idx] = HTS_FN(bucket_head)(tbl, idx);
+    }
+    free(tbl->bucket_epochs);
+    tbl->bucket_epochs = new_bucket_epochs;
+
+    tbl->old_buckets = tbl->buckets;
+    tbl->old_num_buckets = tbl->num_buckets;
+    tbl->migrate_idx = 0;
+    tbl->buckets = new_buckets;
+    tbl->num_buckets = new_num_buckets;
+
+    if (tbl->rehash_step == 0) {
+        HTS_FN(migrate)(tbl, tbl->old_num_buckets);
+    }
+
+    return 1;
+}
+
+/**
+ * Creates a hash table.
+ * @param num_buckets the (initial) number of buckets (rounded to a power of two).
+ * @param load_factor a factor controlling growing / rehashing of the hash table.
+ * @return a pointer to a hash table created on the heap, or NULL; use *_destroy() for cleanup!
+ */
+static inline HTS_TBL *
+HTS_FN(create)(size_t num_buckets, float load_factor)
+{
+    HTS_TBL *tbl;
+
+    while (num_buckets & (num_buckets - 1)) {
+        num_buckets &= num_buckets - 1;
+    }
+    if (num_buckets == 0) {
+        num_buckets = 1;
+    }
+
+    tbl = malloc(sizeof(HTS_TBL));
+    if (tbl == NULL) {
+        return NULL;
+    }
+
+    tbl->buckets = malloc(num_buckets * sizeof(HTS_ELEM *));
+    tbl->bucket_epochs = calloc(num_buckets, 1);
+    if (tbl->buckets == NULL || tbl->bucket_epochs == NULL) {
+        free(tbl->buckets);
+        free(tbl->bucket_epochs);
+        free(tbl);
+        return NULL;
+    }
+    tbl->epoch = 1;
+
+    tbl->slabs = arena_create(HASH_TABLE_SLAB_SIZE);
+    if (tbl->slabs == NULL) {
+        free(tbl->buckets);
+        free(tbl->bucket_epochs);
+        free(tbl);
+        return NULL;
+    }
+    tbl->free_list = NULL;
+
+    tbl->num_buckets = num_buckets;
+    tbl->num_elems = 0;
+    tbl->load_factor = load_factor;
+    tbl->old_buckets = NULL;
+    tbl->old_num_buckets = 0;
+    tbl->migrate_idx = 0;
+    tbl->rehash_step = 0;
+
+    return tbl;
+}
+
+/**
+ * Switches a hash table between rehashing all at once (the default) and incremental rehashing (see
+ * hash_table_set_incremental_rehash()).
+ */
+static inline void
+HTS_FN(set_incremental_rehash)(HTS_TBL *tbl, int incremental)
+{
+    tbl->rehash_step = incremental ? (size_t)(1.0f / tbl->load_factor) + 1 : 0;
+    if (!incremental && tbl->old_buckets != NULL) {
+        HTS_FN(migrate)(tbl, tbl->old_num_buckets);
+    }
+}
+
+/**
+ * Looks for the element for a given key.
+ * @return the element or NULL if no element for the given key was found.
+ */
+static inline HTS_ELEM *
+HTS_FN(find_elem)(const HTS_TBL *tbl, const HTS_KEY *key)
+{
+    HTS_ELEM *e;
+    int cmp_val;
+
+    for (e = HTS_FN(bucket_head)(tbl, HTS_FN(bucket_idx_of)(tbl, key)); e != NULL; e = e->next) {
+        cmp_val = HASH_TABLE_SPEC_CMP(&e->key, key);
+        if (cmp_val == 0) {
+            return e;
+        } else if (cmp_val > 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Looks for the element for a given key and adds a new element if there is none.
+ * @param out_added an output parameter set to true if a new element was added, false otherwise.
+ * @return the element for the key, or NULL if heap allocation failed.
+ */
+static inline HTS_ELEM *
+HTS_FN(find_or_add_elem)(HTS_TBL *tbl, const HTS_KEY *key, HTS_VAL val, int *out_added)
+{
+    HTS_ELEM **bucket, *elem, *prev_elem, *new_elem;
+    int cmp_val;
+
+    bucket = HTS_FN(bucket_of)(tbl, HTS_FN(bucket_idx_of)(tbl, key));
+
+    for (elem = *bucket, prev_elem = NULL; elem != NULL; prev_elem = elem, elem = elem->next) {
+        cmp_val = HASH_TABLE_SPEC_CMP(&elem->key, key);
+        if (cmp_val == 0) {
+            *out_added = 0;
+            return elem;
+        } else if (cmp_val > 0) {
+            break;
+        }
+    }
+
+    // reuse a removed element first
+    new_elem = tbl->free_list;
+    if (new_elem != NULL) {
+        tbl->free_list = new_elem->next;
+    } else {
+        new_elem = (HTS_ELEM *)arena_alloc(tbl->slabs, sizeof(HTS_ELEM));
+        if (new_elem == NULL) {
+            return NULL;
+        }
+    }
+    new_elem->key = *key;
+    new_elem->val = val;
+    new_elem->next = elem;
+    if (prev_elem == NULL) {
+        *bucket = new_elem;
+    } else {
+        prev_elem->next = new_elem;
+    }
+
+    tbl->num_elems++;
+
+    // rehashing relinks but never moves elements => new_elem stays valid
+    if (tbl->old_buckets != NULL) {
+        HTS_FN(migrate)(tbl, tbl->rehash_step);
+    }
+    if ((float)tbl->num_elems / tbl->num_buckets > tbl->load_factor) {
+        HTS_FN(rehash)(tbl);
+    }
+
+    *out_added = 1;
+    return new_elem;
+}
+
+/**
+ * Puts a key, value pair into the hash table; the value of a present key gets overwritten.
+ * @return true when the pair was successfully inserted, false otherwise.
+ */
+static inline int
+HTS_FN(put)(HTS_TBL *tbl, const HTS_KEY *key, HTS_VAL val)
+{
+    HTS_ELEM *elem;
+    int added;
+
+    elem = HTS_FN(find_or_add_elem)(tbl, key, val, &added);
+    if (elem == NULL) {
+        return 0;
+    }
+    if (!added) {
+        elem->val = val;
+    }
+    return 1;
+}
+
+/**
+ * Retrieves the value for a given key, putting the given pair into the hash table first if the key is not present.
+ * @return the value stored for the key (i.e. val if the pair was inserted), or the none value if inserting failed.
+ */
+static inline HTS_VAL
+HTS_FN(get_or_put)(HTS_TBL *tbl, const HTS_KEY *key, HTS_VAL val)
+{
+    HTS_ELEM *elem;
+    int added;
+
+    elem = HTS_FN(find_or_add_elem)(tbl, key, val, &added);
+    return (elem != NULL) ? elem->val : HASH_TABLE_SPEC_VAL_NONE;
+}
+
+/**
+ * Retrieves the value for a given key.
+ * @return the value, or the none value.
+ */
+static inline HTS_VAL
+HTS_FN(get)(const HTS_TBL *tbl, const HTS_KEY *key)
+{
+    HTS_ELEM *e = HTS_FN(find_elem)(tbl, key);
+    return (e != NULL) ? e->val : HASH_TABLE_SPEC_VAL_NONE;
+}
+
+/**
+ * Checks if the hash table contains a pair for a given key.
+ */
+static inline int
+HTS_FN(contains)(const HTS_TBL *tbl, const HTS_KEY *key)
+{
+    return HTS_FN(find_elem)(tbl, key) != NULL;
+}
+
+/**
+ * Removes the entry with a given key.
+ * @return the value of the removed entry or the none value if no entry with the given key was present.
+ */
+static inline HTS_VAL
+HTS_FN(remove)(HTS_TBL *tbl, const HTS_KEY *key)
+{
+    HTS_ELEM **bucket, *e, *p;
+    HTS_VAL val;
+    int cmp_val;
+
+    bucket = HTS_FN(bucket_of)(tbl, HTS_FN(bucket_idx_of)(tbl, key));
+
+    for (e = *bucket, p = NULL; e != NULL; p = e, e = e->next) {
+        cmp_val = HASH_TABLE_SPEC_CMP(&e->key, key);
+        if (cmp_val == 0) {
+            val = e->val;
+            if (p == NULL) {
+                *bucket = e->next;
+            } else {
+                p->next = e->next;
+            }
+            tbl->num_elems--;
+            e->next = tbl->free_list;
+            tbl->free_list = e;
+            return val;
+        } else if (cmp_val > 0) {
+            break;
+        }
+    }
+    return HASH_TABLE_SPEC_VAL_NONE;
+}
+
+/**
+ * Returns the number of elements currently present in the hash table.
+ */
+static inline size_t
+HTS_FN(size)(const HTS_TBL *tbl)
+{
+    return tbl->num_elems;
+}
+
+/**
+ * Initializes an iterator over the entries of a hash table.
+ * WARNING: do not modify the hash table upon iteration!
+ */
+static inline void
+HTS_FN(iter_init)(HTS_TBL *tbl, HTS_ITER *iter)
+{
+    iter->tbl = tbl;
+    iter->current = NULL;
+    iter->end_idx = HTS_FN(iter_span)(tbl);
+    iter->next = HTS_FN(first_elem)(tbl, 0, iter->end_idx, &iter->next_idx);
+}
+
+/**
+ * Initializes an iterator over the entries of one of num_parts parts of a hash table (see
+ * hash_table_iter_init_part()).
+ * WARNING: do not modify the hash table upon iteration!
+ */
+static inline void
+HTS_FN(iter_init_part)(HTS_TBL *tbl, HTS_ITER *iter, size_t part, size_t num_parts)
+{
+    size_t span = HTS_FN(iter_span)(tbl);
+
+    iter->tbl = tbl;
+    iter->current = NULL;
+    iter->end_idx = part + 1 == num_parts ? span : span / num_parts * (part + 1);
+    iter->next = HTS_FN(first_elem)(tbl, span / num_parts * part, iter->end_idx, &iter->next_idx);
+}
+
+/**
+ * Checks if the iterator can deliver another item.
+ */
+static inline int
+HTS_FN(iter_has_next)(const HTS_ITER *iter)
+{
+    return iter->next != NULL;
+}
+
+/**
+ * Lets the iterator point to the next hash table element.
+ */
+static inline void
+HTS_FN(iter_next)(HTS_ITER *iter)
+{
+    if (iter->next == NULL) {
+        return;
+    }
+    iter->current = iter->next;
+    iter->next = HTS_FN(next_elem)(iter->tbl, iter->current, &iter->next_idx, iter->end_idx);
+}
+
+/**
+ * Returns a pointer to the key of the current element the iterator points to.
+ */
+static inline const HTS_KEY *
+HTS_FN(iter_get_key)(const HTS_ITER *iter)
+{
+    return &iter->current->key;
+}
+
+/**
+ * Returns the value of the current element the iterator points to.
+ */
+static inline HTS_VAL
+HTS_FN(iter_get_value)(const HTS_ITER *iter)
+{
+    return iter->current->val;
+}
+
+/**
+ * Removes all entries currently present in the hash table; the elements are released with their slabs at once.
+ */
+static inline void
+HTS_FN(clear)(HTS_TBL *tbl)
+{
+    HTS_FN(free_elems)(tbl);
+    tbl->num_elems = 0;
+}
+
+/**
+ * Destroys a hash table created by *_create().
+ */
+static inline void
+HTS_FN(destroy)(HTS_TBL *tbl)
+{
+    arena_destroy(tbl->slabs);
+    HTS_FN(drop_old_buckets)(tbl);
+    free(tbl->buckets);
+    free(tbl->bucket_epochs);
+    free(tbl);
+}
+
+#undef HTS_TBL
+#undef HTS_ELEM
+#undef HTS_ITER
+#undef HTS_FN
+#undef HTS_KEY
+#undef HTS_VAL
+
+#undef HASH_TABLE_SPEC_PREFIX
+#undef HASH_TABLE_SPEC_TYPE
+#undef HASH_TABLE_SPEC_KEY_T
+#undef HASH_TABLE_SPEC_VAL_T
+#undef HASH_TABLE_SPEC_HASH
+#undef HASH_TABLE_SPEC_CMP
+#undef HASH_TABLE_SPEC_VAL_NONE
+
+#endif /* HASH_TABLE_SPEC_PREFIX */
@@ -0,0 +1,171 @@
+#include "input_stream.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+/**
+ * Fills a buffer from the input until it is full or the input ends.
+ * @param in the input stream.
+ * @param buf the buffer.
+ * @param size an output parameter for the number of bytes read.
+ * @return 0 on success, or the error number of a failed read.
+ */
+static int
+fill_buffer(InputStream *in, char *buf, size_t *size)
+{
+    ssize_t n;
+
+    *size = 0;
+    while (*size < in->capacity) {
+        n = read(in->fd, buf + *size, in->capacity - *size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (n == 0) {
+            break;
+        }
+        *size += n;
+    }
+    return 0;
+}
+
+/**
+ * The main loop of the reader thread: fills the buffers alternately as soon as the consumer released them.
+ * @param data the input stream.
+ * @return always NULL.
+ */
+static void *
+reader_main(void *data)
+{
+    InputStream *in = (InputStream *)data;
+    size_t i, size;
+    int error;
+
+    for (i = 0; ; i ^= 1) {
+        // wait until the consumer released the buffer
+        pthread_mutex_lock(&in->lock);
+        while (!in->shutdown && in->full[i]) {
+            pthread_cond_wait(&in->cond, &in->lock);
+        }
+        if (in->shutdown) {
+            pthread_mutex_unlock(&in->lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&in->lock);
+
+        error = fill_buffer(in, in->buffers[i], &size);
+
+        // hand the chunk over; a short chunk marks the end of the input
+        pthread_mutex_lock(&in->lock);
+        in->sizes[i] = size;
+        in->full[i] = 1;
+        in->error = error;
+        in->done = error != 0 || size < in->capacity;
+        pthread_cond_broadcast(&in->cond);
+        pthread_mutex_unlock(&in->lock);
+
+        if (in->done) {
+            return NULL;
+        }
+    }
+}
+
+InputStream *
+input_stream_create(int fd, size_t chunk_size)
+{
+    InputStream *in;
+
+    in = malloc(sizeof(InputStream));
+    if (in == NULL) {
+        return NULL;
+    }
+
+    in->buffers[0] = malloc(chunk_size);
+    in->buffers[1] = malloc(chunk_size);
+    if (in->buffers[0] == NULL || in->buffers[1] == NULL) {
+        free(in->buffers[0]);
+        free(in->buffers[1]);
+        free(in);
+        return NULL;
+    }
+
+    in->fd = fd;
+    in->capacity = chunk_size;
+    in->sizes[0] = in->sizes[1] = 0;
+    in->full[0] = in->full[1] = 0;
+    in->current = 0;
+    in->held = 0;
+    in->done = 0;
+    in->error = 0;
+    in->shutdown = 0;
+    pthread_mutex_init(&in->lock, NULL);
+    pthread_cond_init(&in->cond, NULL);
+
+    if (pthread_create(&in->reader, NULL, &reader_main, in) != 0) {
+        pthread_mutex_destroy(&in->lock);
+        pthread_cond_destroy(&in->cond);
+        free(in->buffers[0]);
+        free(in->buffers[1]);
+        free(in);
+        return NULL;
+    }
+
+    return in;
+}
+
+int
+input_stream_next(InputStream *in, const char **data, size_t *size)
+{
+    pthread_mutex_lock(&in->lock);
+
+    // release the previous chunk to the reader
+    if (in->held) {
+        in->full[in->current] = 0;
+        in->current ^= 1;
+        in->held = 0;
+        pthread_cond_broadcast(&in->cond);
+    }
+
+    while (!in->full[in->current] && !in->done) {
+        pthread_cond_wait(&in->cond, &in->lock);
+    }
+
+    if (in->error != 0) {
+        errno = in->error;
+        pthread_mutex_unlock(&in->lock);
+        return 0;
+    }
+
+    if (in->full[in->current]) {
+        *data = in->buffers[in->current];
+        *size = in->sizes[in->current];
+        in->held = 1;
+    } else {
+        // the last chunk was consumed already
+        *data = NULL;
+        *size = 0;
+    }
+
+    pthread_mutex_unlock(&in->lock);
+    return 1;
+}
+
+void
+input_stream_destroy(InputStream *in)
+{
+    pthread_mutex_lock(&in->lock);
+    in->shutdown = 1;
+    pthread_cond_broadcast(&in->cond);
+    pthread_mutex_unlock(&in->lock);
+
+    pthread_join(in->reader, NULL);
+
+    pthread_mutex_destroy(&in->lock);
+    pthread_cond_destroy(&in->cond);
+    free(in->buffers[0]);
+    free(in->buffers[1]);
+    free(in);
+}
@@ -0,0 +1,112 @@
+#ifndef INPUT_STREAM_H
+#define INPUT_STREAM_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * A reader for inputs which cannot be mapped into memory (pipes, terminals): a background thread reads large
+ * chunks into one of two buffers while the consumer processes the chunk in the other one (double buffering).
+ */
+
+/**
+ * a type representing an input stream.
+ */
+typedef struct input_stream {
+
+    /**
+     * the file descriptor read from.
+     */
+    int fd;
+
+    /**
+     * the two chunk buffers.
+     */
+    char *buffers[2];
+
+    /**
+     * the capacity of each buffer.
+     */
+    size_t capacity;
+
+    /**
+     * the background thread reading the chunks.
+     */
+    pthread_t reader;
+
+    /**
+     * protects all members below.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * signaled when a buffer was filled or released.
+     */
+    pthread_cond_t cond;
+
+    /**
+     * per buffer: the number of bytes read into the buffer.
+     */
+    size_t sizes[2];
+
+    /**
+     * per buffer: a flag indicating that the buffer holds a chunk which was not released by the consumer yet.
+     */
+    int full[2];
+
+    /**
+     * the index of the buffer the consumer gets next.
+     */
+    size_t current;
+
+    /**
+     * a flag indicating that the consumer holds the current buffer.
+     */
+    int held;
+
+    /**
+     * a flag indicating that the reader reached the end of the input (or failed).
+     */
+    int done;
+
+    /**
+     * the error number of a failed read, or 0.
+     */
+    int error;
+
+    /**
+     * a flag telling the reader to exit.
+     */
+    int shutdown;
+
+} InputStream;
+
+/**
+ * Creates an input stream and starts reading ahead.
+ * @param fd the file descriptor to read from.
+ * @param chunk_size the size of the chunks.
+ * @return a pointer to the input stream created on the heap, or NULL on failure.
+ */
+InputStream *
+input_stream_create(int fd, size_t chunk_size);
+
+/**
+ * Releases the chunk returned by the previous call and waits for the next one.
+ * The chunk stays valid until the next call; only the last chunk may be smaller than the chunk size.
+ * @param in the input stream.
+ * @param data an output parameter for the chunk.
+ * @param size an output parameter for the size of the chunk; 0 at the end of the input.
+ * @return true on success, false if reading failed (errno is set).
+ */
+int
+input_stream_next(InputStream *in, const char **data, size_t *size);
+
+/**
+ * Stops the reader thread (once its pending read returned) and frees all resources; the rest of the input is not
+ * read.
+ * @param in the input stream.
+ */
+void
+input_stream_destroy(InputStream *in);
+
+#endif
@@ -0,0 +1,227 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cell_reader.h"
+#include "cell_set.h"
+#include "life.h"
+
+// The cells alive in the current / next generation; sets store coordinates only, there are no cell objects.
+static CellSet *set_gen_current;
+static CellSet *set_gen_next;
+
+// Checks if a cell is alive in the current generation.
+static inline
+long alive(long x, long y)
+{
+  Point2D p;
+  p.x = x;
+  p.y = y;
+  return cell_set_contains(set_gen_current, &p);
+}
+
+// Checks if a cell should be alive in the next generation;
+// if the cell is alive, it is stored for the next generation.
+static void
+checkcell(long x, long y)
+{
+  Point2D p;
+  int n=0;
+
+  n += alive(x-1, y-1);
+  n += alive(x-1, y+0);
+  n += alive(x-1, y+1);
+  n += alive(x+0, y-1);
+  n += alive(x+0, y+1);
+  n += alive(x+1, y-1);
+  n += alive(x+1, y+0);
+  n += alive(x+1, y+1);
+
+  /*fprintf(stderr,"checkcell x=%ld y=%ld old=%p new=%p n=%d\n",x,y,old,new,n);*/
+
+  if (n == 3 || (n == 2 && alive(x, y))) {
+    p.x = x;
+    p.y = y;
+    if (!cell_set_put(set_gen_next, &p)) {
+      perror("cell_set_put");
+      exit(1);
+    }
+  }
+}
+
+// Advanced the game of life by one generation.
+static void
+onegeneration()
+{
+  CellSet *set_gen_tmp;
+  CellSetIter iter;
+  Point2D p;
+  long x, y;
+
+  cell_set_iter_init(set_gen_current, &iter);
+  while (cell_set_iter_has_next(&iter)) {
+    cell_set_iter_next(&iter);
+
+    cell_set_iter_get(&iter, &p);
+    x = p.x;
+    y = p.y;
+
+    checkcell(x-1, y-1);
+    checkcell(x-1, y+0);
+    checkcell(x-1, y+1);
+    checkcell(x+0, y-1);
+    checkcell(x+0, y+0);
+    checkcell(x+0, y+1);
+    checkcell(x+1, y-1);
+    checkcell(x+1, y+0);
+    checkcell(x+1, y+1);
+  }
+
+  // use calculated, next generation as current generation
+  set_gen_tmp = set_gen_current;
+  set_gen_current = set_gen_next;
+  set_gen_next = set_gen_tmp;
+
+  // clean next generation cell set
+  cell_set_clear(set_gen_next);
+}
+
+// Puts cells into the current generation.
+static void
+putcells(const CellList *list)
+{
+  size_t i;
+
+  for (i = 0; i < list->num_cells; i++) {
+    if (!cell_set_put(set_gen_current, &list->cells[i])) {
+      perror("cell_set_put");
+      exit(1);
+    }
+  }
+}
+
+// Reads the initial state of the cells from the content of an input file (coordinate pairs, Life 1.06 or RLE).
+static void
+readinput(const char *begin, size_t size)
+{
+  CellList list;
+
+  if (!cell_reader_parse(&list, begin, size, NULL)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  putcells(&list);
+  cell_list_free(&list);
+}
+
+// Reads the initial state of the cells from an input file; regular files are mapped into memory, pipes are streamed.
+static void
+readlife(FILE *f)
+{
+  struct stat sb;
+  int fd;
+  char *begin;
+  CellList list;
+  size_t size;
+
+  fd = fileno(f);
+
+  // get file size
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    exit(1);
+  }
+
+  // map file into memory
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    begin = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (begin != MAP_FAILED) {
+      readinput(begin, sb.st_size);
+      munmap(begin, sb.st_size);
+      return;
+    }
+  }
+
+  // stream coordinate pairs, other inputs are read entirely
+  if (!cell_reader_parse_stream(&list, fd, NULL, &begin, &size)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  if (begin != NULL) {
+    readinput(begin, size);
+    free(begin);
+  } else {
+    putcells(&list);
+    cell_list_free(&list);
+  }
+}
+
+// Writes the cells which are alive in the current generation to an output file.
+static void
+writelife(FILE *f)
+{
+  CellSetIter iter;
+  Point2D p;
+
+  cell_set_iter_init(set_gen_current, &iter);
+  while (cell_set_iter_has_next(&iter)) {
+    cell_set_iter_next(&iter);
+    cell_set_iter_get(&iter, &p);
+    fprintf(f, "%ld %ld\n", p.x, p.y);
+  }
+}
+
+// Counts how many cells are alive in the current generation.
+static inline size_t
+countcells()
+{
+  return cell_set_size(set_gen_current);
+}
+
+int main(int argc, char **argv)
+{
+  long generations;
+  long i;
+  char *endptr;
+
+  // arguments checking.
+  if (argc!=2) {
+    fprintf(stderr, "Usage: %s #generations <startfile | sort >endfile\n", argv[0]);
+    exit(1);
+  }
+
+  // parse nr of generations.
+  generations = strtol(argv[1], &endptr, 10);
+  if (*endptr != '\0') {
+    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[3]);
+    exit(1);
+  }
+
+  // create cell sets.
+  set_gen_current = cell_set_create(1024, 0.75f);
+  set_gen_next    = cell_set_create(1024, 0.75f);
+
+  // read in initial generation.
+  readlife(stdin);
+
+  // advance generations.
+  for (i=0; i<generations; i++) {
+    onegeneration();
+  }
+
+  writelife(stdout);
+
+  fprintf(stderr,"%zu cells alive\n", countcells());
+
+  // destroy cell sets.
+  cell_set_destroy(set_gen_current);
+  cell_set_destroy(set_gen_next);
+
+  return 0;
+}
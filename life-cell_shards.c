@@ -0,0 +1,360 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "cell_reader.h"
+#include "cell_shards.h"
+#include "life.h"
+#include "thread_pool.h"
+
+static CellShards *shards_gen_current;
+static CellShards *shards_gen_next;
+
+// The cells of a shard are allocated from the shard's arena; one pair of arenas per shard.
+static Arena **arenas_gen_current;
+static Arena **arenas_gen_next;
+
+// The size of the chunks the arenas allocate from the heap.
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// The height of a stripe is 2^STRIPE_BITS rows.
+#define STRIPE_BITS 5
+
+// Every shard is advanced by its own thread of the pool.
+static ThreadPool *pool;
+
+// Creates a cell instance, allocated from an arena.
+static inline Cell *
+create_cell(Arena *arena, long x, long y, Status status)
+{
+    Cell *c = (Cell *)arena_alloc(arena, sizeof(Cell));
+    if (c == NULL) {
+        return NULL;
+    }
+    c->coordinates.x = x;
+    c->coordinates.y = y;
+    c->status = status;
+    c->neighbors = 0;
+    return c;
+}
+
+// Checks if a cell is alive in the current generation.
+static inline
+long alive(long x, long y)
+{
+  Point2D p;
+  p.x = x;
+  p.y = y;
+  return cell_shards_contains(shards_gen_current, &p);
+}
+
+// Checks if a cell should be alive in the next generation;
+// if the cell is alive, it is created and stored in its shard (which must be the calling thread's shard).
+static void
+checkcell(size_t shard_idx, long x, long y)
+{
+  Cell *c;
+  int n=0;
+
+  n += alive(x-1, y-1);
+  n += alive(x-1, y+0);
+  n += alive(x-1, y+1);
+  n += alive(x+0, y-1);
+  n += alive(x+0, y+1);
+  n += alive(x+1, y-1);
+  n += alive(x+1, y+0);
+  n += alive(x+1, y+1);
+
+  if (n == 3 || (n == 2 && alive(x, y))) {
+    c = create_cell(arenas_gen_next[shard_idx], x, y, ALIVE);
+    if (c == NULL) {
+      perror("create_cell");
+      exit(1);
+    }
+    if (!cell_shards_put(shards_gen_next, &c->coordinates, c)) {
+      perror("cell_shards_put");
+      exit(1);
+    }
+  }
+}
+
+// Checks the cells around (x, y) which belong to a given shard.
+static inline void
+checkneighborhood(size_t shard_idx, long x, long y)
+{
+  long dy;
+
+  for (dy = -1; dy <= 1; dy++) {
+    if (cell_shards_idx(shards_gen_current, y+dy) == shard_idx) {
+      checkcell(shard_idx, x-1, y+dy);
+      checkcell(shard_idx, x+0, y+dy);
+      checkcell(shard_idx, x+1, y+dy);
+    }
+  }
+}
+
+// Calculates the next generation of one shard (run by every thread of the pool);
+// the cells of the shard's stripes can only be affected by the shard's own cells and the edge cells of the two
+// neighbor shards, so no other thread writes into the shard and there is nothing to merge afterwards.
+static void
+stepshard(void *arg, size_t shard_idx, size_t num_shards)
+{
+  CellShard *shard = &shards_gen_current->shards[shard_idx];
+  CellShard *halo;
+  CellTableIter iter;
+  Point2D *p;
+  size_t neighbors[2], i, j;
+
+  (void)arg;
+
+  // clean the shard of the next generation; its cells are released all at once
+  arena_reset(arenas_gen_next[shard_idx]);
+  cell_shards_clear_shard(shards_gen_next, shard_idx);
+
+  // the shard's own cells
+  cell_table_iter_init(shard->tbl, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+    p = cell_table_iter_get_key(&iter);
+    checkneighborhood(shard_idx, p->x, p->y);
+  }
+
+  // the halo: edge cells of the neighbor shards (just one of them if there are only two shards)
+  neighbors[0] = (shard_idx + num_shards - 1) % num_shards;
+  neighbors[1] = (shard_idx + 1) % num_shards;
+  for (i = 0; i < 2; i++) {
+    if (neighbors[i] == shard_idx || (i == 1 && neighbors[1] == neighbors[0])) {
+      continue;
+    }
+    halo = &shards_gen_current->shards[neighbors[i]];
+    for (j = 0; j < halo->num_edges; j++) {
+      checkneighborhood(shard_idx, halo->edges[j].x, halo->edges[j].y);
+    }
+  }
+}
+
+// Advanced the game of life by one generation.
+static void
+onegeneration(void)
+{
+  CellShards *shards_gen_tmp;
+  Arena **arenas_gen_tmp;
+
+  thread_pool_run(pool, &stepshard, NULL);
+
+  // use calculated, next generation as current generation
+  shards_gen_tmp = shards_gen_current;
+  shards_gen_current = shards_gen_next;
+  shards_gen_next = shards_gen_tmp;
+
+  arenas_gen_tmp = arenas_gen_current;
+  arenas_gen_current = arenas_gen_next;
+  arenas_gen_next = arenas_gen_tmp;
+}
+
+// Puts cells into the current generation.
+static void
+putcells(const CellList *list)
+{
+  const Point2D *p;
+  Cell *c;
+  size_t i;
+
+  for (i = 0; i < list->num_cells; i++) {
+    p = &list->cells[i];
+    c = create_cell(arenas_gen_current[cell_shards_idx(shards_gen_current, p->y)], p->x, p->y, ALIVE);
+    if (c == NULL) {
+      perror("create_cell");
+      exit(1);
+    }
+
+    if (!cell_shards_put(shards_gen_current, &c->coordinates, c)) {
+      perror("cell_shards_put");
+      exit(1);
+    }
+  }
+}
+
+// Reads the initial state of the cells from the content of an input file (coordinate pairs, Life 1.06 or RLE).
+static void
+readinput(const char *begin, size_t size)
+{
+  CellList list;
+
+  if (!cell_reader_parse(&list, begin, size, pool)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  putcells(&list);
+  cell_list_free(&list);
+}
+
+// Reads the initial state of the cells from an input file; regular files are mapped into memory, pipes are streamed.
+static void
+readlife(FILE *f)
+{
+  struct stat sb;
+  int fd;
+  char *begin;
+  CellList list;
+  size_t size;
+
+  fd = fileno(f);
+
+  // get file size
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    exit(1);
+  }
+
+  // map file into memory
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    begin = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (begin != MAP_FAILED) {
+      readinput(begin, sb.st_size);
+      munmap(begin, sb.st_size);
+      return;
+    }
+  }
+
+  // stream coordinate pairs, other inputs are read entirely
+  if (!cell_reader_parse_stream(&list, fd, pool, &begin, &size)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  if (begin != NULL) {
+    readinput(begin, size);
+    free(begin);
+  } else {
+    putcells(&list);
+    cell_list_free(&list);
+  }
+}
+
+// Writes the cells which are alive in the current generation to an output file.
+static void
+writelife(FILE *f)
+{
+  CellTableIter iter;
+  Point2D *p;
+  size_t i;
+
+  for (i = 0; i < shards_gen_current->num_shards; i++) {
+    cell_table_iter_init(shards_gen_current->shards[i].tbl, &iter);
+    while (cell_table_iter_has_next(&iter)) {
+      cell_table_iter_next(&iter);
+      p = cell_table_iter_get_key(&iter);
+      fprintf(f, "%ld %ld\n", p->x, p->y);
+    }
+  }
+}
+
+// Counts how many cells are alive in the current generation.
+static inline size_t
+countcells()
+{
+  return cell_shards_size(shards_gen_current);
+}
+
+// Prints the usage and exits.
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-j threads] #generations <startfile | sort >endfile\n", prog);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  long generations;
+  long num_threads = 1;
+  long i;
+  char *endptr;
+  int opt;
+
+  // parse options.
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    switch (opt) {
+    case 'j':
+      num_threads = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || num_threads < 1) {
+        fprintf(stderr, "\"%s\" not a valid thread count\n", optarg);
+        exit(1);
+      }
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  // arguments checking.
+  if (optind != argc-1) {
+    usage(argv[0]);
+  }
+
+  // parse nr of generations.
+  generations = strtol(argv[optind], &endptr, 10);
+  if (*endptr != '\0') {
+    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[optind]);
+    exit(1);
+  }
+
+  // create one shard (and thread) per thread.
+  pool = thread_pool_create(num_threads);
+  shards_gen_current = cell_shards_create(num_threads, STRIPE_BITS, 1024, 0.75f);
+  shards_gen_next    = cell_shards_create(num_threads, STRIPE_BITS, 1024, 0.75f);
+  if (pool == NULL || shards_gen_current == NULL || shards_gen_next == NULL) {
+    perror("cell_shards_create");
+    exit(1);
+  }
+
+  // create arenas for the cells.
+  arenas_gen_current = malloc(num_threads * sizeof(Arena *));
+  arenas_gen_next    = malloc(num_threads * sizeof(Arena *));
+  if (arenas_gen_current == NULL || arenas_gen_next == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  for (i = 0; i < num_threads; i++) {
+    arenas_gen_current[i] = arena_create(ARENA_CHUNK_SIZE);
+    arenas_gen_next[i]    = arena_create(ARENA_CHUNK_SIZE);
+    if (arenas_gen_current[i] == NULL || arenas_gen_next[i] == NULL) {
+      perror("arena_create");
+      exit(1);
+    }
+  }
+
+  // read in initial generation.
+  readlife(stdin);
+
+  // advance generations.
+  for (i=0; i<generations; i++) {
+    onegeneration();
+  }
+
+  writelife(stdout);
+
+  fprintf(stderr,"%zu cells alive\n", countcells());
+
+  // destroy shards and threads.
+  cell_shards_destroy(shards_gen_current);
+  cell_shards_destroy(shards_gen_next);
+  thread_pool_destroy(pool);
+
+  // free memory allocated for cells.
+  for (i = 0; i < num_threads; i++) {
+    arena_destroy(arenas_gen_current[i]);
+    arena_destroy(arenas_gen_next[i]);
+  }
+  free(arenas_gen_current);
+  free(arenas_gen_next);
+
+  return 0;
+}
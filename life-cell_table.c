@@ -1,5 +1,7 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -8,31 +10,80 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include "arena.h"
+#include "cell_format.h"
+#include "cell_reader.h"
 #include "cell_table.h"
+#include "checkpoint.h"
+#include "compact.h"
 #include "life.h"
+#include "radix_sort.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+#include "trajectory.h"
 
 static CellTable *tbl_gen_current;
 static CellTable *tbl_gen_next;
 
-// Used to free all cell instances put into the cell table(s).
-static void
-cell_table_gen_free(CellTableEntry *entry)
-{
-  free(entry->value);
-  entry->value = NULL;
-}
+// The cells of a generation are allocated from the arena that belongs to the generation's table.
+static Arena *arena_gen_current;
+static Arena *arena_gen_next;
+
+// The size of the chunks the arenas allocate from the heap.
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// The neighbor counts of all cells that might be alive in the next generation (see onegeneration_count()).
+static CellTable *tbl_counts;
+static Arena *arena_counts;
+
+// A cell allocated from arena_counts that has not been put into tbl_counts (yet).
+static Cell *spare_cell;
+
+// The threads used by onegeneration_parallel(); every thread puts the cells alive in the next generation (allocated
+// from its own pair of arenas) straight into tbl_gen_next, cells that do not fit are spilled into its own cell table.
+static ThreadPool *pool;
+static CellTable **tbl_threads;
+static Arena **arena_threads_current;
+static Arena **arena_threads_next;
+
+// The number of the current generation (counting from the generation of an input snapshot).
+static uint64_t generation;
 
-// Creates a cell instance, allocated on the heap.
+// The cells born and the cells that died in the last generation (recorded by onegeneration_trajectory()).
+static CellLog births;
+static CellLog deaths;
+
+// The population of the previous generation (SIZE_MAX before the first generation), see presize_next().
+static size_t population_prev = SIZE_MAX;
+
+// tbl_gen_next is shrunk when it could take this many times its predicted population.
+#define PRESIZE_SHRINK_FACTOR 4
+
+// The output formats.
+typedef enum { OUTPUT_TEXT, OUTPUT_SNAPSHOT, OUTPUT_TABLE, OUTPUT_COMPACT } OutputFormat;
+
+// The size of the buffer the cells are formatted into before they are written.
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// Generations with at least this many cells are formatted by all threads of the pool, each into its own buffer.
+#define WRITE_PARALLEL_THRESHOLD (1 << 16)
+static TextBuffer *text_buffers;
+
+// The function used to advance the game of life by one generation.
+typedef void generation_function(void);
+
+// Creates a cell instance, allocated from an arena.
 static inline Cell *
-create_cell(long x, long y, Status status)
+create_cell(Arena *arena, long x, long y, Status status)
 {
-    Cell *c = (Cell *)malloc(sizeof(Cell));
+    Cell *c = (Cell *)arena_alloc(arena, sizeof(Cell));
     if (c == NULL) {
         return NULL;
     }
     c->coordinates.x = x;
     c->coordinates.y = y;
     c->status = status;
+    c->neighbors = 0;
     return c;
 }
 
@@ -46,12 +97,10 @@ long alive(long x, long y)
   return cell_table_contains(tbl_gen_current, &p);
 }
 
-// Checks if a cell should be alive in the next generation;
-// if the cell is alive, it is created and stored for the next generation.
-static void
-checkcell(long x, long y)
+// Checks if a cell should be alive in the next generation.
+static inline int
+survives(long x, long y)
 {
-  Cell *c;
   int n=0;
 
   n += alive(x-1, y-1);
@@ -65,8 +114,18 @@ checkcell(long x, long y)
 
   /*fprintf(stderr,"checkcell x=%ld y=%ld old=%p new=%p n=%d\n",x,y,old,new,n);*/
 
-  if (n == 3 || (n == 2 && alive(x, y))) {
-    c = create_cell(x, y, ALIVE);
+  return n == 3 || (n == 2 && alive(x, y));
+}
+
+// Checks if a cell should be alive in the next generation;
+// if the cell is alive, it is created and stored for the next generation.
+static void
+checkcell(long x, long y)
+{
+  Cell *c;
+
+  if (survives(x, y)) {
+    c = create_cell(arena_gen_next, x, y, ALIVE);
     if (c == NULL) {
       perror("create_cell");
       exit(1);
@@ -75,15 +134,66 @@ checkcell(long x, long y)
   }
 }
 
+// Like checkcell(), but called by the threads of the pool at the same time.
+static void
+checkcell_concurrent(size_t thread_idx, long x, long y)
+{
+  Cell *c;
+
+  if (survives(x, y)) {
+    c = create_cell(arena_threads_next[thread_idx], x, y, ALIVE);
+    if (c == NULL) {
+      perror("create_cell");
+      exit(1);
+    }
+    if (!cell_table_put_concurrent(tbl_gen_next, &c->coordinates, c)) {
+      // tbl_gen_next is full, it can only grow after all threads are done
+      if (!cell_table_put(tbl_threads[thread_idx], &c->coordinates, c)) {
+        perror("cell_table_put");
+        exit(1);
+      }
+    }
+  }
+}
+
+// Presizes the (empty) tbl_gen_next for the predicted population of the next generation, assuming the population
+// grows as much as it grew in the last generation: a table far too large for it is shrunk first (iterating over it
+// costs time proportional to its number of buckets), then it is grown to take the predicted population without
+// rehashing. While the population is stable, the table is left alone.
+static void
+presize_next(void)
+{
+  size_t population = cell_table_size(tbl_gen_current);
+  size_t predicted = population;
+
+  if (population_prev < population) {
+    predicted += population - population_prev;
+  }
+  population_prev = population;
+
+  if ((float)predicted * PRESIZE_SHRINK_FACTOR < tbl_gen_next->num_buckets * tbl_gen_next->load_factor
+      && !cell_table_shrink_to_fit(tbl_gen_next)) {
+    perror("cell_table_shrink_to_fit");
+    exit(1);
+  }
+  if (!cell_table_reserve(tbl_gen_next, predicted)) {
+    perror("cell_table_reserve");
+    exit(1);
+  }
+}
+
 // Advanced the game of life by one generation.
 static void
-onegeneration()
+onegeneration(void)
 {
   CellTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
   CellTableIter iter;
   Point2D *p;
   long x, y;
 
+  presize_next();
+
   cell_table_iter_init(tbl_gen_current, &iter);
   while (cell_table_iter_has_next(&iter)) {
     cell_table_iter_next(&iter);
@@ -108,20 +218,553 @@ onegeneration()
   tbl_gen_current = tbl_gen_next;
   tbl_gen_next = tbl_gen_tmp;
 
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation cell table; its cells are released all at once
+  arena_reset(arena_gen_next);
+  cell_table_clear(tbl_gen_next);
+}
+
+// The number of alive cells whose neighborhoods onegeneration_batch() looks up at once.
+#define BATCH_CELLS 4
+
+// The side of the neighborhood looked up for an alive cell: the 3x3 cells whose fate it takes part in, and their
+// neighbors.
+#define BATCH_SIDE 5
+#define BATCH_KEYS (BATCH_SIDE * BATCH_SIDE)
+
+// Checks if the 3x3 cells around an alive cell should be alive in the next generation, given which of the 5x5 cells
+// around it are alive (row by row); cells alive in the next generation are created and stored as by checkcell().
+static void
+checkneighborhood(long x, long y, const unsigned char *found)
+{
+  int i, j, n;
+  Cell *c;
+
+  for (i = 1; i < BATCH_SIDE - 1; i++) {
+    for (j = 1; j < BATCH_SIDE - 1; j++) {
+      n = found[(i-1)*BATCH_SIDE + j-1] + found[(i-1)*BATCH_SIDE + j] + found[(i-1)*BATCH_SIDE + j+1]
+        + found[i*BATCH_SIDE + j-1]                                    + found[i*BATCH_SIDE + j+1]
+        + found[(i+1)*BATCH_SIDE + j-1] + found[(i+1)*BATCH_SIDE + j] + found[(i+1)*BATCH_SIDE + j+1];
+
+      if (n == 3 || (n == 2 && found[i*BATCH_SIDE + j])) {
+        c = create_cell(arena_gen_next, x + j - 2, y + i - 2, ALIVE);
+        if (c == NULL) {
+          perror("create_cell");
+          exit(1);
+        }
+        cell_table_put(tbl_gen_next, &c->coordinates, c);
+      }
+    }
+  }
+}
+
+// Advanced the game of life by one generation;
+// like onegeneration(), but the 5x5 neighborhoods of BATCH_CELLS alive cells are looked up by a single
+// cell_table_contains_batch() call (25 overlapping lookups per alive cell instead of up to 81 dependent ones).
+static void
+onegeneration_batch(void)
+{
+  CellTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  CellTableIter iter;
+  Point2D cells[BATCH_CELLS];
+  Point2D keys[BATCH_CELLS * BATCH_KEYS];
+  unsigned char found[BATCH_CELLS * BATCH_KEYS];
+  size_t num_cells, k;
+  int i, j;
+
+  presize_next();
+
+  cell_table_iter_init(tbl_gen_current, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    // gather a batch of alive cells and the keys of their neighborhoods
+    for (num_cells = 0; num_cells < BATCH_CELLS && cell_table_iter_has_next(&iter); num_cells++) {
+      cell_table_iter_next(&iter);
+      cells[num_cells] = *cell_table_iter_get_key(&iter);
+
+      for (i = 0; i < BATCH_SIDE; i++) {
+        for (j = 0; j < BATCH_SIDE; j++) {
+          keys[num_cells*BATCH_KEYS + i*BATCH_SIDE + j].x = cells[num_cells].x + j - 2;
+          keys[num_cells*BATCH_KEYS + i*BATCH_SIDE + j].y = cells[num_cells].y + i - 2;
+        }
+      }
+    }
+
+    cell_table_contains_batch(tbl_gen_current, keys, num_cells * BATCH_KEYS, found);
+
+    for (k = 0; k < num_cells; k++) {
+      checkneighborhood(cells[k].x, cells[k].y, &found[k * BATCH_KEYS]);
+    }
+  }
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation cell table; its cells are released all at once
+  arena_reset(arena_gen_next);
+  cell_table_clear(tbl_gen_next);
+}
+
+// Like checkcell(), but records the cell as born if it was not alive in the current generation.
+static void
+checkcell_trajectory(long x, long y)
+{
+  Cell *c;
+
+  if (survives(x, y)) {
+    c = create_cell(arena_gen_next, x, y, ALIVE);
+    if (c == NULL) {
+      perror("create_cell");
+      exit(1);
+    }
+    if (cell_table_get_or_put(tbl_gen_next, &c->coordinates, c) == c && !alive(x, y) && !cell_log_add(&births, x, y)) {
+      perror("cell_log_add");
+      exit(1);
+    }
+  }
+}
+
+// Advanced the game of life by one generation;
+// like onegeneration(), but the cells born and the cells that died are recorded for the trajectory.
+static void
+onegeneration_trajectory(void)
+{
+  CellTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  CellTableIter iter;
+  Point2D *p;
+  long x, y;
+
+  presize_next();
+
+  births.num_cells = 0;
+  deaths.num_cells = 0;
+
+  cell_table_iter_init(tbl_gen_current, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+
+    p = cell_table_iter_get_key(&iter);
+    x = p->x;
+    y = p->y;
+
+    checkcell_trajectory(x-1, y-1);
+    checkcell_trajectory(x-1, y+0);
+    checkcell_trajectory(x-1, y+1);
+    checkcell_trajectory(x+0, y-1);
+    checkcell_trajectory(x+0, y+0);
+    checkcell_trajectory(x+0, y+1);
+    checkcell_trajectory(x+1, y-1);
+    checkcell_trajectory(x+1, y+0);
+    checkcell_trajectory(x+1, y+1);
+
+    // the cell itself was just checked
+    if (!cell_table_contains(tbl_gen_next, p) && !cell_log_add(&deaths, x, y)) {
+      perror("cell_log_add");
+      exit(1);
+    }
+  }
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation cell table; its cells are released all at once
+  arena_reset(arena_gen_next);
+  cell_table_clear(tbl_gen_next);
+}
+
+// Puts the cells the threads spilled into their own tables (see checkcell_concurrent()) into a cell table;
+// a cell may have been found by more than one thread.
+static void
+putspills(CellTable *tbl)
+{
+  CellTableIter iter;
+  Cell *c;
+  size_t i;
+
+  for (i = 0; i < thread_pool_size(pool); ++i) {
+    cell_table_iter_init(tbl_threads[i], &iter);
+    while (cell_table_iter_has_next(&iter)) {
+      cell_table_iter_next(&iter);
+      c = cell_table_iter_get_val(&iter);
+      if (!cell_table_put(tbl, &c->coordinates, c)) {
+        perror("cell_table_put");
+        exit(1);
+      }
+    }
+    cell_table_clear(tbl_threads[i]);
+  }
+}
+
+// Checks the cells around the alive cells of one part of the current generation (run by every thread of the pool).
+static void
+checkcells_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+  CellTableIter iter;
+  Point2D *p;
+  long x, y;
+
+  (void)arg;
+
+  cell_table_iter_init_part(tbl_gen_current, &iter, thread_idx, num_threads);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+
+    p = cell_table_iter_get_key(&iter);
+    x = p->x;
+    y = p->y;
+
+    checkcell_concurrent(thread_idx, x-1, y-1);
+    checkcell_concurrent(thread_idx, x-1, y+0);
+    checkcell_concurrent(thread_idx, x-1, y+1);
+    checkcell_concurrent(thread_idx, x+0, y-1);
+    checkcell_concurrent(thread_idx, x+0, y+0);
+    checkcell_concurrent(thread_idx, x+0, y+1);
+    checkcell_concurrent(thread_idx, x+1, y-1);
+    checkcell_concurrent(thread_idx, x+1, y+0);
+    checkcell_concurrent(thread_idx, x+1, y+1);
+  }
+}
+
+// Advanced the game of life by one generation;
+// like onegeneration(), but the alive cells of the current generation are split among the threads of the pool.
+static void
+onegeneration_parallel(void)
+{
+  CellTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  size_t i;
+
+  // make room for the predicted population (at least as many cells as are alive now)
+  presize_next();
+  if (!cell_table_begin_concurrent(tbl_gen_next, cell_table_size(tbl_gen_current))) {
+    perror("cell_table_begin_concurrent");
+    exit(1);
+  }
+
+  thread_pool_run(pool, &checkcells_part, NULL);
+
+  cell_table_end_concurrent(tbl_gen_next);
+
+  putspills(tbl_gen_next);
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  for (i = 0; i < thread_pool_size(pool); ++i) {
+    arena_gen_tmp = arena_threads_current[i];
+    arena_threads_current[i] = arena_threads_next[i];
+    arena_threads_next[i] = arena_gen_tmp;
+    arena_reset(arena_threads_next[i]);
+  }
+
   // clean next generation cell table
-  cell_table_map(tbl_gen_next, &cell_table_gen_free);
   cell_table_clear(tbl_gen_next);
 }
 
-// Reads the initial state of the cells from an input file.
+// Returns the neighbor count cell for (x, y), putting a new (dead) one into the count table if necessary.
+static inline Cell *
+countcell(long x, long y)
+{
+  Cell *c;
+
+  if (spare_cell == NULL) {
+    spare_cell = create_cell(arena_counts, x, y, DEAD);
+    if (spare_cell == NULL) {
+      perror("create_cell");
+      exit(1);
+    }
+  } else {
+    spare_cell->coordinates.x = x;
+    spare_cell->coordinates.y = y;
+  }
+
+  c = cell_table_get_or_put(tbl_counts, &spare_cell->coordinates, spare_cell);
+  if (c == NULL) {
+    perror("cell_table_get_or_put");
+    exit(1);
+  }
+
+  // the spare cell is in use now
+  if (c == spare_cell) {
+    spare_cell = NULL;
+  }
+
+  return c;
+}
+
+// Advanced the game of life by one generation;
+// unlike onegeneration(), every alive cell adds itself to the neighbor counts of the surrounding cells (9 lookups
+// per alive cell), then the rules are applied to the counted cells (instead of 81 lookups per alive cell).
+static void
+onegeneration_count(void)
+{
+  CellTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  CellTableIter iter;
+  Point2D *p;
+  Cell *c;
+  long x, y;
+
+  presize_next();
+
+  // pass 1: count neighbors
+  cell_table_iter_init(tbl_gen_current, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+
+    p = cell_table_iter_get_key(&iter);
+    x = p->x;
+    y = p->y;
+
+    countcell(x+0, y+0)->status = ALIVE;
+    countcell(x-1, y-1)->neighbors++;
+    countcell(x-1, y+0)->neighbors++;
+    countcell(x-1, y+1)->neighbors++;
+    countcell(x+0, y-1)->neighbors++;
+    countcell(x+0, y+1)->neighbors++;
+    countcell(x+1, y-1)->neighbors++;
+    countcell(x+1, y+0)->neighbors++;
+    countcell(x+1, y+1)->neighbors++;
+  }
+
+  // pass 2: apply rules
+  cell_table_iter_init(tbl_counts, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+
+    c = cell_table_iter_get_val(&iter);
+    if (c->neighbors == 3 || (c->neighbors == 2 && c->status == ALIVE)) {
+      c = create_cell(arena_gen_next, c->coordinates.x, c->coordinates.y, ALIVE);
+      if (c == NULL) {
+        perror("create_cell");
+        exit(1);
+      }
+      cell_table_put(tbl_gen_next, &c->coordinates, c);
+    }
+  }
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation and neighbor count tables
+  arena_reset(arena_gen_next);
+  cell_table_clear(tbl_gen_next);
+  arena_reset(arena_counts);
+  cell_table_clear(tbl_counts);
+  spare_cell = NULL;
+}
+
+// Reads the initial state of the cells from a snapshot; if the snapshot contains a bucket array of the same layout,
+// it is copied into the cell table as is, otherwise the cells are put one by one.
+static void
+readsnapshot(const Snapshot *snap)
+{
+  size_t num_cells = snap->header->num_cells;
+  CellTableEntry *e;
+  CellTableIter iter;
+  Cell *cells;
+  size_t i;
+
+  generation = snap->header->generation;
+  if (num_cells == 0) {
+    return;
+  }
+
+  cells = (Cell *)arena_alloc(arena_gen_current, num_cells * sizeof(Cell));
+  if (cells == NULL) {
+    perror("arena_alloc");
+    exit(1);
+  }
+
+  if (snap->buckets != NULL && snap->header->bucket_size == CELL_TABLE_BUCKET_SIZE) {
+    if (!cell_table_load(tbl_gen_current, snap->buckets, snap->header->num_buckets, num_cells)) {
+      perror("cell_table_load");
+      exit(1);
+    }
+
+    // attach cells to the copied entries
+    i = 0;
+    cell_table_iter_init(tbl_gen_current, &iter);
+    while (cell_table_iter_has_next(&iter) && i < num_cells) {
+      cell_table_iter_next(&iter);
+      e = cell_table_iter_get(&iter);
+      cells[i].coordinates = e->key;
+      cells[i].status = ALIVE;
+      cells[i].neighbors = 0;
+      e->value = &cells[i++];
+    }
+    return;
+  }
+
+  if (!cell_table_reserve(tbl_gen_current, num_cells)) {
+    perror("cell_table_reserve");
+    exit(1);
+  }
+  for (i = 0; i < num_cells; i++) {
+    cells[i].coordinates.x = snap->cells[i].x;
+    cells[i].coordinates.y = snap->cells[i].y;
+    cells[i].status = ALIVE;
+    cells[i].neighbors = 0;
+    cell_table_put(tbl_gen_current, &cells[i].coordinates, &cells[i]);
+  }
+}
+
+// The cells of the initial generation, put into tbl_gen_current by buildtable_part().
+typedef struct initial_cells {
+  const Point2D *coordinates;
+  Cell *cells;
+  size_t num_cells;
+} InitialCells;
+
+// Puts a part of the initial cells into tbl_gen_current (run by every thread of the pool).
+static void
+buildtable_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+  InitialCells *init = (InitialCells *)arg;
+  size_t begin = init->num_cells / num_threads * thread_idx;
+  size_t end = thread_idx + 1 == num_threads ? init->num_cells : init->num_cells / num_threads * (thread_idx + 1);
+  Cell *c;
+  size_t i;
+
+  for (i = begin; i < end; i++) {
+    c = &init->cells[i];
+    c->coordinates = init->coordinates[i];
+    c->status = ALIVE;
+    c->neighbors = 0;
+    if (!cell_table_put_concurrent(tbl_gen_current, &c->coordinates, c)
+        && !cell_table_put(tbl_threads[thread_idx], &c->coordinates, c)) {
+      perror("cell_table_put");
+      exit(1);
+    }
+  }
+}
+
+// Puts the cells of the initial generation into tbl_gen_current, using all threads of the pool (if any).
+static void
+buildtable(const Point2D *coordinates, size_t num_cells)
+{
+  InitialCells init;
+  size_t i;
+
+  if (num_cells == 0) {
+    return;
+  }
+
+  init.coordinates = coordinates;
+  init.num_cells = num_cells;
+  init.cells = (Cell *)arena_alloc(arena_gen_current, num_cells * sizeof(Cell));
+  if (init.cells == NULL) {
+    perror("arena_alloc");
+    exit(1);
+  }
+
+  if (pool == NULL) {
+    if (!cell_table_reserve(tbl_gen_current, num_cells)) {
+      perror("cell_table_reserve");
+      exit(1);
+    }
+    for (i = 0; i < num_cells; i++) {
+      init.cells[i].coordinates = coordinates[i];
+      init.cells[i].status = ALIVE;
+      init.cells[i].neighbors = 0;
+      if (!cell_table_put(tbl_gen_current, &init.cells[i].coordinates, &init.cells[i])) {
+        perror("cell_table_put");
+        exit(1);
+      }
+    }
+    return;
+  }
+
+  if (!cell_table_begin_concurrent(tbl_gen_current, num_cells)) {
+    perror("cell_table_begin_concurrent");
+    exit(1);
+  }
+  thread_pool_run(pool, &buildtable_part, &init);
+  cell_table_end_concurrent(tbl_gen_current);
+  putspills(tbl_gen_current);
+}
+
+// Reads the initial state of the cells from a compact file, decoding its blocks with all threads of the pool (if any).
+static void
+readcompact(const Compact *c)
+{
+  Point2D *coordinates;
+
+  generation = c->header->generation;
+
+  coordinates = malloc(((size_t)c->header->num_cells + 1) * sizeof(Point2D));
+  if (coordinates == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  if (!compact_decode(c, coordinates, pool)) {
+    fprintf(stderr, "corrupt compact input\n");
+    exit(1);
+  }
+  buildtable(coordinates, c->header->num_cells);
+  free(coordinates);
+}
+
+// Reads the initial state of the cells from the content of an input file (text, snapshot or compact).
+static void
+readinput(const char *begin, size_t size)
+{
+  Snapshot snap;
+  Compact c;
+  CellList list;
+
+  // binary snapshots and compact files are recognized by their magic bytes
+  if (snapshot_parse(&snap, begin, size)) {
+    readsnapshot(&snap);
+    return;
+  }
+  if (compact_parse(&c, begin, size)) {
+    readcompact(&c);
+    return;
+  }
+
+  // read cells of input file (coordinate pairs, Life 1.06 or RLE)
+  if (!cell_reader_parse(&list, begin, size, pool)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  buildtable(list.cells, list.num_cells);
+  cell_list_free(&list);
+}
+
+// Reads the initial state of the cells from an input file; regular files are mapped into memory, pipes are streamed.
 static void
 readlife(FILE *f)
 {
+  CellList list;
   struct stat sb;
   int fd;
-  char *begin, *s, *end;
-  long x, y;
-  Cell *c;
+  char *begin;
+  size_t size;
 
   fd = fileno(f);
 
@@ -132,58 +775,263 @@ readlife(FILE *f)
   }
 
   // map file into memory
-  begin = s = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    begin = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (begin != MAP_FAILED) {
+      readinput(begin, sb.st_size);
+      munmap(begin, sb.st_size);
+      return;
+    }
+  }
 
-  // TODO: skip header, see readlife.y
+  // stream coordinate pairs, other inputs are read entirely
+  if (!cell_reader_parse_stream(&list, fd, pool, &begin, &size)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  if (begin != NULL) {
+    readinput(begin, size);
+    free(begin);
+  } else {
+    buildtable(list.cells, list.num_cells);
+    cell_list_free(&list);
+  }
+}
 
-  // read cells of input file
-  end = s + sb.st_size;
-  while (s < end) {
-    char *endptr;
+// Formats the cells of one part of the current generation into the thread's text buffer (run by every thread).
+static void
+formatcells_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+  TextBuffer *buf = &text_buffers[thread_idx];
+  CellTableIter iter;
+  Point2D *p;
+
+  (void)arg;
 
-    while (*s == ' ') s++;
-    x = strtol(s, &endptr, 10);
-    if (s == endptr) {
-      perror("strtol");
+  cell_table_iter_init_part(tbl_gen_current, &iter, thread_idx, num_threads);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+    p = cell_table_iter_get_key(&iter);
+    if (!text_buffer_reserve(buf, CELL_FORMAT_MAX)) {
+      perror("text_buffer_reserve");
       exit(1);
     }
-    s = endptr;
+    text_buffer_put_cell(buf, p->x, p->y);
+  }
+}
 
-    while (*s == ' ') s++;
-    y = strtol(s, &endptr, 10);
-    if (s == endptr) {
-      perror("strtol");
+// Formats a part of an array of sorted cells into the thread's text buffer (run by every thread).
+static void
+formatkeys_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+  TextBuffer *buf = &text_buffers[thread_idx];
+  const uint64_t *keys = (const uint64_t *)arg;
+  size_t i, num_keys = cell_table_size(tbl_gen_current);
+  size_t begin = num_keys / num_threads * thread_idx;
+  size_t end = thread_idx + 1 == num_threads ? num_keys : num_keys / num_threads * (thread_idx + 1);
+
+  if (!text_buffer_reserve(buf, (end - begin) * CELL_FORMAT_MAX)) {
+    perror("text_buffer_reserve");
+    exit(1);
+  }
+  for (i = begin; i < end; i++) {
+    text_buffer_put_cell(buf, radix_sort_x(keys[i]), radix_sort_y(keys[i]));
+  }
+}
+
+// Formats the cells by all threads of the pool and writes the threads' buffers in order.
+static void
+writelife_parallel(int fd, task_function *format, void *arg)
+{
+  size_t i, num_threads = thread_pool_size(pool);
+
+  text_buffers = calloc(num_threads, sizeof(TextBuffer));
+  if (text_buffers == NULL) {
+    perror("calloc");
+    exit(1);
+  }
+
+  thread_pool_run(pool, format, arg);
+
+  for (i = 0; i < num_threads; i++) {
+    if (!text_buffer_flush(&text_buffers[i], fd)) {
+      perror("write");
       exit(1);
     }
-    s = endptr;
+    text_buffer_destroy(&text_buffers[i]);
+  }
 
-    c = create_cell(x, y, ALIVE);
-    if (c == NULL) {
-      perror("create_cell");
+  free(text_buffers);
+  text_buffers = NULL;
+}
+
+// Writes the cells which are alive in the current generation to an output file.
+static void
+writelife(FILE *f)
+{
+  TextBuffer buf;
+  CellTableIter iter;
+  Point2D *p;
+
+  fflush(f);
+
+  if (pool != NULL && cell_table_size(tbl_gen_current) >= WRITE_PARALLEL_THRESHOLD) {
+    writelife_parallel(fileno(f), &formatcells_part, NULL);
+    return;
+  }
+
+  if (!text_buffer_init(&buf, WRITE_BUFFER_SIZE)) {
+    perror("text_buffer_init");
+    exit(1);
+  }
+
+  cell_table_iter_init(tbl_gen_current, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+    p = cell_table_iter_get_key(&iter);
+    if (buf.capacity - buf.size < CELL_FORMAT_MAX && !text_buffer_flush(&buf, fileno(f))) {
+      perror("write");
       exit(1);
     }
+    text_buffer_put_cell(&buf, p->x, p->y);
+  }
+
+  if (!text_buffer_flush(&buf, fileno(f))) {
+    perror("write");
+    exit(1);
+  }
+  text_buffer_destroy(&buf);
+}
 
-    cell_table_put(tbl_gen_current, &c->coordinates, c);
+// Writes the cells which are alive in the current generation to an output file, sorted by x, then y.
+static void
+writelife_sorted(FILE *f)
+{
+  TextBuffer buf;
+  CellTableIter iter;
+  uint64_t *keys;
+  Point2D *p;
+  size_t i, num_keys = 0;
 
-    while (*s == ' ' || *s == '\n') s++;
+  keys = malloc((cell_table_size(tbl_gen_current) + 1) * sizeof(uint64_t));
+  if (keys == NULL) {
+    perror("malloc");
+    exit(1);
   }
 
-  munmap(begin, sb.st_size);
+  cell_table_iter_init(tbl_gen_current, &iter);
+  while (cell_table_iter_has_next(&iter)) {
+    cell_table_iter_next(&iter);
+    p = cell_table_iter_get_key(&iter);
+    if (!snapshot_fits(p->x, p->y)) {
+      fprintf(stderr, "cell %ld %ld cannot be sorted\n", p->x, p->y);
+      exit(1);
+    }
+    keys[num_keys++] = radix_sort_pack(p->x, p->y);
+  }
+
+  if (!radix_sort(keys, num_keys, pool)) {
+    perror("radix_sort");
+    exit(1);
+  }
+
+  fflush(f);
+
+  if (pool != NULL && num_keys >= WRITE_PARALLEL_THRESHOLD) {
+    writelife_parallel(fileno(f), &formatkeys_part, keys);
+  } else {
+    if (!text_buffer_init(&buf, WRITE_BUFFER_SIZE)) {
+      perror("text_buffer_init");
+      exit(1);
+    }
+    for (i = 0; i < num_keys; i++) {
+      if (buf.capacity - buf.size < CELL_FORMAT_MAX && !text_buffer_flush(&buf, fileno(f))) {
+        perror("write");
+        exit(1);
+      }
+      text_buffer_put_cell(&buf, radix_sort_x(keys[i]), radix_sort_y(keys[i]));
+    }
+    if (!text_buffer_flush(&buf, fileno(f))) {
+      perror("write");
+      exit(1);
+    }
+    text_buffer_destroy(&buf);
+  }
+
+  free(keys);
 }
 
-// Writes the cells which are alive in the current generation to an output file.
-static void
-writelife(FILE *f)
+// Collects the cells which are alive in the current generation into a packed array (allocated on the heap).
+static SnapshotCell *
+collectcells(size_t *num_cells)
 {
   CellTableIter iter;
+  SnapshotCell *cells;
   Point2D *p;
+  size_t i = 0;
+
+  cells = malloc((cell_table_size(tbl_gen_current) + 1) * sizeof(SnapshotCell));
+  if (cells == NULL) {
+    perror("malloc");
+    exit(1);
+  }
 
   cell_table_iter_init(tbl_gen_current, &iter);
   while (cell_table_iter_has_next(&iter)) {
     cell_table_iter_next(&iter);
     p = cell_table_iter_get_key(&iter);
-    fprintf(f, "%ld %ld\n", p->x, p->y);
+    if (!snapshot_fits(p->x, p->y)) {
+      fprintf(stderr, "cell %ld %ld does not fit into 32-bit coordinates\n", p->x, p->y);
+      exit(1);
+    }
+    cells[i].x = p->x;
+    cells[i].y = p->y;
+    i++;
+  }
+
+  *num_cells = i;
+  return cells;
+}
+
+// Writes the cells which are alive in the current generation to an output file as a snapshot;
+// with_table includes the raw bucket array of the cell table.
+static void
+writesnapshot(FILE *f, int with_table)
+{
+  SnapshotCell *cells;
+  size_t num_cells;
+
+  cells = collectcells(&num_cells);
+
+  // the raw bucket array holds all cells only once an incremental rehash is completed
+  if (with_table) {
+    cell_table_finish_rehash(tbl_gen_current);
+  }
+
+  if (!snapshot_write(f, generation, 0, cells, num_cells, with_table ? tbl_gen_current->buckets : NULL, tbl_gen_current->num_buckets,
+                      CELL_TABLE_BUCKET_SIZE)) {
+    perror("snapshot_write");
+    exit(1);
+  }
+
+  free(cells);
+}
+
+// Writes the cells which are alive in the current generation to an output file in the compact format.
+static void
+writecompact(FILE *f)
+{
+  SnapshotCell *cells;
+  size_t num_cells;
+
+  cells = collectcells(&num_cells);
+
+  if (!compact_write(f, generation, cells, num_cells, pool)) {
+    perror("compact_write");
+    exit(1);
   }
+
+  free(cells);
 }
 
 // Counts how many cells are alive in the current generation.
@@ -193,47 +1041,389 @@ countcells()
   return cell_table_size(tbl_gen_current);
 }
 
+// Hands a packed copy of the current generation to the checkpoint writer, which writes it in the background.
+static void
+checkpoint(CheckpointWriter *w)
+{
+  SnapshotCell *cells;
+  size_t num_cells;
+
+  cells = collectcells(&num_cells);
+  if (!checkpoint_writer_submit(w, generation, cells, num_cells)) {
+    perror("checkpoint");
+    exit(1);
+  }
+}
+
+// Computes the identity of the current generation as the input a run starts from.
+static uint64_t
+inputorigin(void)
+{
+  SnapshotCell *cells;
+  size_t num_cells;
+  uint64_t origin;
+
+  cells = collectcells(&num_cells);
+  origin = snapshot_origin(generation, cells, num_cells);
+  free(cells);
+  return origin;
+}
+
+// Replaces the current generation by the one of the checkpoint in a directory, if there is one which was taken of
+// the same input and does not go beyond the target generation.
+static int
+resume_checkpoint(const char *dir, uint64_t origin, uint64_t target)
+{
+  SnapshotHeader header;
+  char *path;
+  FILE *f;
+
+  path = checkpoint_path(dir);
+  if (path == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    if (errno != ENOENT) {
+      perror(path);
+      exit(1);
+    }
+    free(path);
+    return 0;
+  }
+
+  if (fread(&header, sizeof(SnapshotHeader), 1, f) != 1 || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+      || header.version != SNAPSHOT_VERSION) {
+    fprintf(stderr, "%s: not a checkpoint\n", path);
+    exit(1);
+  }
+  if (header.origin != origin) {
+    fprintf(stderr, "%s: checkpoint of a different input\n", path);
+    exit(1);
+  }
+  if (header.generation > target) {
+    fprintf(stderr, "%s: checkpoint of generation %llu is beyond generation %llu, ignored\n", path,
+            (unsigned long long)header.generation, (unsigned long long)target);
+    fclose(f);
+    free(path);
+    return 0;
+  }
+
+  rewind(f);
+  cell_table_clear(tbl_gen_current);
+  arena_reset(arena_gen_current);
+  readlife(f);
+
+  fclose(f);
+  free(path);
+  return 1;
+}
+
+// Writes the current generation to the trajectory as a keyframe.
+static void
+writekeyframe(TrajectoryWriter *w)
+{
+  SnapshotCell *cells;
+  size_t num_cells;
+
+  cells = collectcells(&num_cells);
+  if (!trajectory_write_keyframe(w, generation, cells, num_cells)) {
+    perror("trajectory_write_keyframe");
+    exit(1);
+  }
+  free(cells);
+}
+
+// Prints the usage and exits.
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-e checkcell|count|batch] [-j threads] [-o text|snapshot|table|compact] [-s|--sorted] [--checkpoint-every n] [--checkpoint-dir dir] [--resume] [--trajectory file [--keyframe-every n]] [--incremental-rehash] #generations <startfile | sort >endfile\n", prog);
+  exit(1);
+}
+
 int main(int argc, char **argv)
 {
+  generation_function *advance = &onegeneration;
+  OutputFormat output = OUTPUT_TEXT;
+  int sorted = 0;
   long generations;
+  long num_threads = 1;
+  long checkpoint_every = 0;
+  const char *checkpoint_dir = NULL;
+  CheckpointWriter *checkpoints = NULL;
+  int resume = 0;
+  int incremental_rehash = 0;
+  uint64_t origin = 0;
+  uint64_t target;
+  const char *trajectory_file = NULL;
+  FILE *trajectory_out = NULL;
+  TrajectoryWriter trajectory;
+  long keyframe_every = 100;
   long i;
   char *endptr;
+  int opt;
+  enum { OPT_CHECKPOINT_EVERY = 256, OPT_CHECKPOINT_DIR, OPT_RESUME, OPT_TRAJECTORY, OPT_KEYFRAME_EVERY, OPT_INCREMENTAL_REHASH };
+  static const struct option long_options[] = {
+    {"sorted", no_argument, NULL, 's'},
+    {"checkpoint-every", required_argument, NULL, OPT_CHECKPOINT_EVERY},
+    {"checkpoint-dir", required_argument, NULL, OPT_CHECKPOINT_DIR},
+    {"resume", no_argument, NULL, OPT_RESUME},
+    {"trajectory", required_argument, NULL, OPT_TRAJECTORY},
+    {"keyframe-every", required_argument, NULL, OPT_KEYFRAME_EVERY},
+    {"incremental-rehash", no_argument, NULL, OPT_INCREMENTAL_REHASH},
+    {NULL, 0, NULL, 0}
+  };
+
+  // parse options.
+  while ((opt = getopt_long(argc, argv, "e:j:o:s", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'e':
+      if (strcmp(optarg, "checkcell") == 0) {
+        advance = &onegeneration;
+      } else if (strcmp(optarg, "count") == 0) {
+        advance = &onegeneration_count;
+      } else if (strcmp(optarg, "batch") == 0) {
+        advance = &onegeneration_batch;
+      } else {
+        usage(argv[0]);
+      }
+      break;
+    case 'j':
+      num_threads = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || num_threads < 1) {
+        fprintf(stderr, "\"%s\" not a valid thread count\n", optarg);
+        exit(1);
+      }
+      break;
+    case 'o':
+      if (strcmp(optarg, "text") == 0) {
+        output = OUTPUT_TEXT;
+      } else if (strcmp(optarg, "snapshot") == 0) {
+        output = OUTPUT_SNAPSHOT;
+      } else if (strcmp(optarg, "compact") == 0) {
+        output = OUTPUT_COMPACT;
+      } else if (strcmp(optarg, "table") == 0) {
+        output = OUTPUT_TABLE;
+      } else {
+        usage(argv[0]);
+      }
+      break;
+    case 's':
+      sorted = 1;
+      break;
+    case OPT_CHECKPOINT_EVERY:
+      checkpoint_every = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || checkpoint_every < 1) {
+        fprintf(stderr, "\"%s\" not a valid checkpoint interval\n", optarg);
+        exit(1);
+      }
+      break;
+    case OPT_CHECKPOINT_DIR:
+      checkpoint_dir = optarg;
+      break;
+    case OPT_RESUME:
+      resume = 1;
+      break;
+    case OPT_TRAJECTORY:
+      trajectory_file = optarg;
+      break;
+    case OPT_KEYFRAME_EVERY:
+      keyframe_every = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || keyframe_every < 1 || keyframe_every > UINT32_MAX) {
+        fprintf(stderr, "\"%s\" not a valid keyframe interval\n", optarg);
+        exit(1);
+      }
+      break;
+    case OPT_INCREMENTAL_REHASH:
+      incremental_rehash = 1;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
 
   // arguments checking.
-  if (argc!=2) {
-    fprintf(stderr, "Usage: %s #generations <startfile | sort >endfile\n", argv[0]);
-    exit(1);
+  if (optind != argc-1 || ((checkpoint_every > 0 || resume) && checkpoint_dir == NULL)) {
+    usage(argv[0]);
   }
 
   // parse nr of generations.
-  generations = strtol(argv[1], &endptr, 10);
+  generations = strtol(argv[optind], &endptr, 10);
   if (*endptr != '\0') {
-    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[3]);
+    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[optind]);
     exit(1);
   }
 
+  // only the checkcell engine runs in parallel.
+  if (num_threads > 1) {
+    if (advance != &onegeneration) {
+      fprintf(stderr, "-j is only supported by the checkcell engine\n");
+      exit(1);
+    }
+    advance = &onegeneration_parallel;
+  }
+
+  // only the serial checkcell engine records trajectories.
+  if (trajectory_file != NULL) {
+    if (advance != &onegeneration) {
+      fprintf(stderr, "--trajectory is only supported by the serial checkcell engine\n");
+      exit(1);
+    }
+    advance = &onegeneration_trajectory;
+  }
+
   // create cell tables.
   tbl_gen_current = cell_table_create(1024, 0.75f);
   tbl_gen_next    = cell_table_create(1024, 0.75f);
+  tbl_counts      = cell_table_create(1024, 0.75f);
+  cell_table_set_incremental_rehash(tbl_gen_current, incremental_rehash);
+  cell_table_set_incremental_rehash(tbl_gen_next, incremental_rehash);
+  cell_table_set_incremental_rehash(tbl_counts, incremental_rehash);
+
+  // create arenas for the cells.
+  arena_gen_current = arena_create(ARENA_CHUNK_SIZE);
+  arena_gen_next    = arena_create(ARENA_CHUNK_SIZE);
+  arena_counts      = arena_create(ARENA_CHUNK_SIZE);
+  if (arena_gen_current == NULL || arena_gen_next == NULL || arena_counts == NULL) {
+    perror("arena_create");
+    exit(1);
+  }
+
+  // create the threads and their tables and arenas.
+  if (advance == &onegeneration_parallel) {
+    pool = thread_pool_create(num_threads);
+    tbl_threads = malloc(num_threads * sizeof(CellTable *));
+    arena_threads_current = malloc(num_threads * sizeof(Arena *));
+    arena_threads_next = malloc(num_threads * sizeof(Arena *));
+    if (pool == NULL || tbl_threads == NULL || arena_threads_current == NULL || arena_threads_next == NULL) {
+      perror("thread_pool_create");
+      exit(1);
+    }
+    for (i = 0; i < num_threads; i++) {
+      tbl_threads[i] = cell_table_create(1024, 0.75f);
+      cell_table_set_incremental_rehash(tbl_threads[i], incremental_rehash);
+      arena_threads_current[i] = arena_create(ARENA_CHUNK_SIZE);
+      arena_threads_next[i] = arena_create(ARENA_CHUNK_SIZE);
+      if (arena_threads_current[i] == NULL || arena_threads_next[i] == NULL) {
+        perror("arena_create");
+        exit(1);
+      }
+    }
+  }
 
   // read in initial generation.
   readlife(stdin);
 
+  // a resumed run continues from the latest checkpoint up to the generation the original run would have reached.
+  if (checkpoint_every > 0 || resume) {
+    origin = inputorigin();
+  }
+  if (resume) {
+    target = generation + (generations > 0 ? generations : 0);
+    if (resume_checkpoint(checkpoint_dir, origin, target)) {
+      generations = generation < target ? (long)(target - generation) : 0;
+    }
+  }
+
+  // start the checkpoint writer.
+  if (checkpoint_every > 0) {
+    if (mkdir(checkpoint_dir, 0777) == -1 && errno != EEXIST) {
+      perror(checkpoint_dir);
+      exit(1);
+    }
+    checkpoints = checkpoint_writer_create(checkpoint_dir, origin);
+    if (checkpoints == NULL) {
+      perror("checkpoint_writer_create");
+      exit(1);
+    }
+  }
+
+  // start the trajectory with a keyframe of the initial generation.
+  if (trajectory_file != NULL) {
+    trajectory_out = fopen(trajectory_file, "wb");
+    if (trajectory_out == NULL) {
+      perror(trajectory_file);
+      exit(1);
+    }
+    if (!trajectory_writer_init(&trajectory, trajectory_out, keyframe_every)) {
+      perror("trajectory_writer_init");
+      exit(1);
+    }
+    writekeyframe(&trajectory);
+  }
+
   // advance generations.
   for (i=0; i<generations; i++) {
-    onegeneration();
+    advance();
+    generation++;
+    if (trajectory_out != NULL) {
+      if (!trajectory_write_delta(&trajectory, generation, &births, &deaths)) {
+        perror("trajectory_write_delta");
+        exit(1);
+      }
+      if (generation % keyframe_every == 0) {
+        writekeyframe(&trajectory);
+      }
+    }
+    if (checkpoints != NULL && generation % checkpoint_every == 0) {
+      checkpoint(checkpoints);
+    }
   }
 
-  writelife(stdout);
+  // finish the trajectory.
+  if (trajectory_out != NULL) {
+    trajectory_writer_destroy(&trajectory);
+    if (fclose(trajectory_out) != 0) {
+      perror(trajectory_file);
+      exit(1);
+    }
+    cell_log_destroy(&births);
+    cell_log_destroy(&deaths);
+  }
 
-  fprintf(stderr,"%zu cells alive\n", countcells());
+  // wait for the last checkpoint to be written.
+  if (checkpoints != NULL && !checkpoint_writer_destroy(checkpoints)) {
+    perror("checkpoint");
+    exit(1);
+  }
 
-  // free memory allocated for cells.
-  cell_table_map(tbl_gen_current, &cell_table_gen_free);
+  if (output == OUTPUT_TEXT && sorted) {
+    writelife_sorted(stdout);
+  } else if (output == OUTPUT_TEXT) {
+    writelife(stdout);
+  } else if (output == OUTPUT_COMPACT) {
+    writecompact(stdout);
+  } else {
+    writesnapshot(stdout, output == OUTPUT_TABLE);
+  }
+
+  fprintf(stderr,"%zu cells alive\n", countcells());
 
   // destroy cell tables.
   cell_table_destroy(tbl_gen_current);
   cell_table_destroy(tbl_gen_next);
+  cell_table_destroy(tbl_counts);
+
+  // free memory allocated for cells.
+  arena_destroy(arena_gen_current);
+  arena_destroy(arena_gen_next);
+  arena_destroy(arena_counts);
+
+  // stop the threads and free their tables and arenas.
+  if (pool != NULL) {
+    for (i = 0; i < num_threads; i++) {
+      cell_table_destroy(tbl_threads[i]);
+      arena_destroy(arena_threads_current[i]);
+      arena_destroy(arena_threads_next[i]);
+    }
+    free(tbl_threads);
+    free(arena_threads_current);
+    free(arena_threads_next);
+    thread_pool_destroy(pool);
+  }
 
   return 0;
 }
@@ -1,5 +1,7 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -8,47 +10,92 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
-#include "hash_table.h"
+#include "arena.h"
+#include "cell_format.h"
+#include "cell_reader.h"
+#include "compact.h"
+#include "hash_table_spec.h"
 #include "life.h"
-
-static HashTable *tbl_gen_current;
-static HashTable *tbl_gen_next;
+#include "radix_sort.h"
+#include "snapshot.h"
+#include "thread_pool.h"
 
 // Calculates a FNV hash for a Point2D instance.
 static inline unsigned int
-hash_point2d(const void *p)
+hash_point2d(const Point2D *p)
 {
-  return hash_bytes(p, sizeof(Point2D));
+  return hash_table_spec_bytes(p, sizeof(Point2D));
 }
 
 // Used to compare two Point2D instances.
 static inline int
-point2d_cmp(const void *a, const void *b)
+point2d_cmp(const Point2D *p1, const Point2D *p2)
 {
-  Point2D *p1 = (Point2D *)a, *p2 = (Point2D *)b;
   int dx = p1->x - p2->x;
   return (dx == 0) ? (p1->y - p2->y) : dx;
 }
 
-// Used to free all cell instances put into the cell table(s).
-static void
-hash_table_gen_free(HashTableEntry *entry)
-{
-  free(entry->val);
-  entry->val = NULL;
-}
+// The cell tables: a hash table specialized for Point2D keys (stored inline) and Cell values.
+#define HASH_TABLE_SPEC_PREFIX point_table
+#define HASH_TABLE_SPEC_TYPE PointTable
+#define HASH_TABLE_SPEC_KEY_T Point2D
+#define HASH_TABLE_SPEC_VAL_T Cell *
+#define HASH_TABLE_SPEC_HASH hash_point2d
+#define HASH_TABLE_SPEC_CMP point2d_cmp
+#include "hash_table_spec.h"
+
+static PointTable *tbl_gen_current;
+static PointTable *tbl_gen_next;
+
+// The cells of a generation are allocated from the arena that belongs to the generation's table.
+static Arena *arena_gen_current;
+static Arena *arena_gen_next;
+
+// The size of the chunks the arenas allocate from the heap.
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// The neighbor counts of all cells that might be alive in the next generation (see onegeneration_count()).
+static PointTable *tbl_counts;
+static Arena *arena_counts;
+
+// A cell allocated from arena_counts that has not been put into tbl_counts (yet).
+static Cell *spare_cell;
+
+// The threads used by onegeneration_parallel(); every thread collects the cells alive in the next generation in its
+// own hash table (allocated from its own pair of arenas) which are merged into tbl_gen_next afterwards.
+static ThreadPool *pool;
+static PointTable **tbl_threads;
+static Arena **arena_threads_current;
+static Arena **arena_threads_next;
+
+// The number of the current generation (counting from the generation of an input snapshot).
+static uint64_t generation;
+
+// The output formats.
+typedef enum { OUTPUT_TEXT, OUTPUT_SNAPSHOT, OUTPUT_COMPACT } OutputFormat;
+
+// The size of the buffer the cells are formatted into before they are written.
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// Generations with at least this many cells are formatted by all threads of the pool, each into its own buffer.
+#define WRITE_PARALLEL_THRESHOLD (1 << 16)
+static TextBuffer *text_buffers;
+
+// The function used to advance the game of life by one generation.
+typedef void generation_function(void);
 
-// Creates a cell instance, allocated on the heap.
+// Creates a cell instance, allocated from an arena.
 static inline Cell *
-create_cell(long x, long y, Status status)
+create_cell(Arena *arena, long x, long y, Status status)
 {
-    Cell *c = (Cell *)malloc(sizeof(Cell));
+    Cell *c = (Cell *)arena_alloc(arena, sizeof(Cell));
     if (c == NULL) {
         return NULL;
     }
     c->coordinates.x = x;
     c->coordinates.y = y;
     c->status = status;
+    c->neighbors = 0;
     return c;
 }
 
@@ -59,13 +106,13 @@ long alive(long x, long y)
   Point2D p;
   p.x = x;
   p.y = y;
-  return hash_table_contains(tbl_gen_current, &p);
+  return point_table_contains(tbl_gen_current, &p);
 }
 
 // Checks if a cell should be alive in the next generation;
-// if the cell is alive, it is created and stored for the next generation.
+// if the cell is alive, it is created from the given arena and stored in the given table.
 static void
-checkcell(long x, long y)
+checkcell(PointTable *tbl, Arena *arena, long x, long y)
 {
   Cell *c;
   int n=0;
@@ -82,41 +129,115 @@ checkcell(long x, long y)
   /*fprintf(stderr,"checkcell x=%ld y=%ld old=%p new=%p n=%d\n",x,y,old,new,n);*/
 
   if (n == 3 || (n == 2 && alive(x, y))) {
-    c = create_cell(x, y, ALIVE);
+    c = create_cell(arena, x, y, ALIVE);
     if (c == NULL) {
       perror("create_cell");
       exit(1);
     }
-    hash_table_put(tbl_gen_next, &c->coordinates, c);
+    point_table_put(tbl, &c->coordinates, c);
   }
 }
 
 // Advanced the game of life by one generation.
 static void
-onegeneration()
+onegeneration(void)
+{
+  PointTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  PointTableIter iter;
+  const Point2D *p;
+  long x, y;
+
+  point_table_iter_init(tbl_gen_current, &iter);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+
+    p = point_table_iter_get_key(&iter);
+    x = p->x;
+    y = p->y;
+
+    checkcell(tbl_gen_next, arena_gen_next, x-1, y-1);
+    checkcell(tbl_gen_next, arena_gen_next, x-1, y+0);
+    checkcell(tbl_gen_next, arena_gen_next, x-1, y+1);
+    checkcell(tbl_gen_next, arena_gen_next, x+0, y-1);
+    checkcell(tbl_gen_next, arena_gen_next, x+0, y+0);
+    checkcell(tbl_gen_next, arena_gen_next, x+0, y+1);
+    checkcell(tbl_gen_next, arena_gen_next, x+1, y-1);
+    checkcell(tbl_gen_next, arena_gen_next, x+1, y+0);
+    checkcell(tbl_gen_next, arena_gen_next, x+1, y+1);
+  }
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation cell table; its cells are released all at once
+  arena_reset(arena_gen_next);
+  point_table_clear(tbl_gen_next);
+}
+
+// Checks the cells around the alive cells of one part of the current generation (run by every thread of the pool).
+static void
+checkcells_part(void *arg, size_t thread_idx, size_t num_threads)
 {
-  HashTable *tbl_gen_tmp;
-  HashTableIter iter;
-  Point2D *p;
+  PointTable *tbl = tbl_threads[thread_idx];
+  Arena *arena = arena_threads_next[thread_idx];
+  PointTableIter iter;
+  const Point2D *p;
   long x, y;
 
-  hash_table_iter_init(tbl_gen_current, &iter);
-  while (hash_table_iter_has_next(&iter)) {
-    hash_table_iter_next(&iter);
+  (void)arg;
+
+  point_table_iter_init_part(tbl_gen_current, &iter, thread_idx, num_threads);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
 
-    p = hash_table_iter_get_key(&iter);
+    p = point_table_iter_get_key(&iter);
     x = p->x;
     y = p->y;
 
-    checkcell(x-1, y-1);
-    checkcell(x-1, y+0);
-    checkcell(x-1, y+1);
-    checkcell(x+0, y-1);
-    checkcell(x+0, y+0);
-    checkcell(x+0, y+1);
-    checkcell(x+1, y-1);
-    checkcell(x+1, y+0);
-    checkcell(x+1, y+1);
+    checkcell(tbl, arena, x-1, y-1);
+    checkcell(tbl, arena, x-1, y+0);
+    checkcell(tbl, arena, x-1, y+1);
+    checkcell(tbl, arena, x+0, y-1);
+    checkcell(tbl, arena, x+0, y+0);
+    checkcell(tbl, arena, x+0, y+1);
+    checkcell(tbl, arena, x+1, y-1);
+    checkcell(tbl, arena, x+1, y+0);
+    checkcell(tbl, arena, x+1, y+1);
+  }
+}
+
+// Advanced the game of life by one generation;
+// like onegeneration(), but the alive cells of the current generation are split among the threads of the pool.
+static void
+onegeneration_parallel(void)
+{
+  PointTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  PointTableIter iter;
+  Cell *c;
+  size_t i;
+
+  thread_pool_run(pool, &checkcells_part, NULL);
+
+  // merge the per-thread tables; a cell may have been found by more than one thread
+  for (i = 0; i < thread_pool_size(pool); ++i) {
+    point_table_iter_init(tbl_threads[i], &iter);
+    while (point_table_iter_has_next(&iter)) {
+      point_table_iter_next(&iter);
+      c = point_table_iter_get_value(&iter);
+      if (!point_table_put(tbl_gen_next, &c->coordinates, c)) {
+        perror("point_table_put");
+        exit(1);
+      }
+    }
+    point_table_clear(tbl_threads[i]);
   }
 
   // use calculated, next generation as current generation
@@ -124,20 +245,227 @@ onegeneration()
   tbl_gen_current = tbl_gen_next;
   tbl_gen_next = tbl_gen_tmp;
 
-  // clean next generation cell table
-  hash_table_map(tbl_gen_next, &hash_table_gen_free);
-  hash_table_clear(tbl_gen_next);
+  for (i = 0; i < thread_pool_size(pool); ++i) {
+    arena_gen_tmp = arena_threads_current[i];
+    arena_threads_current[i] = arena_threads_next[i];
+    arena_threads_next[i] = arena_gen_tmp;
+    arena_reset(arena_threads_next[i]);
+  }
+
+  // clean next generation hash table
+  point_table_clear(tbl_gen_next);
+}
+
+// Returns the neighbor count cell for (x, y), putting a new (dead) one into the count table if necessary.
+static inline Cell *
+countcell(long x, long y)
+{
+  Cell *c;
+
+  if (spare_cell == NULL) {
+    spare_cell = create_cell(arena_counts, x, y, DEAD);
+    if (spare_cell == NULL) {
+      perror("create_cell");
+      exit(1);
+    }
+  } else {
+    spare_cell->coordinates.x = x;
+    spare_cell->coordinates.y = y;
+  }
+
+  c = point_table_get_or_put(tbl_counts, &spare_cell->coordinates, spare_cell);
+  if (c == NULL) {
+    perror("point_table_get_or_put");
+    exit(1);
+  }
+
+  // the spare cell is in use now
+  if (c == spare_cell) {
+    spare_cell = NULL;
+  }
+
+  return c;
 }
 
-// Reads the initial state of the cells from an input file.
+// Advanced the game of life by one generation;
+// unlike onegeneration(), every alive cell adds itself to the neighbor counts of the surrounding cells (9 lookups
+// per alive cell), then the rules are applied to the counted cells (instead of 81 lookups per alive cell).
+static void
+onegeneration_count(void)
+{
+  PointTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  PointTableIter iter;
+  const Point2D *p;
+  Cell *c;
+  long x, y;
+
+  // pass 1: count neighbors
+  point_table_iter_init(tbl_gen_current, &iter);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+
+    p = point_table_iter_get_key(&iter);
+    x = p->x;
+    y = p->y;
+
+    countcell(x+0, y+0)->status = ALIVE;
+    countcell(x-1, y-1)->neighbors++;
+    countcell(x-1, y+0)->neighbors++;
+    countcell(x-1, y+1)->neighbors++;
+    countcell(x+0, y-1)->neighbors++;
+    countcell(x+0, y+1)->neighbors++;
+    countcell(x+1, y-1)->neighbors++;
+    countcell(x+1, y+0)->neighbors++;
+    countcell(x+1, y+1)->neighbors++;
+  }
+
+  // pass 2: apply rules
+  point_table_iter_init(tbl_counts, &iter);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+
+    c = point_table_iter_get_value(&iter);
+    if (c->neighbors == 3 || (c->neighbors == 2 && c->status == ALIVE)) {
+      c = create_cell(arena_gen_next, c->coordinates.x, c->coordinates.y, ALIVE);
+      if (c == NULL) {
+        perror("create_cell");
+        exit(1);
+      }
+      point_table_put(tbl_gen_next, &c->coordinates, c);
+    }
+  }
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation and neighbor count tables
+  arena_reset(arena_gen_next);
+  point_table_clear(tbl_gen_next);
+  arena_reset(arena_counts);
+  point_table_clear(tbl_counts);
+  spare_cell = NULL;
+}
+
+// Reads the initial state of the cells from a snapshot.
+static void
+readsnapshot(const Snapshot *snap)
+{
+  size_t num_cells = snap->header->num_cells;
+  Cell *cells;
+  size_t i;
+
+  generation = snap->header->generation;
+  if (num_cells == 0) {
+    return;
+  }
+
+  cells = (Cell *)arena_alloc(arena_gen_current, num_cells * sizeof(Cell));
+  if (cells == NULL) {
+    perror("arena_alloc");
+    exit(1);
+  }
+
+  for (i = 0; i < num_cells; i++) {
+    cells[i].coordinates.x = snap->cells[i].x;
+    cells[i].coordinates.y = snap->cells[i].y;
+    cells[i].status = ALIVE;
+    cells[i].neighbors = 0;
+    point_table_put(tbl_gen_current, &cells[i].coordinates, &cells[i]);
+  }
+}
+
+// Puts the cells of the initial generation into tbl_gen_current.
+static void
+buildtable(const Point2D *coordinates, size_t num_cells)
+{
+  Cell *cells;
+  size_t i;
+
+  if (num_cells == 0) {
+    return;
+  }
+
+  cells = (Cell *)arena_alloc(arena_gen_current, num_cells * sizeof(Cell));
+  if (cells == NULL) {
+    perror("arena_alloc");
+    exit(1);
+  }
+
+  for (i = 0; i < num_cells; i++) {
+    cells[i].coordinates = coordinates[i];
+    cells[i].status = ALIVE;
+    cells[i].neighbors = 0;
+    if (!point_table_put(tbl_gen_current, &cells[i].coordinates, &cells[i])) {
+      perror("point_table_put");
+      exit(1);
+    }
+  }
+}
+
+// Reads the initial state of the cells from a compact file, decoding its blocks with all threads of the pool (if any).
+static void
+readcompact(const Compact *c)
+{
+  Point2D *coordinates;
+
+  generation = c->header->generation;
+
+  coordinates = malloc(((size_t)c->header->num_cells + 1) * sizeof(Point2D));
+  if (coordinates == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  if (!compact_decode(c, coordinates, pool)) {
+    fprintf(stderr, "corrupt compact input\n");
+    exit(1);
+  }
+  buildtable(coordinates, c->header->num_cells);
+  free(coordinates);
+}
+
+// Reads the initial state of the cells from the content of an input file (text, snapshot or compact).
+static void
+readinput(const char *begin, size_t size)
+{
+  Snapshot snap;
+  Compact c;
+  CellList list;
+
+  // binary snapshots and compact files are recognized by their magic bytes
+  if (snapshot_parse(&snap, begin, size)) {
+    readsnapshot(&snap);
+    return;
+  }
+  if (compact_parse(&c, begin, size)) {
+    readcompact(&c);
+    return;
+  }
+
+  // read cells of input file (coordinate pairs, Life 1.06 or RLE)
+  if (!cell_reader_parse(&list, begin, size, pool)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  buildtable(list.cells, list.num_cells);
+  cell_list_free(&list);
+}
+
+// Reads the initial state of the cells from an input file; regular files are mapped into memory, pipes are streamed.
 static void
 readlife(FILE *f)
 {
+  CellList list;
   struct stat sb;
   int fd;
-  char *begin, *s, *end;
-  long x, y;
-  Cell *c;
+  char *begin;
+  size_t size;
 
   fd = fileno(f);
 
@@ -148,108 +476,435 @@ readlife(FILE *f)
   }
 
   // map file into memory
-  begin = s = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    begin = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (begin != MAP_FAILED) {
+      readinput(begin, sb.st_size);
+      munmap(begin, sb.st_size);
+      return;
+    }
+  }
+
+  // stream coordinate pairs, other inputs are read entirely
+  if (!cell_reader_parse_stream(&list, fd, pool, &begin, &size)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  if (begin != NULL) {
+    readinput(begin, size);
+    free(begin);
+  } else {
+    buildtable(list.cells, list.num_cells);
+    cell_list_free(&list);
+  }
+}
+
+// Formats the cells of one part of the current generation into the thread's text buffer (run by every thread).
+static void
+formatcells_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+  TextBuffer *buf = &text_buffers[thread_idx];
+  PointTableIter iter;
+  const Point2D *p;
+
+  (void)arg;
+
+  point_table_iter_init_part(tbl_gen_current, &iter, thread_idx, num_threads);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+    p = point_table_iter_get_key(&iter);
+    if (!text_buffer_reserve(buf, CELL_FORMAT_MAX)) {
+      perror("text_buffer_reserve");
+      exit(1);
+    }
+    text_buffer_put_cell(buf, p->x, p->y);
+  }
+}
 
-  // TODO: skip header, see readlife.y
+// Formats a part of an array of sorted cells into the thread's text buffer (run by every thread).
+static void
+formatkeys_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+  TextBuffer *buf = &text_buffers[thread_idx];
+  const uint64_t *keys = (const uint64_t *)arg;
+  size_t i, num_keys = point_table_size(tbl_gen_current);
+  size_t begin = num_keys / num_threads * thread_idx;
+  size_t end = thread_idx + 1 == num_threads ? num_keys : num_keys / num_threads * (thread_idx + 1);
+
+  if (!text_buffer_reserve(buf, (end - begin) * CELL_FORMAT_MAX)) {
+    perror("text_buffer_reserve");
+    exit(1);
+  }
+  for (i = begin; i < end; i++) {
+    text_buffer_put_cell(buf, radix_sort_x(keys[i]), radix_sort_y(keys[i]));
+  }
+}
 
-  // read cells of input file
-  end = s + sb.st_size;
-  while (s < end) {
-    char *endptr;
+// Formats the cells by all threads of the pool and writes the threads' buffers in order.
+static void
+writelife_parallel(int fd, task_function *format, void *arg)
+{
+  size_t i, num_threads = thread_pool_size(pool);
 
-    while (*s == ' ') s++;
-    x = strtol(s, &endptr, 10);
-    if (s == endptr) {
-      perror("strtol");
+  text_buffers = calloc(num_threads, sizeof(TextBuffer));
+  if (text_buffers == NULL) {
+    perror("calloc");
+    exit(1);
+  }
+
+  thread_pool_run(pool, format, arg);
+
+  for (i = 0; i < num_threads; i++) {
+    if (!text_buffer_flush(&text_buffers[i], fd)) {
+      perror("write");
       exit(1);
     }
-    s = endptr;
+    text_buffer_destroy(&text_buffers[i]);
+  }
 
-    while (*s == ' ') s++;
-    y = strtol(s, &endptr, 10);
-    if (s == endptr) {
-      perror("strtol");
+  free(text_buffers);
+  text_buffers = NULL;
+}
+
+// Writes the cells which are alive in the current generation to an output file.
+static void
+writelife(FILE *f)
+{
+  TextBuffer buf;
+  PointTableIter iter;
+  const Point2D *p;
+
+  fflush(f);
+
+  if (pool != NULL && point_table_size(tbl_gen_current) >= WRITE_PARALLEL_THRESHOLD) {
+    writelife_parallel(fileno(f), &formatcells_part, NULL);
+    return;
+  }
+
+  if (!text_buffer_init(&buf, WRITE_BUFFER_SIZE)) {
+    perror("text_buffer_init");
+    exit(1);
+  }
+
+  point_table_iter_init(tbl_gen_current, &iter);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+    p = point_table_iter_get_key(&iter);
+    if (buf.capacity - buf.size < CELL_FORMAT_MAX && !text_buffer_flush(&buf, fileno(f))) {
+      perror("write");
       exit(1);
     }
-    s = endptr;
+    text_buffer_put_cell(&buf, p->x, p->y);
+  }
 
-    c = create_cell(x, y, ALIVE);
-    if (c == NULL) {
-      perror("create_cell");
+  if (!text_buffer_flush(&buf, fileno(f))) {
+    perror("write");
+    exit(1);
+  }
+  text_buffer_destroy(&buf);
+}
+
+// Writes the cells which are alive in the current generation to an output file, sorted by x, then y.
+static void
+writelife_sorted(FILE *f)
+{
+  TextBuffer buf;
+  PointTableIter iter;
+  uint64_t *keys;
+  const Point2D *p;
+  size_t i, num_keys = 0;
+
+  keys = malloc((point_table_size(tbl_gen_current) + 1) * sizeof(uint64_t));
+  if (keys == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  point_table_iter_init(tbl_gen_current, &iter);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+    p = point_table_iter_get_key(&iter);
+    if (!snapshot_fits(p->x, p->y)) {
+      fprintf(stderr, "cell %ld %ld cannot be sorted\n", p->x, p->y);
       exit(1);
     }
+    keys[num_keys++] = radix_sort_pack(p->x, p->y);
+  }
+
+  if (!radix_sort(keys, num_keys, pool)) {
+    perror("radix_sort");
+    exit(1);
+  }
 
-    hash_table_put(tbl_gen_current, &c->coordinates, c);
+  fflush(f);
 
-    while (*s == ' ' || *s == '\n') s++;
+  if (pool != NULL && num_keys >= WRITE_PARALLEL_THRESHOLD) {
+    writelife_parallel(fileno(f), &formatkeys_part, keys);
+  } else {
+    if (!text_buffer_init(&buf, WRITE_BUFFER_SIZE)) {
+      perror("text_buffer_init");
+      exit(1);
+    }
+    for (i = 0; i < num_keys; i++) {
+      if (buf.capacity - buf.size < CELL_FORMAT_MAX && !text_buffer_flush(&buf, fileno(f))) {
+        perror("write");
+        exit(1);
+      }
+      text_buffer_put_cell(&buf, radix_sort_x(keys[i]), radix_sort_y(keys[i]));
+    }
+    if (!text_buffer_flush(&buf, fileno(f))) {
+      perror("write");
+      exit(1);
+    }
+    text_buffer_destroy(&buf);
   }
 
-  munmap(begin, sb.st_size);
+  free(keys);
 }
 
-// Writes the cells which are alive in the current generation to an output file.
+// Collects the cells which are alive in the current generation into a packed array (allocated on the heap).
+static SnapshotCell *
+collectcells(size_t *num_cells)
+{
+  PointTableIter iter;
+  SnapshotCell *cells;
+  const Point2D *p;
+  size_t i = 0;
+
+  cells = malloc((point_table_size(tbl_gen_current) + 1) * sizeof(SnapshotCell));
+  if (cells == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  point_table_iter_init(tbl_gen_current, &iter);
+  while (point_table_iter_has_next(&iter)) {
+    point_table_iter_next(&iter);
+    p = point_table_iter_get_key(&iter);
+    if (!snapshot_fits(p->x, p->y)) {
+      fprintf(stderr, "cell %ld %ld does not fit into 32-bit coordinates\n", p->x, p->y);
+      exit(1);
+    }
+    cells[i].x = p->x;
+    cells[i].y = p->y;
+    i++;
+  }
+
+  *num_cells = i;
+  return cells;
+}
+
+// Writes the cells which are alive in the current generation to an output file as a snapshot.
 static void
-writelife(FILE *f)
+writesnapshot(FILE *f)
 {
-  HashTableIter iter;
-  Point2D *p;
+  SnapshotCell *cells;
+  size_t num_cells;
 
-  hash_table_iter_init(tbl_gen_current, &iter);
-  while (hash_table_iter_has_next(&iter)) {
-    hash_table_iter_next(&iter);
-    p = hash_table_iter_get_key(&iter);
-    fprintf(f, "%ld %ld\n", p->x, p->y);
+  cells = collectcells(&num_cells);
+
+  if (!snapshot_write(f, generation, 0, cells, num_cells, NULL, 0, 0)) {
+    perror("snapshot_write");
+    exit(1);
   }
+
+  free(cells);
+}
+
+// Writes the cells which are alive in the current generation to an output file in the compact format.
+static void
+writecompact(FILE *f)
+{
+  SnapshotCell *cells;
+  size_t num_cells;
+
+  cells = collectcells(&num_cells);
+
+  if (!compact_write(f, generation, cells, num_cells, pool)) {
+    perror("compact_write");
+    exit(1);
+  }
+
+  free(cells);
 }
 
 // Counts how many cells are alive in the current generation.
 static inline size_t
 countcells()
 {
-  return hash_table_size(tbl_gen_current);
+  return point_table_size(tbl_gen_current);
+}
+
+// Prints the usage and exits.
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-e checkcell|count] [-j threads] [-o text|snapshot|compact] [-s|--sorted] [--incremental-rehash] #generations <startfile | sort >endfile\n", prog);
+  exit(1);
 }
 
 int main(int argc, char **argv)
 {
+  generation_function *advance = &onegeneration;
+  OutputFormat output = OUTPUT_TEXT;
+  int sorted = 0;
+  int incremental_rehash = 0;
   long generations;
+  long num_threads = 1;
   long i;
   char *endptr;
+  int opt;
+  enum { OPT_INCREMENTAL_REHASH = 256 };
+  static const struct option long_options[] = {
+    {"sorted", no_argument, NULL, 's'},
+    {"incremental-rehash", no_argument, NULL, OPT_INCREMENTAL_REHASH},
+    {NULL, 0, NULL, 0}
+  };
+
+  // parse options.
+  while ((opt = getopt_long(argc, argv, "e:j:o:s", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'e':
+      if (strcmp(optarg, "checkcell") == 0) {
+        advance = &onegeneration;
+      } else if (strcmp(optarg, "count") == 0) {
+        advance = &onegeneration_count;
+      } else {
+        usage(argv[0]);
+      }
+      break;
+    case 'j':
+      num_threads = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || num_threads < 1) {
+        fprintf(stderr, "\"%s\" not a valid thread count\n", optarg);
+        exit(1);
+      }
+      break;
+    case 'o':
+      if (strcmp(optarg, "text") == 0) {
+        output = OUTPUT_TEXT;
+      } else if (strcmp(optarg, "snapshot") == 0) {
+        output = OUTPUT_SNAPSHOT;
+      } else if (strcmp(optarg, "compact") == 0) {
+        output = OUTPUT_COMPACT;
+      } else {
+        usage(argv[0]);
+      }
+      break;
+    case 's':
+      sorted = 1;
+      break;
+    case OPT_INCREMENTAL_REHASH:
+      incremental_rehash = 1;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
 
   // arguments checking.
-  if (argc!=2) {
-    fprintf(stderr, "Usage: %s #generations <startfile | sort >endfile\n", argv[0]);
-    exit(1);
+  if (optind != argc-1) {
+    usage(argv[0]);
   }
 
   // parse nr of generations.
-  generations = strtol(argv[1], &endptr, 10);
+  generations = strtol(argv[optind], &endptr, 10);
   if (*endptr != '\0') {
-    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[3]);
+    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[optind]);
     exit(1);
   }
 
+  // only the checkcell engine runs in parallel.
+  if (num_threads > 1) {
+    if (advance != &onegeneration) {
+      fprintf(stderr, "-j is only supported by the checkcell engine\n");
+      exit(1);
+    }
+    advance = &onegeneration_parallel;
+  }
+
   // create cell tables.
-  tbl_gen_current = hash_table_create(1024, 0.75f, &hash_point2d, &point2d_cmp);
-  tbl_gen_next    = hash_table_create(1024, 0.75f, &hash_point2d, &point2d_cmp);
+  tbl_gen_current = point_table_create(1024, 0.75f);
+  tbl_gen_next    = point_table_create(1024, 0.75f);
+  tbl_counts      = point_table_create(1024, 0.75f);
+  point_table_set_incremental_rehash(tbl_gen_current, incremental_rehash);
+  point_table_set_incremental_rehash(tbl_gen_next, incremental_rehash);
+  point_table_set_incremental_rehash(tbl_counts, incremental_rehash);
+
+  // create arenas for the cells.
+  arena_gen_current = arena_create(ARENA_CHUNK_SIZE);
+  arena_gen_next    = arena_create(ARENA_CHUNK_SIZE);
+  arena_counts      = arena_create(ARENA_CHUNK_SIZE);
+  if (arena_gen_current == NULL || arena_gen_next == NULL || arena_counts == NULL) {
+    perror("arena_create");
+    exit(1);
+  }
+
+  // create the threads and their tables and arenas.
+  if (advance == &onegeneration_parallel) {
+    pool = thread_pool_create(num_threads);
+    tbl_threads = malloc(num_threads * sizeof(PointTable *));
+    arena_threads_current = malloc(num_threads * sizeof(Arena *));
+    arena_threads_next = malloc(num_threads * sizeof(Arena *));
+    if (pool == NULL || tbl_threads == NULL || arena_threads_current == NULL || arena_threads_next == NULL) {
+      perror("thread_pool_create");
+      exit(1);
+    }
+    for (i = 0; i < num_threads; i++) {
+      tbl_threads[i] = point_table_create(1024, 0.75f);
+      point_table_set_incremental_rehash(tbl_threads[i], incremental_rehash);
+      arena_threads_current[i] = arena_create(ARENA_CHUNK_SIZE);
+      arena_threads_next[i] = arena_create(ARENA_CHUNK_SIZE);
+      if (arena_threads_current[i] == NULL || arena_threads_next[i] == NULL) {
+        perror("arena_create");
+        exit(1);
+      }
+    }
+  }
 
   // read in initial generation.
   readlife(stdin);
 
   // advance generations.
   for (i=0; i<generations; i++) {
-    onegeneration();
+    advance();
+  }
+  generation += generations;
+
+  if (output == OUTPUT_TEXT && sorted) {
+    writelife_sorted(stdout);
+  } else if (output == OUTPUT_TEXT) {
+    writelife(stdout);
+  } else if (output == OUTPUT_COMPACT) {
+    writecompact(stdout);
+  } else {
+    writesnapshot(stdout);
   }
-
-  writelife(stdout);
 
   fprintf(stderr,"%zu cells alive\n", countcells());
 
-  // free memory allocated for cells.
-  hash_table_map(tbl_gen_current, &hash_table_gen_free);
-
   // destroy cell tables.
-  hash_table_destroy(tbl_gen_current);
-  hash_table_destroy(tbl_gen_next);
+  point_table_destroy(tbl_gen_current);
+  point_table_destroy(tbl_gen_next);
+  point_table_destroy(tbl_counts);
+
+  // free memory allocated for cells.
+  arena_destroy(arena_gen_current);
+  arena_destroy(arena_gen_next);
+  arena_destroy(arena_counts);
+
+  // stop the threads and free their tables and arenas.
+  if (pool != NULL) {
+    for (i = 0; i < num_threads; i++) {
+      point_table_destroy(tbl_threads[i]);
+      arena_destroy(arena_threads_current[i]);
+      arena_destroy(arena_threads_next[i]);
+    }
+    free(tbl_threads);
+    free(arena_threads_current);
+    free(arena_threads_next);
+    thread_pool_destroy(pool);
+  }
 
   return 0;
 }
@@ -0,0 +1,637 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include "cell_reader.h"
+}
+
+/**
+ * A class representing a node of the quadtree.
+ *
+ * Nodes are canonicalized by the NodeStore, i.e. there is only a single instance for any given
+ * combination of children => two nodes represent the same pattern iff they are the same pointer.
+ * This allows us to memoize the result of a node's next generation within the node itself.
+ */
+class TreeNode
+{
+public:
+    /**
+     * The north west quadrant.
+     */
+    TreeNode *northWest;
+
+    /**
+     * The north east quadrant.
+     */
+    TreeNode *northEast;
+
+    /**
+     * The south west quadrant.
+     */
+    TreeNode *southWest;
+
+    /**
+     * The south east quadrant.
+     */
+    TreeNode *southEast;
+
+    /**
+     * The memoized result of nextGeneration() (a node one level down), or NULL if not yet calculated.
+     */
+    TreeNode *result;
+
+    /**
+     * The next node in the node store's bucket chain.
+     */
+    TreeNode *next;
+
+    /**
+     * The number of alive cells in this node.
+     */
+    unsigned long long population;
+
+    /**
+     * The level of the node; a node at level k covers 2^k x 2^k cells, leaves have level 0.
+     */
+    int level;
+
+    /**
+     * A flag used by the node store's garbage collector.
+     */
+    bool marked;
+};
+
+/**
+ * A hash set holding the canonical instance of every tree node created so far.
+ */
+class NodeStore
+{
+public:
+    /**
+     * Constructor.
+     */
+    NodeStore() : num_nodes(0), num_buckets(1 << 16), free_nodes(NULL) {
+        buckets.assign(num_buckets, NULL);
+        dead = allocate();
+        dead->northWest = dead->northEast = dead->southWest = dead->southEast = NULL;
+        dead->result = NULL;
+        dead->population = 0;
+        dead->level = 0;
+        alive = allocate();
+        *alive = *dead;
+        alive->population = 1;
+    }
+
+    /**
+     * Destructor.
+     */
+    ~NodeStore() {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            delete[] blocks[i];
+        }
+    }
+
+    /**
+     * Returns a leaf node.
+     * @param is_alive whether the leaf represents an alive or a dead cell.
+     * @return the canonical leaf node.
+     */
+    TreeNode *leaf(bool is_alive) {
+        return is_alive ? alive : dead;
+    }
+
+    /**
+     * Returns the canonical node for the given quadrants, creating it if necessary.
+     * @param nw the north west quadrant.
+     * @param ne the north east quadrant.
+     * @param sw the south west quadrant.
+     * @param se the south east quadrant.
+     * @return the canonical node.
+     */
+    TreeNode *create(TreeNode *nw, TreeNode *ne, TreeNode *sw, TreeNode *se) {
+        size_t idx = hash(nw, ne, sw, se) & (num_buckets - 1);
+
+        for (TreeNode *n = buckets[idx]; n != NULL; n = n->next) {
+            if (n->northWest == nw && n->northEast == ne && n->southWest == sw && n->southEast == se) {
+                return n;
+            }
+        }
+
+        TreeNode *n = allocate();
+        n->northWest = nw;
+        n->northEast = ne;
+        n->southWest = sw;
+        n->southEast = se;
+        n->result = NULL;
+        n->population = nw->population + ne->population + sw->population + se->population;
+        n->level = nw->level + 1;
+        n->next = buckets[idx];
+        buckets[idx] = n;
+
+        if (++num_nodes > num_buckets) {
+            rehash();
+        }
+
+        return n;
+    }
+
+    /**
+     * Returns the canonical empty node of a given level.
+     * @param level the level.
+     * @return the empty node.
+     */
+    TreeNode *empty(int level) {
+        while ((int)empties.size() <= level) {
+            if (empties.empty()) {
+                empties.push_back(dead);
+            } else {
+                TreeNode *e = empties.back();
+                empties.push_back(create(e, e, e, e));
+            }
+        }
+        return empties[level];
+    }
+
+    /**
+     * Forgets memoized results of all nodes above a given level.
+     * @param level nodes with a level greater than this one lose their result.
+     */
+    void forget(int level) {
+        for (size_t i = 0; i < num_buckets; ++i) {
+            for (TreeNode *n = buckets[i]; n != NULL; n = n->next) {
+                if (n->level > level) {
+                    n->result = NULL;
+                }
+            }
+        }
+    }
+
+    /**
+     * Returns the number of nodes currently stored.
+     * @return the number of nodes.
+     */
+    size_t size() {
+        return num_nodes;
+    }
+
+    /**
+     * Frees all nodes (and memoized results) that are not reachable from a given root.
+     * @param root the root node to keep.
+     */
+    void gc(TreeNode *root) {
+        mark(root);
+        for (size_t i = 0; i < empties.size(); ++i) {
+            mark(empties[i]);
+        }
+
+        for (size_t i = 0; i < num_buckets; ++i) {
+            TreeNode **p = &buckets[i];
+            while (*p != NULL) {
+                TreeNode *n = *p;
+                if (n->marked) {
+                    n->marked = false;
+                    p = &n->next;
+                } else {
+                    *p = n->next;
+                    n->next = free_nodes;
+                    free_nodes = n;
+                    --num_nodes;
+                }
+            }
+        }
+        dead->marked = alive->marked = false;
+    }
+
+private:
+    /**
+     * The number of nodes allocated per block.
+     */
+    static const size_t BLOCK_SIZE = 1 << 16;
+
+    /**
+     * The number of nodes currently stored.
+     */
+    size_t num_nodes;
+
+    /**
+     * The number of buckets (always a power of two).
+     */
+    size_t num_buckets;
+
+    /**
+     * The bucket chains.
+     */
+    std::vector<TreeNode *> buckets;
+
+    /**
+     * Blocks of node memory.
+     */
+    std::vector<TreeNode *> blocks;
+
+    /**
+     * Nodes that have been garbage collected and may be reused.
+     */
+    TreeNode *free_nodes;
+
+    /**
+     * The empty nodes, indexed by level.
+     */
+    std::vector<TreeNode *> empties;
+
+    /**
+     * The two leaves.
+     */
+    TreeNode *dead, *alive;
+
+    /**
+     * Calculates the hash value for a combination of quadrants.
+     */
+    static size_t hash(TreeNode *nw, TreeNode *ne, TreeNode *sw, TreeNode *se) {
+        size_t h = (size_t)(uintptr_t)nw + 11 * (size_t)(uintptr_t)ne + 101 * (size_t)(uintptr_t)sw + 1007 * (size_t)(uintptr_t)se;
+        return h ^ (h >> 11) ^ (h >> 23);
+    }
+
+    /**
+     * Returns memory for a new node, either from the free list or from the current block.
+     */
+    TreeNode *allocate() {
+        if (free_nodes == NULL) {
+            TreeNode *block = new TreeNode[BLOCK_SIZE];
+            blocks.push_back(block);
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+                block[i].next = free_nodes;
+                free_nodes = &block[i];
+            }
+        }
+        TreeNode *n = free_nodes;
+        free_nodes = n->next;
+        n->marked = false;
+        return n;
+    }
+
+    /**
+     * Doubles the number of buckets.
+     */
+    void rehash() {
+        std::vector<TreeNode *> new_buckets(num_buckets * 2, NULL);
+        size_t new_num_buckets = num_buckets * 2;
+
+        for (size_t i = 0; i < num_buckets; ++i) {
+            TreeNode *n = buckets[i];
+            while (n != NULL) {
+                TreeNode *next = n->next;
+                size_t idx = hash(n->northWest, n->northEast, n->southWest, n->southEast) & (new_num_buckets - 1);
+                n->next = new_buckets[idx];
+                new_buckets[idx] = n;
+                n = next;
+            }
+        }
+
+        buckets.swap(new_buckets);
+        num_buckets = new_num_buckets;
+    }
+
+    /**
+     * Marks a node, its quadrants and its memoized result as reachable.
+     */
+    void mark(TreeNode *n) {
+        if (n == NULL || n->marked) {
+            return;
+        }
+        n->marked = true;
+        if (n->level > 0) {
+            mark(n->northWest);
+            mark(n->northEast);
+            mark(n->southWest);
+            mark(n->southEast);
+            mark(n->result);
+        }
+    }
+};
+
+/**
+ * Game-of-life implementation based on Bill Gosper's HashLife algorithm.
+ * @see hashlife/src/ for the Java prototype.
+ */
+class Universe
+{
+public:
+    /**
+     * Constructor.
+     */
+    Universe() : step_log2(0) {
+        root = store.empty(3);
+    }
+
+    /**
+     * Reads the initial cell generation from an input file (coordinate pairs, Life 1.06 or RLE).
+     * @param f the input file.
+     */
+    void readlife(FILE *f)
+    {
+        CellList list;
+        char *raw;
+        size_t size;
+
+        // coordinate pairs are streamed, other inputs are read entirely
+        if (!cell_reader_parse_stream(&list, fileno(f), NULL, &raw, &size)) {
+            fprintf(stderr, "invalid input\n");
+            exit(1);
+        }
+        if (raw != NULL) {
+            int ok = cell_reader_parse(&list, raw, size, NULL);
+            free(raw);
+            if (!ok) {
+                fprintf(stderr, "invalid input\n");
+                exit(1);
+            }
+        }
+
+        for (size_t i = 0; i < list.num_cells; ++i) {
+            setcell(list.cells[i].x, list.cells[i].y);
+        }
+        cell_list_free(&list);
+    }
+
+    /**
+     * Writes the alive cells to an output stream.
+     * @param out the output stream.
+     */
+    void writelife(std::ostream& out) {
+        long long half = 1LL << (root->level - 1);
+        writenode(out, root, -half, -half);
+    }
+
+    /**
+     * Returns the number of alive cells.
+     * @return the number of alive cells.
+     */
+    unsigned long long countcells() {
+        return root->population;
+    }
+
+    /**
+     * Advances the universe by an arbitrary number of generations.
+     * @param generations the number of generations.
+     */
+    void run(long generations) {
+        for (int j = 0; generations != 0; ++j, generations >>= 1) {
+            if (generations & 1) {
+                step(j);
+            }
+        }
+    }
+
+private:
+    /**
+     * The canonical node store.
+     */
+    NodeStore store;
+
+    /**
+     * The root node; it is always centered at the origin.
+     */
+    TreeNode *root;
+
+    /**
+     * Controls how far nextGeneration() advances: a node of level k advances by 2^min(k-2, step_log2) generations.
+     */
+    int step_log2;
+
+    /**
+     * The number of nodes that triggers a garbage collection after a step.
+     */
+    static const size_t MAX_NODES = 1 << 22;
+
+    /**
+     * Sets a cell (given in coordinates relative to the center of the root) alive.
+     */
+    void setcell(long long x, long long y) {
+        for (;;) {
+            long long half = 1LL << (root->level - 1);
+            if (-half <= x && x < half && -half <= y && y < half) {
+                break;
+            }
+            root = expandUniverse(root);
+        }
+
+        long long half = 1LL << (root->level - 1);
+        root = setcell(root, x + half, y + half);
+    }
+
+    /**
+     * Sets a cell (given in coordinates relative to the north west corner of the node) alive.
+     */
+    TreeNode *setcell(TreeNode *n, long long x, long long y) {
+        if (n->level == 0) {
+            return store.leaf(true);
+        }
+
+        long long half = 1LL << (n->level - 1);
+        if (y < half) {
+            if (x < half) {
+                return store.create(setcell(n->northWest, x, y), n->northEast, n->southWest, n->southEast);
+            }
+            return store.create(n->northWest, setcell(n->northEast, x - half, y), n->southWest, n->southEast);
+        }
+        if (x < half) {
+            return store.create(n->northWest, n->northEast, setcell(n->southWest, x, y - half), n->southEast);
+        }
+        return store.create(n->northWest, n->northEast, n->southWest, setcell(n->southEast, x - half, y - half));
+    }
+
+    /**
+     * Writes the alive cells of a node whose north west corner is at (x, y).
+     */
+    void writenode(std::ostream& out, TreeNode *n, long long x, long long y) {
+        if (n->population == 0) {
+            return;
+        }
+        if (n->level == 0) {
+            out << x << " " << y << "\n";
+            return;
+        }
+
+        long long half = 1LL << (n->level - 1);
+        writenode(out, n->northWest, x, y);
+        writenode(out, n->northEast, x + half, y);
+        writenode(out, n->southWest, x, y + half);
+        writenode(out, n->southEast, x + half, y + half);
+    }
+
+    /**
+     * Advances the universe by 2^j generations.
+     */
+    void step(int j) {
+        if (j != step_log2) {
+            // results of nodes above level min(j, step_log2) + 2 were calculated with a different step size
+            store.forget((j < step_log2 ? j : step_log2) + 2);
+            step_log2 = j;
+        }
+
+        // make sure the pattern cannot escape the (centered) result during 2^j generations
+        while (root->level < j + 3 || !isPadded(root)) {
+            root = expandUniverse(root);
+        }
+        root = expandUniverse(root);
+
+        root = nextGeneration(root);
+
+        if (store.size() > MAX_NODES) {
+            store.gc(root);
+        }
+    }
+
+    /**
+     * Checks if all alive cells of a node are within its center half.
+     */
+    static bool isPadded(TreeNode *n) {
+        return n->northWest->population == n->northWest->southEast->population &&
+               n->northEast->population == n->northEast->southWest->population &&
+               n->southWest->population == n->southWest->northEast->population &&
+               n->southEast->population == n->southEast->northWest->population;
+    }
+
+    /**
+     * Returns a node of the next level whose center is the given node.
+     */
+    TreeNode *expandUniverse(TreeNode *n) {
+        TreeNode *border = store.empty(n->level - 1);
+        return store.create(store.create(border, border, border, n->northWest),
+                            store.create(border, border, n->northEast, border),
+                            store.create(border, n->southWest, border, border),
+                            store.create(n->southEast, border, border, border));
+    }
+
+    /**
+     * Returns the center sub node (one level down).
+     */
+    TreeNode *centeredSubnode(TreeNode *n) {
+        return store.create(n->northWest->southEast, n->northEast->southWest,
+                            n->southWest->northEast, n->southEast->northWest);
+    }
+
+    /**
+     * Returns the node (same level as west / east) centered between two horizontally adjacent nodes.
+     */
+    TreeNode *centeredHorizontal(TreeNode *west, TreeNode *east) {
+        return store.create(west->northEast, east->northWest, west->southEast, east->southWest);
+    }
+
+    /**
+     * Returns the node (same level as north / south) centered between two vertically adjacent nodes.
+     */
+    TreeNode *centeredVertical(TreeNode *north, TreeNode *south) {
+        return store.create(north->southWest, north->southEast, south->northWest, south->northEast);
+    }
+
+    /**
+     * Calculates the next generation of the 2x2 center of a level 2 node.
+     */
+    TreeNode *slowSimulation(TreeNode *n) {
+        int allbits = 0;
+
+        // collect the 4x4 cells row by row, north west cell in the highest bit
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                TreeNode *q = (y < 2) ? ((x < 2) ? n->northWest : n->northEast) : ((x < 2) ? n->southWest : n->southEast);
+                TreeNode *c = (y & 1) ? ((x & 1) ? q->southEast : q->southWest) : ((x & 1) ? q->northEast : q->northWest);
+                allbits = (allbits << 1) | (int)c->population;
+            }
+        }
+
+        return store.create(oneGeneration(allbits >> 5), oneGeneration(allbits >> 4),
+                            oneGeneration(allbits >> 1), oneGeneration(allbits));
+    }
+
+    /**
+     * Applies the game of life rules to the center of a 3x3 bitmask (bits 0-2, 4-6 and 8-10).
+     */
+    TreeNode *oneGeneration(int bitmask) {
+        int self = (bitmask >> 5) & 1;
+        int n = __builtin_popcount(bitmask & 0x757);
+        return store.leaf(n == 3 || (n == 2 && self));
+    }
+
+    /**
+     * Returns the center half of a node, advanced by 2^min(level-2, step_log2) generations.
+     */
+    TreeNode *nextGeneration(TreeNode *n) {
+        if (n->result != NULL) {
+            return n->result;
+        }
+        if (n->population == 0) {
+            return n->result = n->northWest;
+        }
+        if (n->level == 2) {
+            return n->result = slowSimulation(n);
+        }
+
+        TreeNode *n00, *n01, *n02, *n10, *n11, *n12, *n20, *n21, *n22;
+
+        if (step_log2 >= n->level - 2) {
+            // full speed: both halves of the step advance by 2^(level-3) generations
+            n00 = nextGeneration(n->northWest);
+            n01 = nextGeneration(centeredHorizontal(n->northWest, n->northEast));
+            n02 = nextGeneration(n->northEast);
+            n10 = nextGeneration(centeredVertical(n->northWest, n->southWest));
+            n11 = nextGeneration(centeredSubnode(n));
+            n12 = nextGeneration(centeredVertical(n->northEast, n->southEast));
+            n20 = nextGeneration(n->southWest);
+            n21 = nextGeneration(centeredHorizontal(n->southWest, n->southEast));
+            n22 = nextGeneration(n->southEast);
+        } else {
+            // reduced speed: only the second half of the step advances the cells
+            n00 = centeredSubnode(n->northWest);
+            n01 = centeredSubnode(centeredHorizontal(n->northWest, n->northEast));
+            n02 = centeredSubnode(n->northEast);
+            n10 = centeredSubnode(centeredVertical(n->northWest, n->southWest));
+            n11 = centeredSubnode(centeredSubnode(n));
+            n12 = centeredSubnode(centeredVertical(n->northEast, n->southEast));
+            n20 = centeredSubnode(n->southWest);
+            n21 = centeredSubnode(centeredHorizontal(n->southWest, n->southEast));
+            n22 = centeredSubnode(n->southEast);
+        }
+
+        return n->result = store.create(nextGeneration(store.create(n00, n01, n10, n11)),
+                                        nextGeneration(store.create(n01, n02, n11, n12)),
+                                        nextGeneration(store.create(n10, n11, n20, n21)),
+                                        nextGeneration(store.create(n11, n12, n21, n22)));
+    }
+};
+
+int main(int argc, char **argv)
+{
+    // arguments checking.
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s #generations <startfile | sort >endfile\n", argv[0]);
+        exit(1);
+    }
+
+    // parse nr of generations.
+    char *endptr;
+    long generations = strtol(argv[1], &endptr, 10);
+    if (*endptr != '\0' || generations < 0) {
+        fprintf(stderr, "\"%s\" not a valid generation count\n", argv[1]);
+        exit(1);
+    }
+
+    Universe *universe = new Universe();
+
+    // read in initial generation.
+    universe->readlife(stdin);
+
+    // advance generations.
+    universe->run(generations);
+
+    universe->writelife(std::cout);
+    fprintf(stderr, "%llu cells alive\n", universe->countcells());
+
+    delete universe;
+
+    return 0;
+}
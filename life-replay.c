@@ -0,0 +1,139 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cell_format.h"
+#include "trajectory.h"
+
+// The size of the buffer the cells are formatted into before they are written.
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// The size of the chunks a trajectory which cannot be mapped is read in.
+#define READ_CHUNK_SIZE (1 << 20)
+
+// Rebuilds a generation from a trajectory in memory.
+static void
+replaybuffer(const char *begin, size_t size, uint64_t generation, CellLog *cells)
+{
+  if (!trajectory_replay(begin, size, generation, cells)) {
+    fprintf(stderr, "generation %llu not found in trajectory\n", (unsigned long long)generation);
+    exit(1);
+  }
+}
+
+// Rebuilds a generation from a trajectory file (see life-cell_table --trajectory); pipes and other files which
+// cannot be mapped are read into memory.
+static void
+replaylife(FILE *f, uint64_t generation, CellLog *cells)
+{
+  struct stat sb;
+  TextBuffer buf;
+  char *begin;
+  ssize_t n;
+  int fd;
+
+  fd = fileno(f);
+
+  // get file size
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    exit(1);
+  }
+
+  // map file into memory
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    begin = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (begin != MAP_FAILED) {
+      replaybuffer(begin, sb.st_size, generation, cells);
+      munmap(begin, sb.st_size);
+      return;
+    }
+  }
+
+  // read the whole input
+  if (!text_buffer_init(&buf, READ_CHUNK_SIZE)) {
+    perror("text_buffer_init");
+    exit(1);
+  }
+  do {
+    if (!text_buffer_reserve(&buf, READ_CHUNK_SIZE)) {
+      perror("text_buffer_reserve");
+      exit(1);
+    }
+    n = read(fd, buf.data + buf.size, READ_CHUNK_SIZE);
+    if (n == -1 && errno != EINTR) {
+      perror("read");
+      exit(1);
+    }
+    buf.size += n > 0 ? (size_t)n : 0;
+  } while (n != 0);
+
+  replaybuffer(buf.data, buf.size, generation, cells);
+  text_buffer_destroy(&buf);
+}
+
+// Writes cells to an output file.
+static void
+writelife(FILE *f, const CellLog *cells)
+{
+  TextBuffer buf;
+  size_t i;
+
+  fflush(f);
+
+  if (!text_buffer_init(&buf, WRITE_BUFFER_SIZE)) {
+    perror("text_buffer_init");
+    exit(1);
+  }
+
+  for (i = 0; i < cells->num_cells; i++) {
+    if (buf.capacity - buf.size < CELL_FORMAT_MAX && !text_buffer_flush(&buf, fileno(f))) {
+      perror("write");
+      exit(1);
+    }
+    text_buffer_put_cell(&buf, cells->cells[i].x, cells->cells[i].y);
+  }
+
+  if (!text_buffer_flush(&buf, fileno(f))) {
+    perror("write");
+    exit(1);
+  }
+  text_buffer_destroy(&buf);
+}
+
+int main(int argc, char **argv)
+{
+  CellLog cells = {NULL, 0, 0};
+  unsigned long long generation;
+  char *endptr;
+
+  // arguments checking.
+  if (argc!=2) {
+    fprintf(stderr, "Usage: %s generation <trajectory | sort >endfile\n", argv[0]);
+    exit(1);
+  }
+
+  // parse generation.
+  generation = strtoull(argv[1], &endptr, 10);
+  if (*endptr != '\0') {
+    fprintf(stderr, "\"%s\" not a valid generation\n", argv[1]);
+    exit(1);
+  }
+
+  replaylife(stdin, generation, &cells);
+
+  writelife(stdout, &cells);
+
+  fprintf(stderr,"%zu cells alive\n", cells.num_cells);
+
+  cell_log_destroy(&cells);
+
+  return 0;
+}
@@ -0,0 +1,471 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "cell_reader.h"
+#include "life.h"
+#include "tile_step.h"
+#include "tile_table.h"
+
+static TileTable *tbl_gen_current;
+static TileTable *tbl_gen_next;
+
+// The tiles of a generation are allocated from the arena that belongs to the generation's table.
+static Arena *arena_gen_current;
+static Arena *arena_gen_next;
+
+// The size of the chunks the arenas allocate from the heap.
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// The kernel used to calculate the next generation of a tile (chosen at runtime, see tile_step.c).
+static tile_step_function *step;
+
+// The directions of the 8 neighbor tiles, and their offsets in tile coordinates.
+enum { NW, N, NE, W, E, SW, S, SE };
+static const long neighbor_dx[8] = { -1,  0,  1, -1, 1, -1, 0, 1 };
+static const long neighbor_dy[8] = { -1, -1, -1,  0, 0,  1, 1, 1 };
+
+// Creates a tile instance (rows not initialized), allocated from an arena.
+static inline Tile *
+create_tile(Arena *arena)
+{
+  Tile *t = (Tile *)arena_alloc(arena, sizeof(Tile));
+  if (t == NULL) {
+    perror("create_tile");
+    exit(1);
+  }
+  return t;
+}
+
+// Returns the tile coordinate for a cell coordinate (rounding towards negative infinity).
+static inline long
+tilecoord(long v)
+{
+  return v >> TILE_BITS;
+}
+
+// Returns a row of a tile, or an empty row if there is no tile.
+static inline uint64_t
+tilerow(const Tile *t, int r)
+{
+  return (t != NULL) ? t->rows[r] : 0;
+}
+
+// Calculates the next generation of a tile (which may be NULL for an empty tile) from its 8 neighbors (NULL if
+// empty); returns true if the calculated tile contains any alive cells.
+static int
+steptile(Tile *out, const Tile *t, Tile **neighbors)
+{
+  // rows -1 .. TILE_SIZE of the tile, as expected by the step kernel
+  uint64_t center[TILE_STEP_ROWS], west[TILE_STEP_ROWS], east[TILE_STEP_ROWS];
+  uint64_t changed = 0, any = 0;
+  int r;
+
+  center[0] = tilerow(neighbors[N], TILE_SIZE - 1);
+  west[0] = tilerow(neighbors[NW], TILE_SIZE - 1) >> (TILE_SIZE - 1);
+  east[0] = tilerow(neighbors[NE], TILE_SIZE - 1) << (TILE_SIZE - 1);
+
+  for (r = 0; r < TILE_SIZE; ++r) {
+    center[r + 1] = tilerow(t, r);
+    west[r + 1] = tilerow(neighbors[W], r) >> (TILE_SIZE - 1);
+    east[r + 1] = tilerow(neighbors[E], r) << (TILE_SIZE - 1);
+  }
+
+  center[TILE_SIZE + 1] = tilerow(neighbors[S], 0);
+  west[TILE_SIZE + 1] = tilerow(neighbors[SW], 0) >> (TILE_SIZE - 1);
+  east[TILE_SIZE + 1] = tilerow(neighbors[SE], 0) << (TILE_SIZE - 1);
+
+  for (r = TILE_SIZE + 2; r < TILE_STEP_ROWS; ++r) {
+    center[r] = west[r] = east[r] = 0;
+  }
+
+  step(out->rows, center, west, east);
+
+  for (r = 0; r < TILE_SIZE; ++r) {
+    changed |= out->rows[r] ^ center[r + 1];
+    any |= out->rows[r];
+  }
+
+  out->changed = (changed != 0);
+  return any != 0;
+}
+
+// Checks if a tile has alive cells at the edge (or corner) facing a neighbor direction.
+static int
+edgealive(const Tile *t, int dir)
+{
+  uint64_t col = 0;
+  int r;
+
+  switch (dir) {
+  case NW: return t->rows[0] & 1;
+  case N:  return t->rows[0] != 0;
+  case NE: return t->rows[0] >> (TILE_SIZE - 1);
+  case SW: return t->rows[TILE_SIZE - 1] & 1;
+  case S:  return t->rows[TILE_SIZE - 1] != 0;
+  case SE: return t->rows[TILE_SIZE - 1] >> (TILE_SIZE - 1);
+  }
+
+  for (r = 0; r < TILE_SIZE; ++r) {
+    col |= t->rows[r];
+  }
+  return (dir == W) ? (col & 1) : (col >> (TILE_SIZE - 1));
+}
+
+// Looks up the 8 neighbors of a tile in the current generation.
+static inline void
+getneighbors(const Point2D *p, Tile **neighbors)
+{
+  Point2D q;
+  int d;
+
+  for (d = 0; d < 8; ++d) {
+    q.x = p->x + neighbor_dx[d];
+    q.y = p->y + neighbor_dy[d];
+    neighbors[d] = tile_table_get(tbl_gen_current, &q);
+  }
+}
+
+// Calculates a tile that is empty in the current generation, but might get births from its neighbors.
+static void
+spawntile(const Point2D *p)
+{
+  Tile *neighbors[8];
+  Tile *t;
+
+  // already calculated for another neighbor
+  if (tile_table_get(tbl_gen_next, p) != NULL) {
+    return;
+  }
+
+  getneighbors(p, neighbors);
+
+  t = create_tile(arena_gen_next);
+  if (steptile(t, NULL, neighbors)) {
+    tile_table_put(tbl_gen_next, p, t);
+  }
+}
+
+// Advanced the game of life by one generation.
+//
+// Tiles that (as well as all of their neighbors) did not change in the last generation are copied; tiles that became
+// empty are kept for one more generation (flagged as changed), so a missing tile is known to be unchanged.
+static void
+onegeneration(void)
+{
+  TileTable *tbl_gen_tmp;
+  Arena *arena_gen_tmp;
+  TileTableIter iter;
+  Tile *neighbors[8];
+  Tile *t, *next;
+  Point2D *p, q;
+  int d, stable, alive;
+
+  tile_table_iter_init(tbl_gen_current, &iter);
+  while (tile_table_iter_has_next(&iter)) {
+    tile_table_iter_next(&iter);
+
+    p = tile_table_iter_get_key(&iter);
+    t = tile_table_iter_get_val(&iter);
+
+    getneighbors(p, neighbors);
+
+    stable = !t->changed;
+    for (d = 0; d < 8 && stable; ++d) {
+      stable = (neighbors[d] == NULL || !neighbors[d]->changed);
+    }
+
+    next = create_tile(arena_gen_next);
+    if (stable) {
+      memcpy(next->rows, t->rows, sizeof(next->rows));
+      next->changed = 0;
+      alive = 1;
+    } else {
+      alive = steptile(next, t, neighbors);
+    }
+
+    if (alive || next->changed) {
+      tile_table_put(tbl_gen_next, p, next);
+    }
+
+    // tiles with inactive edges cannot spawn new neighbor tiles
+    for (d = 0; d < 8; ++d) {
+      if (neighbors[d] == NULL && edgealive(t, d)) {
+        q.x = p->x + neighbor_dx[d];
+        q.y = p->y + neighbor_dy[d];
+        spawntile(&q);
+      }
+    }
+  }
+
+  // use calculated, next generation as current generation
+  tbl_gen_tmp = tbl_gen_current;
+  tbl_gen_current = tbl_gen_next;
+  tbl_gen_next = tbl_gen_tmp;
+
+  arena_gen_tmp = arena_gen_current;
+  arena_gen_current = arena_gen_next;
+  arena_gen_next = arena_gen_tmp;
+
+  // clean next generation tile table; its tiles are released all at once
+  arena_reset(arena_gen_next);
+  tile_table_clear(tbl_gen_next);
+}
+
+// Sets a cell alive in the current generation.
+static void
+setcell(long x, long y)
+{
+  Point2D p;
+  Tile *t;
+
+  p.x = tilecoord(x);
+  p.y = tilecoord(y);
+
+  t = tile_table_get(tbl_gen_current, &p);
+  if (t == NULL) {
+    t = create_tile(arena_gen_current);
+    memset(t, 0, sizeof(Tile));
+    t->changed = 1;
+    tile_table_put(tbl_gen_current, &p, t);
+  }
+
+  t->rows[y & (TILE_SIZE - 1)] |= (uint64_t)1 << (x & (TILE_SIZE - 1));
+}
+
+// Sets a horizontal run of cells alive in the current generation, up to 64 cells (a tile row) at a time
+// (a run_function for cell_reader_decode_rle()).
+static void
+setrun(void *arg, long x, long y, long len)
+{
+  Point2D p;
+  Tile *t;
+  uint64_t mask;
+  long n;
+
+  (void)arg;
+
+  while (len > 0) {
+    p.x = tilecoord(x);
+    p.y = tilecoord(y);
+
+    t = tile_table_get(tbl_gen_current, &p);
+    if (t == NULL) {
+      t = create_tile(arena_gen_current);
+      memset(t, 0, sizeof(Tile));
+      t->changed = 1;
+      tile_table_put(tbl_gen_current, &p, t);
+    }
+
+    n = TILE_SIZE - (x & (TILE_SIZE - 1));
+    if (n > len) {
+      n = len;
+    }
+    mask = n == TILE_SIZE ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+    t->rows[y & (TILE_SIZE - 1)] |= mask << (x & (TILE_SIZE - 1));
+
+    x += n;
+    len -= n;
+  }
+}
+
+// Reads the initial state of the cells from the content of an input file (coordinate pairs, Life 1.06 or RLE);
+// RLE runs are set as whole tile rows.
+static void
+readinput(const char *begin, size_t size)
+{
+  CellList list;
+  size_t body, i;
+
+  if (cell_reader_sniff(begin, size, &body) == INPUT_RLE) {
+    if (!cell_reader_decode_rle(begin + body, size - body, &setrun, NULL)) {
+      fprintf(stderr, "invalid input\n");
+      exit(1);
+    }
+    return;
+  }
+
+  if (!cell_reader_parse_text(&list, begin + body, size - body, NULL)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  for (i = 0; i < list.num_cells; i++) {
+    setcell(list.cells[i].x, list.cells[i].y);
+  }
+  cell_list_free(&list);
+}
+
+// Reads the initial state of the cells from an input file; regular files are mapped into memory, pipes are streamed.
+static void
+readlife(FILE *f)
+{
+  struct stat sb;
+  int fd;
+  char *begin;
+  CellList list;
+  size_t size, i;
+
+  fd = fileno(f);
+
+  // get file size
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    exit(1);
+  }
+
+  // map file into memory
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    begin = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (begin != MAP_FAILED) {
+      readinput(begin, sb.st_size);
+      munmap(begin, sb.st_size);
+      return;
+    }
+  }
+
+  // stream coordinate pairs, other inputs are read entirely
+  if (!cell_reader_parse_stream(&list, fd, NULL, &begin, &size)) {
+    fprintf(stderr, "invalid input\n");
+    exit(1);
+  }
+  if (begin != NULL) {
+    readinput(begin, size);
+    free(begin);
+  } else {
+    for (i = 0; i < list.num_cells; i++) {
+      setcell(list.cells[i].x, list.cells[i].y);
+    }
+    cell_list_free(&list);
+  }
+}
+
+// Writes the cells which are alive in the current generation to an output file.
+static void
+writelife(FILE *f)
+{
+  TileTableIter iter;
+  Point2D *p;
+  Tile *t;
+  uint64_t bits;
+  int r;
+
+  tile_table_iter_init(tbl_gen_current, &iter);
+  while (tile_table_iter_has_next(&iter)) {
+    tile_table_iter_next(&iter);
+    p = tile_table_iter_get_key(&iter);
+    t = tile_table_iter_get_val(&iter);
+    for (r = 0; r < TILE_SIZE; ++r) {
+      for (bits = t->rows[r]; bits != 0; bits &= bits - 1) {
+        fprintf(f, "%ld %ld\n", p->x * TILE_SIZE + __builtin_ctzll(bits), p->y * TILE_SIZE + r);
+      }
+    }
+  }
+}
+
+// Counts how many cells are alive in the current generation.
+static inline size_t
+countcells()
+{
+  TileTableIter iter;
+  Tile *t;
+  size_t n = 0;
+  int r;
+
+  tile_table_iter_init(tbl_gen_current, &iter);
+  while (tile_table_iter_has_next(&iter)) {
+    tile_table_iter_next(&iter);
+    t = tile_table_iter_get_val(&iter);
+    for (r = 0; r < TILE_SIZE; ++r) {
+      n += __builtin_popcountll(t->rows[r]);
+    }
+  }
+  return n;
+}
+
+// Prints the usage and exits.
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-k scalar|sse2|avx2] #generations <startfile | sort >endfile\n", prog);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  long generations;
+  long i;
+  char *endptr;
+  int opt;
+
+  // use the fastest kernel the CPU supports, unless told otherwise.
+  step = tile_step_best();
+
+  // parse options.
+  while ((opt = getopt(argc, argv, "k:")) != -1) {
+    switch (opt) {
+    case 'k':
+      step = tile_step_by_name(optarg);
+      if (step == NULL) {
+        fprintf(stderr, "kernel \"%s\" unknown or not supported by this CPU\n", optarg);
+        exit(1);
+      }
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  // arguments checking.
+  if (optind != argc-1) {
+    usage(argv[0]);
+  }
+
+  // parse nr of generations.
+  generations = strtol(argv[optind], &endptr, 10);
+  if (*endptr != '\0') {
+    fprintf(stderr, "\"%s\" not a valid generation count\n", argv[optind]);
+    exit(1);
+  }
+
+  // create tile tables.
+  tbl_gen_current = tile_table_create(1024, 0.75f);
+  tbl_gen_next    = tile_table_create(1024, 0.75f);
+
+  // create arenas for the tiles.
+  arena_gen_current = arena_create(ARENA_CHUNK_SIZE);
+  arena_gen_next    = arena_create(ARENA_CHUNK_SIZE);
+  if (arena_gen_current == NULL || arena_gen_next == NULL) {
+    perror("arena_create");
+    exit(1);
+  }
+
+  // read in initial generation.
+  readlife(stdin);
+
+  // advance generations.
+  for (i=0; i<generations; i++) {
+    onegeneration();
+  }
+
+  writelife(stdout);
+
+  fprintf(stderr,"%zu cells alive\n", countcells());
+
+  // destroy tile tables.
+  tile_table_destroy(tbl_gen_current);
+  tile_table_destroy(tbl_gen_next);
+
+  // free memory allocated for tiles.
+  arena_destroy(arena_gen_current);
+  arena_destroy(arena_gen_next);
+
+  return 0;
+}
@@ -1,9 +1,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <functional>
 #include <iostream>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 /**
  * Enum for the cell status.
@@ -73,6 +79,82 @@ public:
     }
 };
 
+/**
+ * The maximum length of the text representation of a single cell ("x y\n").
+ */
+#define CELL_FORMAT_MAX 48
+
+/**
+ * The size of the buffer the cells are formatted into before they are written.
+ */
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+/**
+ * Generations with at least this many cells are formatted by all threads, each into its own chunk.
+ */
+#define WRITE_PARALLEL_THRESHOLD (1 << 16)
+
+/**
+ * The ASCII representations of the numbers 00 to 99.
+ */
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * Writes the decimal representation of an integer, two digits at a time.
+ * @param p the output position.
+ * @param v the integer.
+ * @return the position after the written characters.
+ */
+static inline char *format_long(char *p, long v)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp), *q = end;
+    unsigned long u = v < 0 ? -(unsigned long)v : (unsigned long)v;
+
+    while (u >= 100) {
+        q -= 2;
+        memcpy(q, &digit_pairs[2 * (u % 100)], 2);
+        u /= 100;
+    }
+    if (u >= 10) {
+        q -= 2;
+        memcpy(q, &digit_pairs[2 * u], 2);
+    } else {
+        *--q = '0' + u;
+    }
+
+    *p = '-';
+    p += v < 0;
+    memcpy(p, q, end - q);
+    return p + (end - q);
+}
+
+/**
+ * Writes the text representation of a cell ("x y\n").
+ * @param p the output position (with room for CELL_FORMAT_MAX characters).
+ * @param x the X coordinate.
+ * @param y the Y coordinate.
+ * @return the position after the written characters.
+ */
+static inline char *format_cell(char *p, long x, long y)
+{
+    p = format_long(p, x);
+    *p++ = ' ';
+    p = format_long(p, y);
+    *p++ = '\n';
+    return p;
+}
+
 /**
  * A class representing a cell.
  */
@@ -121,11 +203,28 @@ public:
      */
     std::unordered_map <Point2D, Cell*, Point2DHash> gen_next;
 
-    Life() {
+    /**
+     * Maps used by the threads to generate the next generation (empty when running single-threaded).
+     */
+    std::vector<std::unordered_map <Point2D, Cell*, Point2DHash> > gen_threads;
+
+    /**
+     * Constructor.
+     * @param num_threads the number of threads used to advance a generation.
+     */
+    Life(size_t num_threads = 1) {
         gen_current.rehash(1024);
         gen_current.max_load_factor(0.75f);
         gen_next.rehash(1024);
         gen_next.max_load_factor(0.75f);
+
+        if (num_threads > 1) {
+            gen_threads.resize(num_threads);
+            for (size_t i = 0; i < num_threads; ++i) {
+                gen_threads[i].rehash(1024);
+                gen_threads[i].max_load_factor(0.75f);
+            }
+        }
     }
 
     /**
@@ -153,10 +252,33 @@ public:
      * @param outStream the output stream.
      */
     void writelife(std::ostream& out) {
+        if (gen_threads.size() > 1 && gen_current.size() >= WRITE_PARALLEL_THRESHOLD) {
+            std::vector<std::string> chunks(gen_threads.size());
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < gen_threads.size(); ++i) {
+                threads.push_back(std::thread(&Life::formatcells, this, i, std::ref(chunks[i])));
+            }
+            formatcells(0, chunks[0]);
+            for (size_t i = 0; i < threads.size(); ++i) {
+                threads[i].join();
+            }
+            for (size_t i = 0; i < chunks.size(); ++i) {
+                out.write(chunks[i].data(), chunks[i].size());
+            }
+            return;
+        }
+
+        std::vector<char> buf(WRITE_BUFFER_SIZE);
+        char *p = &buf[0];
         std::unordered_map<Point2D, Cell*, Point2DHash>::iterator iter;
         for (iter = gen_current.begin(); iter != gen_current.end(); ++iter) {
-            out << iter->first.x << " " << iter->first.y << "\n";
+            if (&buf[0] + buf.size() - p < CELL_FORMAT_MAX) {
+                out.write(&buf[0], p - &buf[0]);
+                p = &buf[0];
+            }
+            p = format_cell(p, iter->first.x, iter->first.y);
         }
+        out.write(&buf[0], p - &buf[0]);
     }
 
     /**
@@ -173,17 +295,39 @@ public:
      */
     void onegeneration() {
         std::unordered_map<Point2D, Cell*, Point2DHash>::iterator iter;
-        for (iter = gen_current.begin(); iter != gen_current.end(); ++iter) {
-            const Point2D &p = iter->first;
-            checkcell(p.x-1, p.y-1);
-            checkcell(p.x-1, p.y+0);
-            checkcell(p.x-1, p.y+1);
-            checkcell(p.x+0, p.y-1);
-            checkcell(p.x+0, p.y+0);
-            checkcell(p.x+0, p.y+1);
-            checkcell(p.x+1, p.y-1);
-            checkcell(p.x+1, p.y+0);
-            checkcell(p.x+1, p.y+1);
+
+        if (gen_threads.empty()) {
+            for (iter = gen_current.begin(); iter != gen_current.end(); ++iter) {
+                const Point2D &p = iter->first;
+                checkcell(p.x-1, p.y-1, gen_next);
+                checkcell(p.x-1, p.y+0, gen_next);
+                checkcell(p.x-1, p.y+1, gen_next);
+                checkcell(p.x+0, p.y-1, gen_next);
+                checkcell(p.x+0, p.y+0, gen_next);
+                checkcell(p.x+0, p.y+1, gen_next);
+                checkcell(p.x+1, p.y-1, gen_next);
+                checkcell(p.x+1, p.y+0, gen_next);
+                checkcell(p.x+1, p.y+1, gen_next);
+            }
+        } else {
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < gen_threads.size(); ++i) {
+                threads.push_back(std::thread(&Life::checkcells, this, i));
+            }
+            checkcells(0);
+            for (size_t i = 0; i < threads.size(); ++i) {
+                threads[i].join();
+            }
+
+            // merge the per-thread maps; a cell may have been found by more than one thread
+            for (size_t i = 0; i < gen_threads.size(); ++i) {
+                for (iter = gen_threads[i].begin(); iter != gen_threads[i].end(); ++iter) {
+                    if (!gen_next.insert(*iter).second) {
+                        delete iter->second;
+                    }
+                }
+                gen_threads[i].clear();
+            }
         }
 
         gen_current.swap(gen_next);
@@ -207,11 +351,68 @@ private:
     }
 
     /**
-     * Checks if a cell is alive in the next generation, and if so put the cell into the next generation map.
+     * Returns the range of buckets of the current generation map that belongs to one part (thread).
+     * @param part the index of the part.
+     * @param begin an output parameter for the first bucket (inclusive).
+     * @param end an output parameter for the last bucket (exclusive).
+     */
+    void bucket_range(size_t part, size_t &begin, size_t &end) {
+        size_t num_buckets = gen_current.bucket_count();
+        begin = num_buckets / gen_threads.size() * part;
+        end = part + 1 == gen_threads.size() ? num_buckets : num_buckets / gen_threads.size() * (part + 1);
+    }
+
+    /**
+     * Formats the cells in one part of the current generation map's buckets (run by a thread).
+     * @param part the index of the part.
+     * @param chunk the string receiving the formatted cells.
+     */
+    void formatcells(size_t part, std::string &chunk) {
+        char tmp[CELL_FORMAT_MAX];
+        size_t begin, end;
+
+        bucket_range(part, begin, end);
+        for (size_t bucket = begin; bucket < end; ++bucket) {
+            std::unordered_map<Point2D, Cell*, Point2DHash>::const_local_iterator iter;
+            for (iter = gen_current.cbegin(bucket); iter != gen_current.cend(bucket); ++iter) {
+                chunk.append(tmp, format_cell(tmp, iter->first.x, iter->first.y) - tmp);
+            }
+        }
+    }
+
+    /**
+     * Checks the cells around the alive cells in one part of the current generation map's buckets (run by a thread).
+     * @param part the index of the part (and of the thread's map in gen_threads).
+     */
+    void checkcells(size_t part) {
+        std::unordered_map<Point2D, Cell*, Point2DHash> &out = gen_threads[part];
+        size_t begin, end;
+
+        bucket_range(part, begin, end);
+        for (size_t bucket = begin; bucket < end; ++bucket) {
+            std::unordered_map<Point2D, Cell*, Point2DHash>::const_local_iterator iter;
+            for (iter = gen_current.cbegin(bucket); iter != gen_current.cend(bucket); ++iter) {
+                const Point2D &p = iter->first;
+                checkcell(p.x-1, p.y-1, out);
+                checkcell(p.x-1, p.y+0, out);
+                checkcell(p.x-1, p.y+1, out);
+                checkcell(p.x+0, p.y-1, out);
+                checkcell(p.x+0, p.y+0, out);
+                checkcell(p.x+0, p.y+1, out);
+                checkcell(p.x+1, p.y-1, out);
+                checkcell(p.x+1, p.y+0, out);
+                checkcell(p.x+1, p.y+1, out);
+            }
+        }
+    }
+
+    /**
+     * Checks if a cell is alive in the next generation, and if so put the cell into the given map.
      * @param x the X coordinate of the cell.
      * @param y the Y coordinate of the cell.
+     * @param out the map receiving the cell.
      */
-     void checkcell(long x, long y) {
+     void checkcell(long x, long y, std::unordered_map<Point2D, Cell*, Point2DHash> &out) {
         int n = 0;
 
         n += alive(x-1, y-1);
@@ -226,28 +427,47 @@ private:
         if (n == 3 || (n == 2 && alive(x, y) == 1)) {
             Point2D p(x, y);
             Cell *c = new Cell(p, ALIVE);
-            gen_next[c->coordinates] = c;
+            out[c->coordinates] = c;
         }
     }
 };
 
 int main(int argc, char **argv)
 {
+    char *endptr;
+    long num_threads = 1;
+    int opt;
+
+    // parse options.
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        switch (opt) {
+        case 'j':
+            num_threads = strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' || num_threads < 1) {
+                fprintf(stderr, "\"%s\" not a valid thread count\n", optarg);
+                exit(1);
+            }
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-j threads] #generations <startfile | sort >endfile\n", argv[0]);
+            exit(1);
+        }
+    }
+
     // arguments checking.
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s #generations <startfile | sort >endfile\n", argv[0]);
+    if (optind != argc-1) {
+        fprintf(stderr, "Usage: %s [-j threads] #generations <startfile | sort >endfile\n", argv[0]);
         exit(1);
     }
 
     // parse nr of generations.
-    char *endptr;
-    long generations = strtol(argv[1], &endptr, 10);
+    long generations = strtol(argv[optind], &endptr, 10);
     if (*endptr != '\0') {
-        fprintf(stderr, "\"%s\" not a valid generation count\n", argv[3]);
+        fprintf(stderr, "\"%s\" not a valid generation count\n", argv[optind]);
         exit(1);
     }
 
-    Life *life = new Life();
+    Life *life = new Life(num_threads);
 
     // read in initial generation.
     life->readlife(std::cin);
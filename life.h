@@ -12,6 +12,7 @@ typedef struct point2d {
 typedef struct cell {
     Point2D coordinates;
     Status status;
+    int neighbors; // no. of alive neighbors, used when counting neighbors
 } Cell;
 
 #endif
@@ -0,0 +1,161 @@
+
+#include "radix_sort.h"
+
+#include <string.h>
+
+/**
+ * The number of bits sorted by a single pass.
+ */
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+
+/**
+ * Arrays smaller than this are sorted by a single thread.
+ */
+#define RADIX_PARALLEL_THRESHOLD (1 << 16)
+
+/**
+ * a type representing a single pass (shared by all threads).
+ */
+typedef struct radix_pass {
+
+    /**
+     * The keys to distribute and their destination.
+     */
+    const uint64_t *src;
+    uint64_t *dst;
+
+    /**
+     * The number of keys.
+     */
+    size_t num_keys;
+
+    /**
+     * The position of the digit sorted by the pass.
+     */
+    unsigned int shift;
+
+    /**
+     * Per thread: the number of keys per digit, then the destination index of the next key per digit.
+     */
+    size_t (*counts)[RADIX_SIZE];
+
+} RadixPass;
+
+/**
+ * Returns the range of keys a thread works on.
+ * @param num_keys the number of keys.
+ * @param thread_idx the index of the thread.
+ * @param num_threads the number of threads.
+ * @param begin an output parameter for the first index (inclusive).
+ * @param end an output parameter for the last index (exclusive).
+ */
+static inline void
+part(size_t num_keys, size_t thread_idx, size_t num_threads, size_t *begin, size_t *end)
+{
+    *begin = num_keys / num_threads * thread_idx;
+    *end = thread_idx + 1 == num_threads ? num_keys : num_keys / num_threads * (thread_idx + 1);
+}
+
+/**
+ * Counts the digits of a thread's range of keys.
+ */
+static void
+count_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+    RadixPass *pass = (RadixPass *)arg;
+    size_t *counts = pass->counts[thread_idx];
+    size_t i, begin, end;
+
+    memset(counts, 0, RADIX_SIZE * sizeof(size_t));
+
+    part(pass->num_keys, thread_idx, num_threads, &begin, &end);
+    for (i = begin; i < end; ++i) {
+        counts[(pass->src[i] >> pass->shift) & RADIX_MASK]++;
+    }
+}
+
+/**
+ * Moves a thread's range of keys to their destination.
+ */
+static void
+scatter_part(void *arg, size_t thread_idx, size_t num_threads)
+{
+    RadixPass *pass = (RadixPass *)arg;
+    size_t *offsets = pass->counts[thread_idx];
+    size_t i, begin, end;
+
+    part(pass->num_keys, thread_idx, num_threads, &begin, &end);
+    for (i = begin; i < end; ++i) {
+        pass->dst[offsets[(pass->src[i] >> pass->shift) & RADIX_MASK]++] = pass->src[i];
+    }
+}
+
+int
+radix_sort(uint64_t *keys, size_t num_keys, ThreadPool *pool)
+{
+    RadixPass pass;
+    uint64_t *tmp, *swap;
+    size_t num_threads, offset, count, total, digit, t;
+    int skip;
+
+    num_threads = pool != NULL && num_keys >= RADIX_PARALLEL_THRESHOLD ? thread_pool_size(pool) : 1;
+
+    tmp = malloc(num_keys * sizeof(uint64_t) + 1);
+    pass.counts = malloc(num_threads * sizeof(*pass.counts));
+    if (tmp == NULL || pass.counts == NULL) {
+        free(tmp);
+        free(pass.counts);
+        return 0;
+    }
+
+    pass.src = keys;
+    pass.dst = tmp;
+    pass.num_keys = num_keys;
+
+    for (pass.shift = 0; pass.shift < 64; pass.shift += RADIX_BITS) {
+        if (num_threads > 1) {
+            thread_pool_run(pool, &count_part, &pass);
+        } else {
+            count_part(&pass, 0, 1);
+        }
+
+        // turn the counts into destination indices (digit by digit, thread by thread);
+        // a pass is skipped when all keys share the same digit
+        offset = 0;
+        skip = 0;
+        for (digit = 0; digit < RADIX_SIZE; ++digit) {
+            total = 0;
+            for (t = 0; t < num_threads; ++t) {
+                count = pass.counts[t][digit];
+                pass.counts[t][digit] = offset;
+                offset += count;
+                total += count;
+            }
+            skip |= total == num_keys;
+        }
+        if (skip) {
+            continue;
+        }
+
+        if (num_threads > 1) {
+            thread_pool_run(pool, &scatter_part, &pass);
+        } else {
+            scatter_part(&pass, 0, 1);
+        }
+
+        swap = pass.dst;
+        pass.dst = (uint64_t *)pass.src;
+        pass.src = swap;
+    }
+
+    if (pass.src != keys) {
+        memcpy(keys, pass.src, num_keys * sizeof(uint64_t));
+    }
+
+    free(tmp);
+    free(pass.counts);
+
+    return 1;
+}
@@ -0,0 +1,60 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+/**
+ * LSD radix sort of cell coordinates packed into 64-bit keys.
+ *
+ * The sign bits of both coordinates are flipped when packing, so sorting the keys as unsigned integers orders the
+ * cells numerically by x, then y.
+ */
+
+/**
+ * Packs cell coordinates into a sort key (the coordinates must be in the range of a 32-bit integer).
+ * @param x the X coordinate.
+ * @param y the Y coordinate.
+ * @return the sort key.
+ */
+static inline uint64_t
+radix_sort_pack(long x, long y)
+{
+    return ((uint64_t)((uint32_t)x ^ 0x80000000u) << 32) | ((uint32_t)y ^ 0x80000000u);
+}
+
+/**
+ * Returns the X coordinate of a sort key.
+ * @param key the sort key.
+ * @return the X coordinate.
+ */
+static inline long
+radix_sort_x(uint64_t key)
+{
+    return (int32_t)((uint32_t)(key >> 32) ^ 0x80000000u);
+}
+
+/**
+ * Returns the Y coordinate of a sort key.
+ * @param key the sort key.
+ * @return the Y coordinate.
+ */
+static inline long
+radix_sort_y(uint64_t key)
+{
+    return (int32_t)((uint32_t)key ^ 0x80000000u);
+}
+
+/**
+ * Sorts keys in ascending order.
+ * @param keys the keys to sort.
+ * @param num_keys the number of keys.
+ * @param pool a thread pool used to sort large arrays in parallel, or NULL.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+radix_sort(uint64_t *keys, size_t num_keys, ThreadPool *pool);
+
+#endif
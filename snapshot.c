@@ -0,0 +1,116 @@
+
+#include "snapshot.h"
+
+#include <string.h>
+
+#include "radix_sort.h"
+
+int
+snapshot_parse(Snapshot *snap, const void *data, size_t size)
+{
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+    size_t remaining;
+
+    if (size < sizeof(SnapshotHeader) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        return 0;
+    }
+
+    if (header->version != SNAPSHOT_VERSION || header->cell_size != sizeof(SnapshotCell)) {
+        return 0;
+    }
+
+    // the sections must fit into the region
+    remaining = size - sizeof(SnapshotHeader);
+    if (header->num_cells > remaining / sizeof(SnapshotCell)) {
+        return 0;
+    }
+    remaining -= header->num_cells * sizeof(SnapshotCell);
+    if (header->num_buckets > 0
+        && (header->bucket_size == 0 || header->num_buckets > remaining / header->bucket_size)) {
+        return 0;
+    }
+
+    snap->header = header;
+    snap->cells = (const SnapshotCell *)(header + 1);
+    snap->buckets = header->num_buckets > 0 ? (const void *)(snap->cells + header->num_cells) : NULL;
+
+    return 1;
+}
+
+/**
+ * Mixes the bits of a 64-bit value (the finalizer of splitmix64).
+ * @param v the value.
+ * @return the mixed value.
+ */
+static uint64_t
+mix64(uint64_t v)
+{
+    v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    v = (v ^ (v >> 27)) * 0x94d049bb133111ebULL;
+    return v ^ (v >> 31);
+}
+
+uint64_t
+snapshot_origin(uint64_t generation, const SnapshotCell *cells, size_t num_cells)
+{
+    uint64_t sum = 0;
+    size_t i;
+
+    // summing the mixed cells makes the identity independent of their order
+    for (i = 0; i < num_cells; ++i) {
+        sum += mix64(radix_sort_pack(cells[i].x, cells[i].y));
+    }
+
+    sum = mix64(sum ^ mix64(generation) ^ num_cells);
+    return sum != 0 ? sum : 1;
+}
+
+int
+snapshot_write(FILE *f, uint64_t generation, uint64_t origin, SnapshotCell *cells, size_t num_cells,
+               const void *buckets, size_t num_buckets, size_t bucket_size)
+{
+    SnapshotHeader header;
+    uint64_t *keys;
+    size_t i;
+
+    // sort by x, then y
+    keys = malloc(num_cells * sizeof(uint64_t) + 1);
+    if (keys == NULL) {
+        return 0;
+    }
+    for (i = 0; i < num_cells; ++i) {
+        keys[i] = radix_sort_pack(cells[i].x, cells[i].y);
+    }
+    if (!radix_sort(keys, num_cells, NULL)) {
+        free(keys);
+        return 0;
+    }
+    for (i = 0; i < num_cells; ++i) {
+        cells[i].x = radix_sort_x(keys[i]);
+        cells[i].y = radix_sort_y(keys[i]);
+    }
+    free(keys);
+
+    memset(&header, 0, sizeof(SnapshotHeader));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.cell_size = sizeof(SnapshotCell);
+    header.generation = generation;
+    header.origin = origin;
+    header.num_cells = num_cells;
+    if (buckets != NULL) {
+        header.num_buckets = num_buckets;
+        header.bucket_size = bucket_size;
+    }
+
+    if (fwrite(&header, sizeof(SnapshotHeader), 1, f) != 1
+        || fwrite(cells, sizeof(SnapshotCell), num_cells, f) != num_cells) {
+        return 0;
+    }
+
+    if (buckets != NULL && fwrite(buckets, bucket_size, num_buckets, f) != num_buckets) {
+        return 0;
+    }
+
+    return 1;
+}
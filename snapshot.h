@@ -0,0 +1,158 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * A binary snapshot of a generation, meant to be mapped into memory and used as is:
+ *
+ *   header | cells (num_cells x SnapshotCell, sorted by x, then y) | buckets (num_buckets x bucket_size, optional)
+ *
+ * All values are stored in native byte order. The optional bucket array is the raw bucket array of the engine's
+ * table; it can only be used by an engine built with the same bucket layout (see bucket_size), any other reader
+ * rebuilds its table from the cells.
+ */
+
+/**
+ * The magic bytes a snapshot starts with.
+ */
+#define SNAPSHOT_MAGIC "LIFESNAP"
+
+/**
+ * The current version of the snapshot format.
+ */
+#define SNAPSHOT_VERSION 2
+
+/**
+ * a type representing the snapshot header.
+ */
+typedef struct snapshot_header {
+
+    /**
+     * The magic bytes (SNAPSHOT_MAGIC without the terminating null byte).
+     */
+    char magic[8];
+
+    /**
+     * The version of the snapshot format.
+     */
+    uint32_t version;
+
+    /**
+     * The size of a cell (sizeof(SnapshotCell)).
+     */
+    uint32_t cell_size;
+
+    /**
+     * The number of the generation the snapshot was taken of.
+     */
+    uint64_t generation;
+
+    /**
+     * The number of cells.
+     */
+    uint64_t num_cells;
+
+    /**
+     * The number of buckets (0 if the snapshot has no bucket array).
+     */
+    uint64_t num_buckets;
+
+    /**
+     * The size of a bucket (0 if the snapshot has no bucket array).
+     */
+    uint32_t bucket_size;
+
+    /**
+     * unused member for memory alignment purposes.
+     */
+    uint32_t padding;
+
+    /**
+     * The identity of the input the snapshot descends from (see snapshot_origin), or 0 if unknown.
+     */
+    uint64_t origin;
+
+} SnapshotHeader;
+
+/**
+ * a type representing the packed coordinates of an alive cell.
+ */
+typedef struct snapshot_cell {
+    int32_t x;
+    int32_t y;
+} SnapshotCell;
+
+/**
+ * a type representing a snapshot in memory.
+ */
+typedef struct snapshot {
+
+    /**
+     * The snapshot header.
+     */
+    const SnapshotHeader *header;
+
+    /**
+     * The cells, sorted by x, then y.
+     */
+    const SnapshotCell *cells;
+
+    /**
+     * The raw bucket array, or NULL if the snapshot has none.
+     */
+    const void *buckets;
+
+} Snapshot;
+
+/**
+ * Checks whether a memory region holds a valid snapshot and sets up a snapshot instance pointing into it.
+ * @param snap a pointer to an allocated snapshot instance.
+ * @param data the memory region (e.g. a mapped file).
+ * @param size the size of the memory region.
+ * @return true if the region holds a valid snapshot, false otherwise.
+ */
+int
+snapshot_parse(Snapshot *snap, const void *data, size_t size);
+
+/**
+ * Writes a snapshot.
+ * @param f the output file.
+ * @param generation the number of the generation.
+ * @param origin the identity of the input the generation descends from, or 0.
+ * @param cells the cells; they are sorted in place.
+ * @param num_cells the number of cells.
+ * @param buckets the raw bucket array to include, or NULL.
+ * @param num_buckets the number of buckets.
+ * @param bucket_size the size of a bucket.
+ * @return true if the snapshot was written successfully, false otherwise.
+ */
+int
+snapshot_write(FILE *f, uint64_t generation, uint64_t origin, SnapshotCell *cells, size_t num_cells,
+               const void *buckets, size_t num_buckets, size_t bucket_size);
+
+/**
+ * Computes the identity of an initial generation, which does not depend on the order of the cells.
+ * @param generation the number of the generation.
+ * @param cells the cells.
+ * @param num_cells the number of cells.
+ * @return the identity (never 0).
+ */
+uint64_t
+snapshot_origin(uint64_t generation, const SnapshotCell *cells, size_t num_cells);
+
+/**
+ * Checks whether coordinates fit into a snapshot cell.
+ * @param x the X coordinate.
+ * @param y the Y coordinate.
+ * @return true if the coordinates can be packed, false otherwise.
+ */
+static inline int
+snapshot_fits(long x, long y)
+{
+    return x >= INT32_MIN && x <= INT32_MAX && y >= INT32_MIN && y <= INT32_MAX;
+}
+
+#endif
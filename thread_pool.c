@@ -0,0 +1,157 @@
+
+#include "thread_pool.h"
+
+/**
+ * a type representing the start argument of a worker thread.
+ */
+typedef struct worker_arg {
+    ThreadPool *pool;
+    size_t thread_idx;
+} WorkerArg;
+
+/**
+ * The main loop of a worker thread.
+ * @param data the worker's start argument (allocated on the heap, freed by the worker).
+ * @return always NULL.
+ */
+static void *
+worker_main(void *data)
+{
+    WorkerArg *worker_arg = (WorkerArg *)data;
+    ThreadPool *pool = worker_arg->pool;
+    size_t thread_idx = worker_arg->thread_idx;
+    unsigned long last_task_no = 0;
+    task_function *task;
+    void *arg;
+
+    free(worker_arg);
+
+    for (;;) {
+        // wait for a new task
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->task_no == last_task_no) {
+            pthread_cond_wait(&pool->task_cond, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        last_task_no = pool->task_no;
+        task = pool->task;
+        arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(arg, thread_idx, pool->num_threads);
+
+        // report completion
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->num_busy == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+ThreadPool *
+thread_pool_create(size_t num_threads)
+{
+    ThreadPool *pool;
+    WorkerArg *worker_arg;
+    size_t i;
+
+    if (num_threads == 0) {
+        return NULL;
+    }
+
+    pool = malloc(sizeof(ThreadPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->workers = malloc(num_threads * sizeof(pthread_t));
+    if (pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->num_threads = num_threads;
+    pool->task = NULL;
+    pool->arg = NULL;
+    pool->task_no = 0;
+    pool->num_busy = 0;
+    pool->shutdown = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->task_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    // thread 0 is the one calling thread_pool_run()
+    for (i = 1; i < num_threads; ++i) {
+        worker_arg = malloc(sizeof(WorkerArg));
+        if (worker_arg == NULL) {
+            pool->num_threads = i;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+        worker_arg->pool = pool;
+        worker_arg->thread_idx = i;
+        if (pthread_create(&pool->workers[i], NULL, &worker_main, worker_arg) != 0) {
+            free(worker_arg);
+            pool->num_threads = i;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void
+thread_pool_run(ThreadPool *pool, task_function *task, void *arg)
+{
+    if (pool->num_threads > 1) {
+        pthread_mutex_lock(&pool->lock);
+        pool->task = task;
+        pool->arg = arg;
+        pool->num_busy = pool->num_threads - 1;
+        pool->task_no++;
+        pthread_cond_broadcast(&pool->task_cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    task(arg, 0, pool->num_threads);
+
+    if (pool->num_threads > 1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->num_busy > 0) {
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+size_t
+thread_pool_size(ThreadPool *pool)
+{
+    return pool->num_threads;
+}
+
+void
+thread_pool_destroy(ThreadPool *pool)
+{
+    size_t i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->task_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 1; i < pool->num_threads; ++i) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->task_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->workers);
+    free(pool);
+}
@@ -0,0 +1,104 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * A minimal pool of worker threads that run the same task in parallel (fork / join).
+ */
+
+/**
+ * Define signature for tasks.
+ * @param arg the argument passed to thread_pool_run().
+ * @param thread_idx the index of the executing thread (0 .. num_threads - 1).
+ * @param num_threads the total number of threads executing the task.
+ */
+typedef void task_function(void *arg, size_t thread_idx, size_t num_threads);
+
+/**
+ * a type representing a thread pool.
+ */
+typedef struct thread_pool {
+
+    /**
+     * the number of threads (the thread calling thread_pool_run() included).
+     */
+    size_t num_threads;
+
+    /**
+     * the worker threads (num_threads - 1).
+     */
+    pthread_t *workers;
+
+    /**
+     * protects all members below.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * signaled when a new task is available (or the pool shuts down).
+     */
+    pthread_cond_t task_cond;
+
+    /**
+     * signaled when the last worker finished the current task.
+     */
+    pthread_cond_t done_cond;
+
+    /**
+     * the current task and its argument.
+     */
+    task_function *task;
+    void *arg;
+
+    /**
+     * incremented for every task, so workers can tell a new task from a spurious wakeup.
+     */
+    unsigned long task_no;
+
+    /**
+     * the number of workers still executing the current task.
+     */
+    size_t num_busy;
+
+    /**
+     * a flag telling the workers to exit.
+     */
+    int shutdown;
+
+} ThreadPool;
+
+/**
+ * Creates a thread pool.
+ * @param num_threads the total number of threads executing a task (the calling thread included).
+ * @return a pointer to the thread pool created on the heap, or NULL on failure.
+ */
+ThreadPool *
+thread_pool_create(size_t num_threads);
+
+/**
+ * Runs a task on all threads of the pool (the calling thread being thread 0) and waits until all of them finished.
+ * @param pool the thread pool.
+ * @param task the task to run.
+ * @param arg the argument passed to the task.
+ */
+void
+thread_pool_run(ThreadPool *pool, task_function *task, void *arg);
+
+/**
+ * Returns the number of threads executing a task.
+ * @param pool the thread pool.
+ * @return the number of threads.
+ */
+size_t
+thread_pool_size(ThreadPool *pool);
+
+/**
+ * Stops all worker threads and frees all resources.
+ * @param pool the thread pool.
+ */
+void
+thread_pool_destroy(ThreadPool *pool);
+
+#endif
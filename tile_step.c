@@ -0,0 +1,186 @@
+
+#include "tile_step.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TILE_STEP_X86
+#endif
+
+/**
+ * Adds three bit vectors bitwise.
+ * @param a the first bit vector.
+ * @param b the second bit vector.
+ * @param c the third bit vector.
+ * @param sum an output parameter for the bits of weight 1.
+ * @param carry an output parameter for the bits of weight 2.
+ */
+static inline void
+add3(uint64_t a, uint64_t b, uint64_t c, uint64_t *sum, uint64_t *carry)
+{
+    uint64_t t = a ^ b;
+    *sum = t ^ c;
+    *carry = (a & b) | (t & c);
+}
+
+/**
+ * Portable step kernel, one row (64 cells) at a time.
+ * @see tile_step_function
+ */
+static void
+step_scalar(uint64_t *out, const uint64_t *center, const uint64_t *west, const uint64_t *east)
+{
+    // sum / carry of each cell with its west and east neighbor
+    uint64_t sum[TILE_SIZE + 2], carry[TILE_SIZE + 2];
+    uint64_t ones, twos, fours, p, q;
+    int r;
+
+    for (r = 0; r < TILE_SIZE + 2; ++r) {
+        add3((center[r] << 1) | west[r], center[r], (center[r] >> 1) | east[r], &sum[r], &carry[r]);
+    }
+
+    for (r = 0; r < TILE_SIZE; ++r) {
+        // the 3x3 block sum (cell included) is ones + 2 * twos + 4 * fours (mod 8)
+        add3(sum[r], sum[r + 1], sum[r + 2], &ones, &twos);
+        add3(carry[r], carry[r + 1], carry[r + 2], &p, &q);
+        fours = q ^ (p & twos);
+        twos ^= p;
+
+        // alive if the block sum is 3, or 4 and the cell itself is alive
+        out[r] = (ones & twos & ~fours) | (~ones & ~twos & fours & center[r + 1]);
+    }
+}
+
+#ifdef TILE_STEP_X86
+
+/**
+ * SSE2 step kernel, two rows (128 cells) at a time.
+ * @see tile_step_function
+ */
+__attribute__((target("sse2")))
+static void
+step_sse2(uint64_t *out, const uint64_t *center, const uint64_t *west, const uint64_t *east)
+{
+    uint64_t sum[TILE_STEP_ROWS], carry[TILE_STEP_ROWS];
+    __m128i c, a, b, t, s, k, s0, s1, s2, k0, k1, k2, ones, twos, fours, p, q, next;
+    int r;
+
+    for (r = 0; r < TILE_SIZE + 2; r += 2) {
+        c = _mm_loadu_si128((const __m128i *)&center[r]);
+        a = _mm_or_si128(_mm_slli_epi64(c, 1), _mm_loadu_si128((const __m128i *)&west[r]));
+        b = _mm_or_si128(_mm_srli_epi64(c, 1), _mm_loadu_si128((const __m128i *)&east[r]));
+        t = _mm_xor_si128(a, b);
+        s = _mm_xor_si128(t, c);
+        k = _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(t, c));
+        _mm_storeu_si128((__m128i *)&sum[r], s);
+        _mm_storeu_si128((__m128i *)&carry[r], k);
+    }
+
+    for (r = 0; r < TILE_SIZE; r += 2) {
+        s0 = _mm_loadu_si128((const __m128i *)&sum[r]);
+        s1 = _mm_loadu_si128((const __m128i *)&sum[r + 1]);
+        s2 = _mm_loadu_si128((const __m128i *)&sum[r + 2]);
+        k0 = _mm_loadu_si128((const __m128i *)&carry[r]);
+        k1 = _mm_loadu_si128((const __m128i *)&carry[r + 1]);
+        k2 = _mm_loadu_si128((const __m128i *)&carry[r + 2]);
+        c = _mm_loadu_si128((const __m128i *)&center[r + 1]);
+
+        t = _mm_xor_si128(s0, s1);
+        ones = _mm_xor_si128(t, s2);
+        twos = _mm_or_si128(_mm_and_si128(s0, s1), _mm_and_si128(t, s2));
+        t = _mm_xor_si128(k0, k1);
+        p = _mm_xor_si128(t, k2);
+        q = _mm_or_si128(_mm_and_si128(k0, k1), _mm_and_si128(t, k2));
+        fours = _mm_xor_si128(q, _mm_and_si128(p, twos));
+        twos = _mm_xor_si128(twos, p);
+
+        // (ones & twos & ~fours) | (~(ones | twos) & fours & c)
+        next = _mm_or_si128(_mm_andnot_si128(fours, _mm_and_si128(ones, twos)),
+                            _mm_andnot_si128(_mm_or_si128(ones, twos), _mm_and_si128(fours, c)));
+        _mm_storeu_si128((__m128i *)&out[r], next);
+    }
+}
+
+/**
+ * AVX2 step kernel, four rows (256 cells) at a time.
+ * @see tile_step_function
+ */
+__attribute__((target("avx2")))
+static void
+step_avx2(uint64_t *out, const uint64_t *center, const uint64_t *west, const uint64_t *east)
+{
+    uint64_t sum[TILE_STEP_ROWS], carry[TILE_STEP_ROWS];
+    __m256i c, a, b, t, s, k, s0, s1, s2, k0, k1, k2, ones, twos, fours, p, q, next;
+    int r;
+
+    for (r = 0; r < TILE_SIZE + 2; r += 4) {
+        c = _mm256_loadu_si256((const __m256i *)&center[r]);
+        a = _mm256_or_si256(_mm256_slli_epi64(c, 1), _mm256_loadu_si256((const __m256i *)&west[r]));
+        b = _mm256_or_si256(_mm256_srli_epi64(c, 1), _mm256_loadu_si256((const __m256i *)&east[r]));
+        t = _mm256_xor_si256(a, b);
+        s = _mm256_xor_si256(t, c);
+        k = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(t, c));
+        _mm256_storeu_si256((__m256i *)&sum[r], s);
+        _mm256_storeu_si256((__m256i *)&carry[r], k);
+    }
+
+    for (r = 0; r < TILE_SIZE; r += 4) {
+        s0 = _mm256_loadu_si256((const __m256i *)&sum[r]);
+        s1 = _mm256_loadu_si256((const __m256i *)&sum[r + 1]);
+        s2 = _mm256_loadu_si256((const __m256i *)&sum[r + 2]);
+        k0 = _mm256_loadu_si256((const __m256i *)&carry[r]);
+        k1 = _mm256_loadu_si256((const __m256i *)&carry[r + 1]);
+        k2 = _mm256_loadu_si256((const __m256i *)&carry[r + 2]);
+        c = _mm256_loadu_si256((const __m256i *)&center[r + 1]);
+
+        t = _mm256_xor_si256(s0, s1);
+        ones = _mm256_xor_si256(t, s2);
+        twos = _mm256_or_si256(_mm256_and_si256(s0, s1), _mm256_and_si256(t, s2));
+        t = _mm256_xor_si256(k0, k1);
+        p = _mm256_xor_si256(t, k2);
+        q = _mm256_or_si256(_mm256_and_si256(k0, k1), _mm256_and_si256(t, k2));
+        fours = _mm256_xor_si256(q, _mm256_and_si256(p, twos));
+        twos = _mm256_xor_si256(twos, p);
+
+        // (ones & twos & ~fours) | (~(ones | twos) & fours & c)
+        next = _mm256_or_si256(_mm256_andnot_si256(fours, _mm256_and_si256(ones, twos)),
+                               _mm256_andnot_si256(_mm256_or_si256(ones, twos), _mm256_and_si256(fours, c)));
+        _mm256_storeu_si256((__m256i *)&out[r], next);
+    }
+}
+
+#endif
+
+tile_step_function *
+tile_step_best(void)
+{
+#ifdef TILE_STEP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &step_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return &step_sse2;
+    }
+#endif
+    return &step_scalar;
+}
+
+tile_step_function *
+tile_step_by_name(const char *name)
+{
+    if (strcmp(name, "scalar") == 0) {
+        return &step_scalar;
+    }
+#ifdef TILE_STEP_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        return &step_sse2;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        return &step_avx2;
+    }
+#endif
+    return NULL;
+}
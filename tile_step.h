@@ -0,0 +1,40 @@
+#ifndef TILE_STEP_H
+#define TILE_STEP_H
+
+#include <stdint.h>
+
+#include "tile_table.h"
+
+/**
+ * The number of padded rows a step kernel expects: rows -1 .. TILE_SIZE of a tile, plus room for a vector tail.
+ */
+#define TILE_STEP_ROWS (TILE_SIZE + 4)
+
+/**
+ * a type representing a kernel that calculates the next generation of a tile's rows.
+ *
+ * All input arrays hold the rows -1 .. TILE_SIZE of the tile (i.e. index r is row r - 1, the first and last row come
+ * from the north / south neighbor); entries past TILE_SIZE + 1 must be readable but are ignored.
+ * @param out the TILE_SIZE rows of the next generation.
+ * @param center the cells of each row.
+ * @param west the west neighbor cell of each row, already moved to bit 0.
+ * @param east the east neighbor cell of each row, already moved to bit TILE_SIZE - 1.
+ */
+typedef void tile_step_function(uint64_t *out, const uint64_t *center, const uint64_t *west, const uint64_t *east);
+
+/**
+ * Returns the fastest step kernel supported by the CPU we are running on.
+ * @return the step kernel.
+ */
+tile_step_function *
+tile_step_best(void);
+
+/**
+ * Returns a step kernel by name.
+ * @param name the name of the kernel: "scalar", "sse2" or "avx2".
+ * @return the step kernel, or NULL if the kernel is unknown or not supported by the CPU.
+ */
+tile_step_function *
+tile_step_by_name(const char *name);
+
+#endif
@@ -0,0 +1,357 @@
+
+#include "tile_table.h"
+
+#include <assert.h>
+
+/**
+ * Fowler-Noll-Vo 32-bit constants
+ * @see https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
+ */
+#define FNV_32_PRIME 16777619u
+#define FNV_32_BASIS 2166136261u
+
+/**
+ * Calculates a Fowler-Noll-Vo (FNV) 32-bit hash value of arbitrary data.
+ * @param data the data to hash
+ * @param size the size of the data to hash
+ * @return the calculated FNV hash value.
+ */
+static inline unsigned int
+hash_bytes(const void *data, size_t size)
+{
+    unsigned int hash;
+    unsigned char *_data = (unsigned char *)data;
+
+    hash = FNV_32_BASIS;
+    while (size-- > 0)
+        hash = (hash * FNV_32_PRIME) ^ *_data++;
+
+    return hash;
+}
+
+/**
+ * Calculates a Fowler-Noll-Vo (FNV) 32-bit hash value of 2D points.
+ * @param p the point
+ * @return the calculated FNV hash value.
+ */
+static inline unsigned int
+hash_point2d(const Point2D *p)
+{
+    return hash_bytes(p, sizeof(Point2D));
+}
+
+/**
+ * Checks if a number is a power of two.
+ * @param n the number to check.
+ * @return true if n is a power of two, false otherwise.
+ */
+static inline int
+is_pow2(size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * Rounds a number to the next power of two.
+ * @param n the number to round.
+ * @return the next power of two greather than n.
+ */
+static inline size_t
+ceil_pow2(size_t n)
+{
+    while (!is_pow2(n)) {
+        n = (n & (n - 1));
+    }
+    return n;
+}
+
+/**
+ * Returns the bucket index for a given hash value.
+ * @param hash_val the hash value
+ * @param num_buckets the total number of buckets
+ * @return the bucket index.
+ */
+static inline size_t
+bucket_idx(unsigned int hash_val, size_t num_buckets)
+{
+    assert(is_pow2(num_buckets));
+    return hash_val & (num_buckets - 1);
+}
+
+/**
+ * Returns the index of the next bucket to probe.
+ * @param idx the prev. checked index which caused a conflict
+ * @param num_buckets the total number of buckets
+ * @return the index of the next bucket to probe.
+ */
+static inline size_t
+probe(size_t idx, size_t num_buckets) {
+    return (idx + 1) & (num_buckets - 1); // linear probing
+}
+
+/**
+ * Calculates the probe distance for a tile table element, i.e. the distance between its desired and its actual bucket.
+ * @param elem the tile table element.
+ * @param idx the actual index.
+ * @param num_buckets the total number of buckets.
+ * @return the probe distance.
+ */
+static inline size_t
+probe_dist(TileTableElem *elem, size_t idx, size_t num_buckets)
+{
+    assert(is_pow2(num_buckets));
+    return (idx + num_buckets - bucket_idx(elem->hash_val, num_buckets)) & (num_buckets - 1);
+}
+
+/**
+ * Look up a tile table element by key.
+ * @param tbl the tile table.
+ * @param key the key.
+ * @param start_idx the bucket index for starting the search.
+ * @return the found tile table element or NULL if no element with given key is stored in the tile table.
+ */
+static inline TileTableElem *
+find_elem(TileTable *tbl, const Point2D *key, size_t start_idx)
+{
+    size_t dist = 0;
+    size_t idx = start_idx;
+    TileTableElem *elem = &tbl->buckets[idx];
+
+    while (elem->is_occupied && dist < tbl->num_buckets) {
+        if (elem->key.x == key->x && elem->key.y == key->y) {
+            return elem;
+        }
+
+        // stop searching when we found an element with lower probe distance
+        if (probe_dist(elem, idx, tbl->num_buckets) < dist) {
+            break;
+        }
+
+        // try next bucket
+        idx = probe(idx, tbl->num_buckets);
+        elem = &tbl->buckets[idx];
+        ++dist;
+    }
+
+    return NULL;
+}
+
+/**
+ * Inserts an element (known not to be present yet) into a bucket array using robin hood hashing.
+ * @param buckets the bucket array.
+ * @param num_buckets the number of buckets.
+ * @param elem_insert the element to insert.
+ */
+static inline void
+insert_elem(TileTableElem *buckets, size_t num_buckets, TileTableElem elem_insert)
+{
+    size_t idx, dist, dist_elem;
+    TileTableElem tmp, *elem;
+
+    idx = bucket_idx(elem_insert.hash_val, num_buckets);
+    elem = &buckets[idx];
+    dist = 0;
+    while (elem->is_occupied) {
+        // swap elements if probe difference is higher (robin hood hashing)
+        dist_elem = probe_dist(elem, idx, num_buckets);
+        if (dist_elem < dist) {
+            tmp = *elem;
+            *elem = elem_insert;
+            elem_insert = tmp;
+            dist = dist_elem;
+        }
+
+        idx = probe(idx, num_buckets);
+        elem = &buckets[idx];
+        ++dist;
+    }
+
+    // write empty bucket
+    *elem = elem_insert;
+}
+
+/**
+ * Looks for the next occupied element in the tile table.
+ * @param tbl the tile table.
+ * @param prev_idx the index of the prev. element.
+ * @return the index of the next occupied element, or num_buckets if there is none.
+ */
+static inline size_t
+next_elem_idx(TileTable *tbl, size_t prev_idx)
+{
+    size_t idx;
+
+    for (idx = prev_idx + 1; idx < tbl->num_buckets; ++idx) {
+        if (tbl->buckets[idx].is_occupied) {
+            break;
+        }
+    }
+
+    return idx;
+}
+
+/**
+ * Calculates the current load factor.
+ * @return the current load factor
+ */
+static inline float
+current_load(TileTable *tbl)
+{
+    return (float)tbl->num_elems / tbl->num_buckets;
+}
+
+/**
+ * Rehashes the tile table with a new bucket array twice the size.
+ * @param tbl the tile table to rehash
+ * @return true if the operation succeeded, false otherwise
+ */
+static int
+rehash(TileTable *tbl)
+{
+    TileTableElem *new_buckets;
+    size_t new_num_buckets, idx;
+
+    // allocate new bucket array
+    new_num_buckets = tbl->num_buckets * 2;
+    new_buckets = calloc(new_num_buckets, sizeof(TileTableElem));
+    if (new_buckets == NULL) {
+        return 0;
+    }
+
+    // perform rehashing
+    for (idx = 0; idx < tbl->num_buckets; ++idx) {
+        if (tbl->buckets[idx].is_occupied) {
+            insert_elem(new_buckets, new_num_buckets, tbl->buckets[idx]);
+        }
+    }
+
+    free(tbl->buckets);
+    tbl->num_buckets = new_num_buckets;
+    tbl->buckets = new_buckets;
+
+    return 1;
+}
+
+TileTable *
+tile_table_create(size_t num_buckets, float load_factor)
+{
+    if (load_factor <= 0 || load_factor >= 1) {
+        return NULL;
+    }
+
+    // allocate tile table first
+    TileTable *tbl = malloc(sizeof(TileTable));
+    if (tbl == NULL) {
+        return NULL;
+    }
+
+    // round no. of buckets to next power of two
+    num_buckets = ceil_pow2(num_buckets);
+
+    // allocate buckets
+    tbl->buckets = calloc(num_buckets, sizeof(TileTableElem));
+    if (tbl->buckets == NULL) {
+        free(tbl);
+        return NULL;
+    }
+
+    tbl->num_buckets = num_buckets;
+    tbl->load_factor = load_factor;
+    tbl->num_elems = 0;
+
+    return tbl;
+}
+
+int
+tile_table_put(TileTable *tbl, const Point2D *key, const Tile *value)
+{
+    TileTableElem elem_insert, *elem;
+
+    elem_insert.key = *key;
+    elem_insert.value = (Tile *)value;
+    elem_insert.hash_val = hash_point2d(key);
+    elem_insert.is_occupied = 1;
+
+    // check if we have to update an existing value first
+    elem = find_elem(tbl, key, bucket_idx(elem_insert.hash_val, tbl->num_buckets));
+    if (elem != NULL) {
+        elem->value = (Tile *)value;
+        return 1;
+    }
+
+    // grow and rehash if load factor reached defined threshold
+    if (current_load(tbl) > tbl->load_factor && !rehash(tbl)) {
+        return 0;
+    }
+
+    insert_elem(tbl->buckets, tbl->num_buckets, elem_insert);
+    tbl->num_elems++;
+
+    return 1;
+}
+
+Tile *
+tile_table_get(TileTable *tbl, const Point2D *key)
+{
+    size_t idx = bucket_idx(hash_point2d(key), tbl->num_buckets);
+    TileTableElem *elem = find_elem(tbl, key, idx);
+    return (elem != NULL) ? elem->value : NULL;
+}
+
+void
+tile_table_clear(TileTable *tbl)
+{
+    size_t idx;
+
+    for (idx = 0; idx < tbl->num_buckets; ++idx) {
+        tbl->buckets[idx].is_occupied = 0;
+    }
+
+    tbl->num_elems = 0;
+}
+
+size_t
+tile_table_size(TileTable *tbl)
+{
+    return tbl->num_elems;
+}
+
+void
+tile_table_destroy(TileTable *tbl)
+{
+    free(tbl->buckets);
+    free(tbl);
+}
+
+void
+tile_table_iter_init(TileTable *tbl, TileTableIter *iter)
+{
+    iter->tbl = tbl;
+    iter->current_idx = -1;
+    iter->next_idx = (tbl->num_elems == 0) ? tbl->num_buckets : next_elem_idx(tbl, -1);
+}
+
+int
+tile_table_iter_has_next(TileTableIter *iter)
+{
+    return iter->next_idx < iter->tbl->num_buckets;
+}
+
+void
+tile_table_iter_next(TileTableIter *iter)
+{
+    iter->current_idx = iter->next_idx;
+    iter->next_idx = next_elem_idx(iter->tbl, iter->current_idx);
+}
+
+Point2D *
+tile_table_iter_get_key(TileTableIter *iter)
+{
+    return &iter->tbl->buckets[iter->current_idx].key;
+}
+
+Tile *
+tile_table_iter_get_val(TileTableIter *iter)
+{
+    return iter->tbl->buckets[iter->current_idx].value;
+}
@@ -0,0 +1,200 @@
+#ifndef TILE_TABLE_H
+#define TILE_TABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "life.h"
+
+/**
+ * The number of bits used for the cell offset within a tile, i.e. tiles are TILE_SIZE x TILE_SIZE cells.
+ */
+#define TILE_BITS 6
+#define TILE_SIZE (1 << TILE_BITS)
+
+/**
+ * a type representing a tile of cells, stored as a bit block.
+ */
+typedef struct tile {
+
+    /**
+     * The rows of the tile; bit x of row y is the cell at (tile.x * TILE_SIZE + x, tile.y * TILE_SIZE + y).
+     */
+    uint64_t rows[TILE_SIZE];
+
+    /**
+     * a flag indicating if the tile changed in the generation it was calculated for.
+     */
+    int changed;
+
+} Tile;
+
+/**
+ * a type representing a tile table element.
+ */
+typedef struct tile_table_elem {
+
+    /**
+     * The key (the tile coordinates).
+     */
+    Point2D key;
+
+    /**
+     * The value (a pointer to the tile).
+     */
+    Tile *value;
+
+    /**
+     * The original hash value of the key.
+     */
+    unsigned int hash_val;
+
+    /**
+     * a flag indicating if the tile table element is occupied.
+     */
+    int is_occupied;
+
+} TileTableElem;
+
+/**
+ * a type representing the tile table.
+ *
+ * The tile table is a robin hood hash table (like the cell table), which maps tile coordinates to tiles.
+ */
+typedef struct tile_table {
+
+    /**
+     * The number of buckets.
+     */
+    size_t num_buckets;
+
+    /**
+     * a factor that controls growing + rehashing of the tile table.
+     */
+    float load_factor;
+
+    /**
+     * The number of elements currently stored in the table.
+     */
+    size_t num_elems;
+
+    /**
+     * The buckets.
+     */
+    TileTableElem *buckets;
+
+} TileTable;
+
+/**
+ * a type representing the tile table iterator.
+ */
+typedef struct tile_table_iter {
+
+    /**
+     * The tile table the iterator iterates over.
+     */
+    TileTable *tbl;
+
+    /**
+     * The bucket index of the element the iterator currently points at.
+     */
+    size_t current_idx;
+
+    /**
+     * The bucket index of the element the iterator points next (num_buckets if there is none).
+     */
+    size_t next_idx;
+
+} TileTableIter;
+
+/**
+ * Creates a tile table
+ * @param num_buckets the number of buckets to allocate.
+ * @param load_factor a factor controlling growing / rehashing of the tile table.
+ * @return a pointer to the tile table created on the heap.
+ */
+TileTable *
+tile_table_create(size_t num_buckets, float load_factor);
+
+/**
+ * Adds an entry to the tile table.
+ * @param tbl the tile table.
+ * @param key the tile coordinates.
+ * @param value the tile.
+ * @return true if the entry was added successfully, false otherwise.
+ */
+int
+tile_table_put(TileTable *tbl, const Point2D *key, const Tile *value);
+
+/**
+ * Retrieves a tile by its coordinates from the tile table.
+ * @param tbl the tile table.
+ * @param key the tile coordinates.
+ * @return the tile or NULL if the table does not contain a tile with given coordinates.
+ */
+Tile *
+tile_table_get(TileTable *tbl, const Point2D *key);
+
+/**
+ * Removes all entries from the tile table.
+ * @param tbl the tile table.
+ */
+void
+tile_table_clear(TileTable *tbl);
+
+/**
+ * Returns the no. of elements the tile table contains.
+ * @param tbl the tile table
+ * @return the number of elements the tile table contains.
+ */
+size_t
+tile_table_size(TileTable *tbl);
+
+/**
+ * Destroys a tile table and frees all resources (except for the tiles).
+ * @param tbl the tile table.
+ */
+void
+tile_table_destroy(TileTable *tbl);
+
+/**
+ * Initializes a tile table iterator.
+ * WARNING: do not alter the tile table upon iteration!
+ * @param tbl the tile table.
+ * @param iter a pointer to an allocated tile table iterator instance.
+ */
+void
+tile_table_iter_init(TileTable *tbl, TileTableIter *iter);
+
+/**
+ * Check whether the iterator can deliver a next element.
+ * @param iter the tile table iterator.
+ * @return true if the iterator can return a next element, false otherwise.
+ */
+int
+tile_table_iter_has_next(TileTableIter *iter);
+
+/**
+ * Moves the iterator one step to the next element.
+ * @param iter the tile table iterator.
+ */
+void
+tile_table_iter_next(TileTableIter *iter);
+
+/**
+ * Returns the key of the tile table entry an iterator currently points at.
+ * @param iter the tile table iterator.
+ * @return the tile coordinates of the entry the iterator currently points at.
+ */
+Point2D *
+tile_table_iter_get_key(TileTableIter *iter);
+
+/**
+ * Returns the value of the tile table entry an iterator currently points at.
+ * @param iter the tile table iterator.
+ * @return the tile of the entry the iterator currently points at.
+ */
+Tile *
+tile_table_iter_get_val(TileTableIter *iter);
+
+#endif
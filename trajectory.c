@@ -0,0 +1,388 @@
+#include "trajectory.h"
+
+#include <string.h>
+
+#include "compact.h"
+#include "radix_sort.h"
+
+/**
+ * The maximum size of an encoded cell (two varints of 32-bit values).
+ */
+#define TRAJECTORY_CELL_MAX 10
+
+/**
+ * The maximum size of the number of cells of an encoded cell list.
+ */
+#define TRAJECTORY_COUNT_MAX 5
+
+/**
+ * Makes sure a cell log has room for a number of cells.
+ * @param log the cell log.
+ * @param capacity the number of cells.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static int
+cell_log_reserve(CellLog *log, size_t capacity)
+{
+    SnapshotCell *cells;
+
+    if (log->capacity >= capacity) {
+        return 1;
+    }
+    cells = realloc(log->cells, capacity * sizeof(SnapshotCell));
+    if (cells == NULL) {
+        return 0;
+    }
+    log->cells = cells;
+    log->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Returns the sort key of a cell (y, then x).
+ * @param c the cell.
+ * @return the sort key.
+ */
+static inline uint64_t
+cell_key(const SnapshotCell *c)
+{
+    return radix_sort_pack(c->y, c->x);
+}
+
+/**
+ * Makes sure the scratch space of a trajectory writer has room for a frame.
+ * @param w the trajectory writer.
+ * @param num_keys the number of cells of the largest cell list of the frame.
+ * @param size the maximum size of the encoded frame.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static int
+reserve_scratch(TrajectoryWriter *w, size_t num_keys, size_t size)
+{
+    uint64_t *keys;
+    unsigned char *buf;
+
+    if (w->keys_capacity < num_keys) {
+        keys = realloc(w->keys, num_keys * sizeof(uint64_t));
+        if (keys == NULL) {
+            return 0;
+        }
+        w->keys = keys;
+        w->keys_capacity = num_keys;
+    }
+    if (w->buf_capacity < size) {
+        buf = realloc(w->buf, size);
+        if (buf == NULL) {
+            return 0;
+        }
+        w->buf = buf;
+        w->buf_capacity = size;
+    }
+    return 1;
+}
+
+/**
+ * Encodes a cell list.
+ * @param w the trajectory writer (with enough scratch space, see reserve_scratch()).
+ * @param p the output position.
+ * @param cells the cells (in any order).
+ * @param num_cells the number of cells.
+ * @return the position after the encoded list, or NULL on failure.
+ */
+static unsigned char *
+encode_list(TrajectoryWriter *w, unsigned char *p, const SnapshotCell *cells, size_t num_cells)
+{
+    uint32_t x, y, prev_x, prev_y;
+    size_t i;
+
+    if (num_cells > UINT32_MAX) {
+        return NULL;
+    }
+
+    for (i = 0; i < num_cells; ++i) {
+        w->keys[i] = cell_key(&cells[i]);
+    }
+    if (!radix_sort(w->keys, num_cells, NULL)) {
+        return NULL;
+    }
+
+    p = compact_put_varint(p, (uint32_t)num_cells);
+    if (num_cells == 0) {
+        return p;
+    }
+
+    prev_y = (uint32_t)radix_sort_x(w->keys[0]);
+    prev_x = (uint32_t)radix_sort_y(w->keys[0]);
+    p = compact_put_varint(p, compact_zigzag(prev_x));
+    p = compact_put_varint(p, compact_zigzag(prev_y));
+
+    for (i = 1; i < num_cells; ++i) {
+        y = (uint32_t)radix_sort_x(w->keys[i]);
+        x = (uint32_t)radix_sort_y(w->keys[i]);
+        p = compact_put_varint(p, y - prev_y);
+        if (y == prev_y) {
+            p = compact_put_varint(p, x - prev_x - 1);
+        } else {
+            p = compact_put_varint(p, compact_zigzag(x - prev_x));
+        }
+        prev_x = x;
+        prev_y = y;
+    }
+
+    return p;
+}
+
+/**
+ * Decodes a cell list and appends the cells to a cell log.
+ * @param p the position to start at; advanced behind the list.
+ * @param end the end of the frame.
+ * @param out the cell log.
+ * @return true if the list was decoded successfully, false otherwise.
+ */
+static int
+decode_list(const unsigned char **p, const unsigned char *end, CellLog *out)
+{
+    uint32_t n, x, y, dy, d;
+    size_t i;
+
+    if (!compact_get_varint(p, end, &n)) {
+        return 0;
+    }
+    if (n == 0) {
+        return 1;
+    }
+    // every cell takes at least two bytes
+    if (n > (size_t)(end - *p) / 2 + 1 || !cell_log_reserve(out, out->num_cells + n)) {
+        return 0;
+    }
+
+    if (!compact_get_varint(p, end, &x) || !compact_get_varint(p, end, &y)) {
+        return 0;
+    }
+    x = compact_unzigzag(x);
+    y = compact_unzigzag(y);
+    out->cells[out->num_cells].x = (int32_t)x;
+    out->cells[out->num_cells].y = (int32_t)y;
+    out->num_cells++;
+
+    for (i = 1; i < n; ++i) {
+        if (!compact_get_varint(p, end, &dy) || !compact_get_varint(p, end, &d)) {
+            return 0;
+        }
+        if (dy == 0) {
+            x += d + 1;
+        } else {
+            y += dy;
+            x += compact_unzigzag(d);
+        }
+        out->cells[out->num_cells].x = (int32_t)x;
+        out->cells[out->num_cells].y = (int32_t)y;
+        out->num_cells++;
+    }
+
+    return 1;
+}
+
+/**
+ * Applies a delta to a state: removes the deaths and adds the births (all lists sorted by y, then x).
+ * @param state the state; replaced by the next state.
+ * @param births the cells born.
+ * @param deaths the cells that died.
+ * @param tmp a cell log used to build the next state; swapped with the state.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static int
+apply_delta(CellLog *state, const CellLog *births, const CellLog *deaths, CellLog *tmp)
+{
+    const SnapshotCell *s = state->cells, *b = births->cells, *d = deaths->cells;
+    size_t i = 0, j = 0, k = 0;
+    CellLog swap;
+
+    tmp->num_cells = 0;
+    if (!cell_log_reserve(tmp, state->num_cells + births->num_cells)) {
+        return 0;
+    }
+
+    while (i < state->num_cells || j < births->num_cells) {
+        if (j == births->num_cells || (i < state->num_cells && cell_key(&s[i]) < cell_key(&b[j]))) {
+            // a cell of the state survives unless it died
+            while (k < deaths->num_cells && cell_key(&d[k]) < cell_key(&s[i])) k++;
+            if (k == deaths->num_cells || cell_key(&d[k]) != cell_key(&s[i])) {
+                tmp->cells[tmp->num_cells++] = s[i];
+            }
+            i++;
+        } else {
+            if (i < state->num_cells && cell_key(&s[i]) == cell_key(&b[j])) {
+                i++;
+            }
+            tmp->cells[tmp->num_cells++] = b[j++];
+        }
+    }
+
+    swap = *state;
+    *state = *tmp;
+    *tmp = swap;
+    return 1;
+}
+
+/**
+ * Writes a frame header and the encoded cell lists in the scratch buffer.
+ * @param w the trajectory writer.
+ * @param kind the kind of the frame.
+ * @param generation the number of the generation.
+ * @param end the end of the encoded cell lists in the scratch buffer.
+ * @return true if the operation succeeded, false otherwise.
+ */
+static int
+write_frame(TrajectoryWriter *w, uint32_t kind, uint64_t generation, const unsigned char *end)
+{
+    TrajectoryFrame frame;
+
+    memset(&frame, 0, sizeof(TrajectoryFrame));
+    frame.kind = kind;
+    frame.generation = generation;
+    frame.size = end - w->buf;
+
+    return fwrite(&frame, sizeof(TrajectoryFrame), 1, w->f) == 1
+           && fwrite(w->buf, 1, frame.size, w->f) == frame.size;
+}
+
+int
+cell_log_grow(CellLog *log)
+{
+    return cell_log_reserve(log, log->capacity > 0 ? log->capacity * 2 : 1024);
+}
+
+void
+cell_log_destroy(CellLog *log)
+{
+    free(log->cells);
+    log->cells = NULL;
+    log->num_cells = log->capacity = 0;
+}
+
+int
+trajectory_writer_init(TrajectoryWriter *w, FILE *f, uint32_t keyframe_interval)
+{
+    TrajectoryHeader header;
+
+    w->f = f;
+    w->keys = NULL;
+    w->keys_capacity = 0;
+    w->buf = NULL;
+    w->buf_capacity = 0;
+
+    memset(&header, 0, sizeof(TrajectoryHeader));
+    memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.keyframe_interval = keyframe_interval;
+
+    return fwrite(&header, sizeof(TrajectoryHeader), 1, f) == 1;
+}
+
+int
+trajectory_write_keyframe(TrajectoryWriter *w, uint64_t generation, const SnapshotCell *cells, size_t num_cells)
+{
+    unsigned char *p;
+
+    if (!reserve_scratch(w, num_cells + 1, num_cells * TRAJECTORY_CELL_MAX + TRAJECTORY_COUNT_MAX)) {
+        return 0;
+    }
+
+    p = encode_list(w, w->buf, cells, num_cells);
+    return p != NULL && write_frame(w, TRAJECTORY_KEYFRAME, generation, p);
+}
+
+int
+trajectory_write_delta(TrajectoryWriter *w, uint64_t generation, const CellLog *births, const CellLog *deaths)
+{
+    size_t max = births->num_cells > deaths->num_cells ? births->num_cells : deaths->num_cells;
+    unsigned char *p;
+
+    if (!reserve_scratch(w, max + 1, (births->num_cells + deaths->num_cells) * TRAJECTORY_CELL_MAX
+                                     + 2 * TRAJECTORY_COUNT_MAX)) {
+        return 0;
+    }
+
+    p = encode_list(w, w->buf, births->cells, births->num_cells);
+    if (p != NULL) {
+        p = encode_list(w, p, deaths->cells, deaths->num_cells);
+    }
+    return p != NULL && write_frame(w, TRAJECTORY_DELTA, generation, p);
+}
+
+void
+trajectory_writer_destroy(TrajectoryWriter *w)
+{
+    free(w->keys);
+    free(w->buf);
+    w->keys = NULL;
+    w->buf = NULL;
+    w->keys_capacity = w->buf_capacity = 0;
+}
+
+int
+trajectory_replay(const void *data, size_t size, uint64_t generation, CellLog *out)
+{
+    const TrajectoryHeader *header = (const TrajectoryHeader *)data;
+    const unsigned char *begin = (const unsigned char *)data, *pos, *keyframe = NULL, *p, *end;
+    TrajectoryFrame frame;
+    CellLog births = {NULL, 0, 0}, deaths = {NULL, 0, 0}, tmp = {NULL, 0, 0};
+    uint64_t reached = 0;
+    int ok;
+
+    out->num_cells = 0;
+
+    if (size < sizeof(TrajectoryHeader) || memcmp(header->magic, TRAJECTORY_MAGIC, sizeof(header->magic)) != 0
+        || header->version != TRAJECTORY_VERSION) {
+        return 0;
+    }
+
+    // find the last keyframe at or before the generation; only the frame headers are read (copied, as frames are
+    // not aligned)
+    for (pos = begin + sizeof(TrajectoryHeader); (size_t)(begin + size - pos) >= sizeof(TrajectoryFrame);
+         pos += sizeof(TrajectoryFrame) + frame.size) {
+        memcpy(&frame, pos, sizeof(TrajectoryFrame));
+        if (frame.size > (size_t)(begin + size - pos) - sizeof(TrajectoryFrame) || frame.generation > generation) {
+            break;
+        }
+        if (frame.kind == TRAJECTORY_KEYFRAME) {
+            keyframe = pos;
+        }
+    }
+    if (keyframe == NULL) {
+        return 0;
+    }
+
+    // decode the keyframe, then apply the deltas up to the generation
+    memcpy(&frame, keyframe, sizeof(TrajectoryFrame));
+    p = keyframe + sizeof(TrajectoryFrame);
+    end = p + frame.size;
+    ok = decode_list(&p, end, out) && p == end;
+    reached = frame.generation;
+
+    for (pos = end; ok && reached < generation && (size_t)(begin + size - pos) >= sizeof(TrajectoryFrame);
+         pos += sizeof(TrajectoryFrame) + frame.size) {
+        memcpy(&frame, pos, sizeof(TrajectoryFrame));
+        if (frame.size > (size_t)(begin + size - pos) - sizeof(TrajectoryFrame)) {
+            break;
+        }
+        if (frame.kind != TRAJECTORY_DELTA || frame.generation != reached + 1) {
+            continue;
+        }
+
+        p = pos + sizeof(TrajectoryFrame);
+        end = p + frame.size;
+        births.num_cells = 0;
+        deaths.num_cells = 0;
+        ok = decode_list(&p, end, &births) && decode_list(&p, end, &deaths) && p == end
+             && apply_delta(out, &births, &deaths, &tmp);
+        reached = frame.generation;
+    }
+
+    cell_log_destroy(&births);
+    cell_log_destroy(&deaths);
+    cell_log_destroy(&tmp);
+
+    return ok && reached == generation;
+}
@@ -0,0 +1,218 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "snapshot.h"
+
+/**
+ * A binary log of the evolution of the game of life: instead of full states, it holds the cells born and the cells
+ * that died in every generation (deltas), plus a full state (keyframe) every now and then:
+ *
+ *   header | frame | frame | ...
+ *
+ * Every frame starts with a TrajectoryFrame header, followed by its encoded cell lists. A keyframe holds the alive
+ * cells of its generation, a delta holds the births, then the deaths which lead from the previous generation to
+ * its generation. A cell list is the varint number of cells followed by the cells sorted by y, then x: the first
+ * one as zigzag varints, each following one relative to its predecessor as in the compact format (see compact.h).
+ * A generation is rebuilt from the nearest keyframe at or before it by applying the following deltas.
+ */
+
+/**
+ * The magic bytes a trajectory starts with.
+ */
+#define TRAJECTORY_MAGIC "LIFETRAJ"
+
+/**
+ * The current version of the trajectory format.
+ */
+#define TRAJECTORY_VERSION 1
+
+/**
+ * The kinds of frames.
+ */
+#define TRAJECTORY_KEYFRAME 1
+#define TRAJECTORY_DELTA    2
+
+/**
+ * a type representing the header of a trajectory.
+ */
+typedef struct trajectory_header {
+
+    /**
+     * The magic bytes (TRAJECTORY_MAGIC without the terminating null byte).
+     */
+    char magic[8];
+
+    /**
+     * The version of the trajectory format.
+     */
+    uint32_t version;
+
+    /**
+     * The number of generations between two keyframes.
+     */
+    uint32_t keyframe_interval;
+
+} TrajectoryHeader;
+
+/**
+ * a type representing the header of a frame.
+ */
+typedef struct trajectory_frame {
+
+    /**
+     * The kind of the frame (TRAJECTORY_KEYFRAME or TRAJECTORY_DELTA).
+     */
+    uint32_t kind;
+
+    /**
+     * unused member for memory alignment purposes.
+     */
+    uint32_t padding;
+
+    /**
+     * The number of the generation.
+     */
+    uint64_t generation;
+
+    /**
+     * The size of the encoded cell lists following the frame header.
+     */
+    uint64_t size;
+
+} TrajectoryFrame;
+
+/**
+ * a type representing a growable list of cells, e.g. the births of a generation.
+ */
+typedef struct cell_log {
+
+    /**
+     * The cells.
+     */
+    SnapshotCell *cells;
+
+    /**
+     * The number of cells.
+     */
+    size_t num_cells;
+
+    /**
+     * The capacity of the cell array.
+     */
+    size_t capacity;
+
+} CellLog;
+
+/**
+ * a type representing a trajectory writer.
+ */
+typedef struct trajectory_writer {
+
+    /**
+     * The output file.
+     */
+    FILE *f;
+
+    /**
+     * Scratch space for the sort keys of a cell list.
+     */
+    uint64_t *keys;
+    size_t keys_capacity;
+
+    /**
+     * Scratch space for an encoded frame.
+     */
+    unsigned char *buf;
+    size_t buf_capacity;
+
+} TrajectoryWriter;
+
+/**
+ * Grows a cell log.
+ * @param log the cell log.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+cell_log_grow(CellLog *log);
+
+/**
+ * Appends a cell to a cell log.
+ * @param log the cell log.
+ * @param x the X coordinate.
+ * @param y the Y coordinate.
+ * @return true if the operation succeeded, false if memory ran out or the coordinates do not fit into 32 bits.
+ */
+static inline int
+cell_log_add(CellLog *log, long x, long y)
+{
+    if (!snapshot_fits(x, y) || (log->num_cells == log->capacity && !cell_log_grow(log))) {
+        return 0;
+    }
+    log->cells[log->num_cells].x = x;
+    log->cells[log->num_cells].y = y;
+    log->num_cells++;
+    return 1;
+}
+
+/**
+ * Frees the cells of a cell log.
+ * @param log the cell log.
+ */
+void
+cell_log_destroy(CellLog *log);
+
+/**
+ * Initializes a trajectory writer and writes the trajectory header.
+ * @param w a pointer to an allocated trajectory writer instance.
+ * @param f the output file.
+ * @param keyframe_interval the number of generations between two keyframes.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+trajectory_writer_init(TrajectoryWriter *w, FILE *f, uint32_t keyframe_interval);
+
+/**
+ * Writes a keyframe.
+ * @param w the trajectory writer.
+ * @param generation the number of the generation.
+ * @param cells the alive cells (in any order).
+ * @param num_cells the number of cells.
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+trajectory_write_keyframe(TrajectoryWriter *w, uint64_t generation, const SnapshotCell *cells, size_t num_cells);
+
+/**
+ * Writes a delta.
+ * @param w the trajectory writer.
+ * @param generation the number of the generation the delta leads to.
+ * @param births the cells born (in any order).
+ * @param deaths the cells that died (in any order).
+ * @return true if the operation succeeded, false otherwise.
+ */
+int
+trajectory_write_delta(TrajectoryWriter *w, uint64_t generation, const CellLog *births, const CellLog *deaths);
+
+/**
+ * Frees the scratch space of a trajectory writer (the output file is not closed).
+ * @param w the trajectory writer.
+ */
+void
+trajectory_writer_destroy(TrajectoryWriter *w);
+
+/**
+ * Rebuilds a generation from a trajectory.
+ * @param data the trajectory (e.g. a mapped file).
+ * @param size the size of the trajectory.
+ * @param generation the number of the generation.
+ * @param out an output parameter for the alive cells of the generation, sorted by y, then x.
+ * @return true on success, false if the trajectory is corrupt, does not contain the generation or memory ran out.
+ */
+int
+trajectory_replay(const void *data, size_t size, uint64_t generation, CellLog *out);
+
+#endif